@@ -0,0 +1,314 @@
+#include "ActivityFeed.h"
+#include "DbConnection.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QSettings>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimeZone>
+#include <QVariant>
+#include <algorithm>
+#include <cstring>
+
+// catchUp() re-reads this many ids below the highest one seen, for entries
+// that committed late or whose notification was lost
+static const qint64 catchUpMargin = 1000;
+
+// Timestamps are naive (TIMESTAMP without time zone), so they are counted
+// as if UTC: no daylight saving gaps, and the same numbers PostgreSQL shows
+static qint64 toMicros(const QDateTime& time) {
+    return QDateTime(time.date(), time.time(), QTimeZone::utc()).toMSecsSinceEpoch() * 1000;
+}
+
+static QString formatMicros(qint64 micros) {
+    const qint64 seconds = micros >= 0 ? micros / 1000000 : (micros - 999999) / 1000000;
+    return QDateTime::fromSecsSinceEpoch(seconds, QTimeZone::utc()).toString("yyyy-MM-dd'T'HH:mm:ss")
+           + QString(".%1").arg(micros - seconds * 1000000, 6, 10, QChar('0'));
+}
+
+ActivityFeed& ActivityFeed::instance() {
+    static ActivityFeed feed;
+    return feed;
+}
+
+ActivityFeed::ActivityFeed() {
+    capacity = qBound(100, QSettings().value("activityLog/feedSize", 1000).toInt(), 100000);
+    slots.reset(new Slot[capacity]);
+    keys.resize(capacity);
+}
+
+bool ActivityFeed::parseTimestamp(const QString& text, qint64& micros) {
+    const QDate date = QDate::fromString(text.left(10), Qt::ISODate);
+    const QTime time = QTime::fromString(text.mid(11, 8), "HH:mm:ss");
+    if (!date.isValid() || !time.isValid()) return false;
+    bool ok = true;
+    const QString fraction = text.mid(20, 6);
+    const qint64 extra = fraction.isEmpty() ? 0 : fraction.leftJustified(6, '0').toLongLong(&ok);
+    micros = QDateTime(date, time, QTimeZone::utc()).toSecsSinceEpoch() * 1000000 + extra;
+    return ok;
+}
+
+bool ActivityFeed::readSlot(quint64 index, Record& record) const {
+    const Slot& slot = slots[index % capacity];
+    while (true) {
+        const quint64 before = slot.sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        // Copy only the bytes in use; a short slot is cheap to read
+        record.key = slot.record.key;
+        record.complete = slot.record.complete;
+        std::memcpy(record.sizes, slot.record.sizes, sizeof record.sizes);
+        const quint16 sizes[4] = {qMin<quint16>(record.sizes[0], sizeof record.username), qMin<quint16>(record.sizes[1], sizeof record.action),
+                                  qMin<quint16>(record.sizes[2], sizeof record.details), qMin<quint16>(record.sizes[3], sizeof record.fields)};
+        std::memcpy(record.username, slot.record.username, sizes[0]);
+        std::memcpy(record.action, slot.record.action, sizes[1]);
+        std::memcpy(record.details, slot.record.details, sizes[2]);
+        std::memcpy(record.fields, slot.record.fields, sizes[3]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == before) return before > 0;
+    }
+}
+
+ActivityFeed::Key ActivityFeed::readBoundary() const {
+    while (true) {
+        const quint64 before = boundarySequence.load(std::memory_order_acquire);
+        Key key;
+        key.micros = boundaryMicros.load(std::memory_order_relaxed);
+        key.id = boundaryId.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(before & 1) && boundarySequence.load(std::memory_order_relaxed) == before) return key;
+    }
+}
+
+void ActivityFeed::setBoundary(const Key& key) {
+    const quint64 sequence = boundarySequence.load(std::memory_order_relaxed);
+    boundarySequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    boundaryMicros.store(key.micros, std::memory_order_relaxed);
+    boundaryId.store(key.id, std::memory_order_relaxed);
+    boundarySequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool ActivityFeed::query(const ActivityLogQuery::Filter& filter, QList<ActivityLogQuery::Row>& rows, QString& nextCursor) const {
+    if (!primed.load(std::memory_order_acquire)) return false;
+    Key upper;
+    upper.micros = upper.id = LLONG_MAX;
+    if (!filter.cursor.isEmpty()) {
+        bool ok = false;
+        upper.id = filter.cursor.section('_', 1).toLongLong(&ok);
+        if (!ok || !parseTimestamp(filter.cursor.section('_', 0, 0), upper.micros)) return false;
+    }
+    const qint64 fromMicros = filter.from.isValid() ? toMicros(filter.from) : LLONG_MIN;
+    const qint64 toMicrosExclusive = filter.to.isValid() ? toMicros(filter.to) : LLONG_MAX;
+    const QByteArray username = filter.username.toUtf8();
+    const QByteArray action = filter.action.toUtf8();
+    QJsonObject contains;
+    if (filter.saleId > 0) contains.insert("sale_id", filter.saleId);
+    if (filter.productId > 0) contains.insert("product_id", filter.productId);
+    if (!filter.product.isEmpty()) contains.insert("product", filter.product);
+
+    QList<std::pair<Key, ActivityLogQuery::Row>> matches;
+    bool incomplete = false;
+    const quint64 end = written.load(std::memory_order_acquire);
+    const quint64 begin = end > quint64(capacity) ? end - capacity : 0;
+    Record record;
+    for (quint64 index = begin; index < end; ++index) {
+        if (!readSlot(index, record)) continue;
+        const Key& key = record.key;
+        if (!(key < upper) || key.micros < fromMicros || key.micros >= toMicrosExclusive) continue;
+        // A cut field only rules the entry out if even the part kept differs
+        auto differs = [&record](const char *text, int size, int capacity, const QByteArray& wanted) {
+            const QByteArray held = QByteArray::fromRawData(text, size);
+            return !record.complete && size == capacity ? !wanted.startsWith(held) : held != wanted;
+        };
+        if (!username.isEmpty() && differs(record.username, record.sizes[0], int(sizeof record.username), username)) continue;
+        if (!action.isEmpty() && differs(record.action, record.sizes[1], int(sizeof record.action), action)) continue;
+        if (!record.complete) {
+            incomplete = true; // Can't be matched or shown faithfully
+            continue;
+        }
+        ActivityLogQuery::Row row;
+        row.fields = QJsonDocument::fromJson(QByteArray(record.fields, record.sizes[3])).object();
+        bool match = true;
+        for (auto it = contains.begin(); it != contains.end() && match; ++it) match = row.fields.value(it.key()) == it.value();
+        if (!match) continue;
+        row.id = key.id;
+        row.username = QString::fromUtf8(record.username, record.sizes[0]);
+        row.action = QString::fromUtf8(record.action, record.sizes[1]);
+        row.details = QString::fromUtf8(record.details, record.sizes[2]);
+        const QDateTime utc = QDateTime::fromMSecsSinceEpoch(key.micros / 1000, QTimeZone::utc());
+        row.timestamp = QDateTime(utc.date(), utc.time());
+        row.cursor = formatMicros(key.micros) + "_" + QString::number(key.id);
+        matches.append({key, row});
+    }
+    // Read last, so anything evicted during the scan counts as not held
+    const Key boundary = readBoundary();
+    matches.erase(std::remove_if(matches.begin(), matches.end(), [&](const auto& match) { return !(boundary < match.first); }),
+                  matches.end());
+    std::sort(matches.begin(), matches.end(), [](const auto& a, const auto& b) { return b.first < a.first; });
+
+    const int limit = qBound(1, filter.limit, ActivityLogQuery::maxLimit);
+    const bool complete = boundary.micros == LLONG_MIN || fromMicros > boundary.micros;
+    if (incomplete || (matches.size() <= limit && !complete)) return false;
+    rows.clear();
+    nextCursor.clear();
+    for (int i = 0; i < matches.size() && i < limit; ++i) rows.append(matches[i].second);
+    if (matches.size() > limit) nextCursor = rows.last().cursor;
+    return true;
+}
+
+void ActivityFeed::add(const QList<ActivityLogQuery::Row>& rows) {
+    QMutexLocker locker(&writeMutex);
+    addLocked(rows);
+}
+
+void ActivityFeed::addLocked(const QList<ActivityLogQuery::Row>& rows) {
+    for (const ActivityLogQuery::Row& row : rows) {
+        Key key;
+        key.id = row.id;
+        if (ids.contains(row.id) || !parseTimestamp(row.cursor.section('_', 0, 0), key.micros)) continue;
+        // Older than what the feed vouches for; the database has it
+        if (primed.load(std::memory_order_relaxed) && !(readBoundary() < key)) continue;
+
+        const quint64 index = written.load(std::memory_order_relaxed);
+        const int position = int(index % capacity);
+        if (index >= quint64(capacity)) {
+            const Key evicted = keys[position];
+            ids.remove(evicted.id);
+            if (readBoundary() < evicted) setBoundary(evicted);
+        }
+        // Encoded first, so readers only wait out the copies
+        const QByteArray texts[4] = {row.username.toUtf8(), row.action.toUtf8(), row.details.toUtf8(),
+                                     QJsonDocument(row.fields).toJson(QJsonDocument::Compact)};
+        Slot& slot = slots[position];
+        const quint64 sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        Record& record = slot.record;
+        record.key = key;
+        record.complete = true;
+        char *targets[4] = {record.username, record.action, record.details, record.fields};
+        const int sizes[4] = {int(sizeof record.username), int(sizeof record.action), int(sizeof record.details), int(sizeof record.fields)};
+        for (int i = 0; i < 4; ++i) {
+            if (texts[i].size() > sizes[i]) record.complete = false;
+            record.sizes[i] = quint16(qMin<qsizetype>(texts[i].size(), sizes[i]));
+            std::memcpy(targets[i], texts[i].constData(), record.sizes[i]);
+        }
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        written.store(index + 1, std::memory_order_release);
+
+        keys[position] = key;
+        ids.insert(key.id);
+        maxId = qMax(maxId, key.id);
+    }
+}
+
+bool ActivityFeed::holds(qint64 from, qint64 to) {
+    QMutexLocker locker(&writeMutex);
+    if (to - from > capacity) return false;
+    for (qint64 id = from; id <= to; ++id) {
+        if (!ids.contains(id)) return false;
+    }
+    return true;
+}
+
+void ActivityFeed::listen() {
+    QSqlDriver *driver = QSqlDatabase::database().driver();
+    if (!driver->subscribeToNotification("activity_log")) {
+        qDebug() << "Activity feed: could not listen for activity_log:" << driver->lastError().text();
+        return;
+    }
+    QObject::connect(driver, &QSqlDriver::notification, driver,
+                     [this](const QString& name, QSqlDriver::NotificationSource, const QVariant& payload) {
+        if (name != "activity_log") return;
+        const QJsonObject range = QJsonDocument::fromJson(payload.toString().toUtf8()).object();
+        const qint64 from = range.value("from").toInteger(), to = range.value("to").toInteger();
+        if (from <= 0 || to < from || holds(from, to)) return; // This terminal's own batch, already added
+        QMutexLocker locker(&writeMutex);
+        pendingFrom = pendingTo < pendingFrom ? from : qMin(pendingFrom, from);
+        pendingTo = qMax(pendingTo, to);
+        if (fetchScheduled) return;
+        fetchScheduled = true;
+        QThreadPool::globalInstance()->start([this] {
+            // Works through ranges notified meanwhile on the same connection
+            ScopedDbConnection connection("activity-feed");
+            while (true) {
+                qint64 from, to;
+                {
+                    QMutexLocker locker(&writeMutex);
+                    if (pendingTo < pendingFrom || !connection.isOpen()) {
+                        pendingFrom = 0;
+                        pendingTo = -1;
+                        fetchScheduled = false;
+                        return;
+                    }
+                    from = pendingFrom;
+                    to = pendingTo;
+                    pendingFrom = 0;
+                    pendingTo = -1;
+                }
+                QSqlQuery query(connection.database());
+                query.prepare(QString("SELECT %1 FROM activity_log WHERE id BETWEEN ? AND ?").arg(ActivityLogQuery::columns));
+                query.addBindValue(from);
+                query.addBindValue(to);
+                if (!query.exec()) {
+                    qDebug() << "Activity feed: fetch failed:" << query.lastError().text();
+                    continue;
+                }
+                QList<ActivityLogQuery::Row> rows;
+                while (query.next()) rows.append(ActivityLogQuery::readRow(query));
+                add(rows);
+            }
+        });
+    });
+}
+
+void ActivityFeed::catchUp() {
+    ScopedDbConnection connection("activity-feed");
+    if (!connection.isOpen()) {
+        qDebug() << "Activity feed: no connection:" << connection.lastError();
+        return;
+    }
+    QSqlQuery query(connection.database());
+    query.setForwardOnly(true);
+    const bool first = !primed.load(std::memory_order_acquire);
+    if (first) {
+        query.prepare(QString("SELECT %1 FROM activity_log ORDER BY timestamp DESC, id DESC LIMIT ?").arg(ActivityLogQuery::columns));
+        query.addBindValue(capacity);
+    } else {
+        qint64 from;
+        {
+            QMutexLocker locker(&writeMutex);
+            from = maxId - catchUpMargin;
+        }
+        query.prepare(QString("SELECT %1 FROM activity_log WHERE id > ? ORDER BY id").arg(ActivityLogQuery::columns));
+        query.addBindValue(from);
+    }
+    if (!query.exec()) {
+        qDebug() << "Activity feed: catch-up failed:" << query.lastError().text();
+        return;
+    }
+    QList<ActivityLogQuery::Row> rows;
+    while (query.next()) rows.append(ActivityLogQuery::readRow(query));
+    if (!first) {
+        add(rows);
+        return;
+    }
+    // Oldest first, so the newest entries are the last to be evicted. With
+    // fewer rows than slots the whole table is held and there is no boundary.
+    std::reverse(rows.begin(), rows.end());
+    Key oldest;
+    if (rows.size() == capacity) {
+        parseTimestamp(rows.first().cursor.section('_', 0, 0), oldest.micros);
+        oldest.id = rows.first().id;
+    }
+    QMutexLocker locker(&writeMutex);
+    addLocked(rows);
+    if (readBoundary() < oldest) setBoundary(oldest);
+    primed.store(true, std::memory_order_release);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "ActivityLogQuery.h"
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <atomic>
+#include <climits>
+#include <memory>
+
+// The most recent activity_log entries, held in memory so the Activity Log
+// tab and /api/activity-log can answer their usual first pages without a
+// query. ActivityLogger adds what this terminal writes; other terminals'
+// entries arrive through NOTIFY activity_log (see activity_feed_setup.sql),
+// and catchUp() re-reads recent ids every minute in case a notification was
+// missed.
+//
+// A fixed ring of activityLog/feedSize (1000) slots. Each slot is a seqlock
+// over plain bytes: the writer (one at a time, under a mutex) bumps the
+// slot's sequence to odd, copies the entry in and bumps it again; readers
+// copy the bytes and retry if the sequence moved. Reads take no lock.
+//
+// The feed vouches for every entry newer than its boundary, the newest
+// (timestamp, id) it has evicted or never loaded. A query is answered from
+// memory only when a full page (and whether there is another) lies above
+// the boundary; anything deeper goes to the database.
+class ActivityFeed {
+public:
+    static ActivityFeed& instance();
+
+    // Memory-only; false when the caller should run ActivityLogQuery instead
+    bool query(const ActivityLogQuery::Filter& filter, QList<ActivityLogQuery::Row>& rows, QString& nextCursor) const;
+
+    void add(const QList<ActivityLogQuery::Row>& rows); // Any thread
+    // GUI thread: subscribes the default connection to activity_log notifications
+    void listen();
+    // Worker thread: loads the latest entries the first time, then re-reads
+    // recent ids. Opens its own connection.
+    void catchUp();
+
+private:
+    ActivityFeed();
+
+    struct Key {
+        qint64 micros = LLONG_MIN; // Timestamp, as if UTC, to the microsecond
+        qint64 id = LLONG_MIN;
+        bool operator<(const Key& other) const { return micros < other.micros || (micros == other.micros && id < other.id); }
+    };
+    // Plain bytes, so a torn read is harmless and just retried. Text past a
+    // field's size is cut and the record marked incomplete.
+    struct Record {
+        Key key;
+        bool complete = true;
+        quint16 sizes[4] = {};
+        char username[64];
+        char action[64];
+        char details[1024];
+        char fields[512];
+    };
+    struct Slot {
+        std::atomic<quint64> sequence{0}; // Odd while being written
+        Record record;
+    };
+
+    static bool parseTimestamp(const QString& text, qint64& micros);
+    bool readSlot(quint64 index, Record& record) const;
+    Key readBoundary() const;
+    void setBoundary(const Key& key); // Writer only
+    void addLocked(const QList<ActivityLogQuery::Row>& rows);
+    bool holds(qint64 from, qint64 to); // Every id in the range is already here
+
+    int capacity;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<quint64> written{0};   // Entries ever added; the next slot is written % capacity
+    std::atomic<bool> primed{false};   // Nothing is answered before the first load
+    std::atomic<quint64> boundarySequence{0};
+    std::atomic<qint64> boundaryMicros{LLONG_MIN};
+    std::atomic<qint64> boundaryId{LLONG_MIN};
+
+    // Writer side, under writeMutex
+    QMutex writeMutex;
+    QList<Key> keys; // Key in each slot
+    QSet<qint64> ids;
+    qint64 maxId = 0;
+    qint64 pendingFrom = 0, pendingTo = -1; // Notified ids still to fetch
+    bool fetchScheduled = false;
+};
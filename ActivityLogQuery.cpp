@@ -0,0 +1,93 @@
+#include "ActivityLogQuery.h"
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantList>
+
+// "<timestamp to the microsecond>_<id>", e.g. 2024-01-15T10:30:00.123456_4521.
+// The timestamp stays text end to end; QDateTime would drop the microseconds.
+static const QRegularExpression cursorPattern(R"(^(\d{4}-\d\d-\d\dT\d\d:\d\d:\d\d(?:\.\d{1,6})?)_(\d+)$)");
+
+const char *ActivityLogQuery::columns =
+    "id, username, action, details, details_json::text, timestamp, to_char(timestamp, 'YYYY-MM-DD\"T\"HH24:MI:SS.US')";
+
+ActivityLogQuery::Row ActivityLogQuery::readRow(const QSqlQuery& query) {
+    Row row;
+    row.id = query.value(0).toLongLong();
+    row.username = query.value(1).toString();
+    row.action = query.value(2).toString();
+    row.details = query.value(3).toString();
+    row.fields = QJsonDocument::fromJson(query.value(4).toByteArray()).object();
+    row.timestamp = query.value(5).toDateTime();
+    row.cursor = query.value(6).toString() + "_" + QString::number(row.id);
+    return row;
+}
+
+bool ActivityLogQuery::isValidCursor(const QString& cursor) {
+    return cursorPattern.match(cursor).hasMatch();
+}
+
+bool ActivityLogQuery::query(const QSqlDatabase& db, const Filter& filter, QList<Row>& rows, QString& nextCursor,
+                             QString* error) {
+    QStringList where;
+    QVariantList binds;
+    if (!filter.username.isEmpty()) {
+        where << "username = ?";
+        binds << filter.username;
+    }
+    if (!filter.action.isEmpty()) {
+        where << "action = ?";
+        binds << filter.action;
+    }
+    if (filter.from.isValid()) {
+        where << "timestamp >= ?";
+        binds << filter.from;
+    }
+    if (filter.to.isValid()) {
+        where << "timestamp < ?";
+        binds << filter.to;
+    }
+    QJsonObject contains;
+    if (filter.saleId > 0) contains.insert("sale_id", filter.saleId);
+    if (filter.productId > 0) contains.insert("product_id", filter.productId);
+    if (!filter.product.isEmpty()) contains.insert("product", filter.product);
+    if (!contains.isEmpty()) {
+        where << "details_json @> CAST(? AS jsonb)";
+        binds << QString::fromUtf8(QJsonDocument(contains).toJson(QJsonDocument::Compact));
+    }
+    if (!filter.cursor.isEmpty()) {
+        const QRegularExpressionMatch match = cursorPattern.match(filter.cursor);
+        if (!match.hasMatch()) {
+            if (error) *error = "Invalid cursor";
+            return false;
+        }
+        where << "(timestamp, id) < (CAST(? AS timestamp), ?)";
+        binds << match.captured(1) << match.captured(2).toLongLong();
+    }
+    const int limit = qBound(1, filter.limit, maxLimit);
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    // One row past the page tells whether there is another page
+    query.prepare(QString("SELECT %1 FROM activity_log %2 ORDER BY timestamp DESC, id DESC LIMIT ?")
+                      .arg(columns, where.isEmpty() ? QString() : "WHERE " + where.join(" AND ")));
+    for (const QVariant& value : binds) query.addBindValue(value);
+    query.addBindValue(limit + 1);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    rows.clear();
+    nextCursor.clear();
+    while (query.next()) {
+        if (rows.size() == limit) {
+            nextCursor = rows.last().cursor;
+            break;
+        }
+        rows.append(readRow(query));
+    }
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <QString>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+#include <QSqlDatabase>
+
+class QSqlQuery;
+
+// Filtered, paged reads of activity_log, newest first. Each filter has an
+// index to walk: username and action lead (…, timestamp, id) indexes, and
+// sale and product lookups are a containment test against the GIN index on
+// details_json. Pages continue from a keyset cursor (the last row's exact
+// timestamp and id) instead of an OFFSET, so later pages cost the same as
+// the first and rows logged meanwhile don't shift them.
+class ActivityLogQuery {
+public:
+    struct Filter {
+        QString username;     // Empty for everyone
+        QString action;       // Empty for every action
+        QDateTime from;       // Inclusive; invalid for no lower bound
+        QDateTime to;         // Exclusive; invalid for no upper bound
+        qint64 saleId = 0;    // details_json sale_id, 0 for any
+        qint64 productId = 0; // details_json product_id, 0 for any
+        QString product;      // details_json product (name), empty for any
+        QString cursor;       // Row::cursor of the previous page's last row
+        int limit = 100;
+    };
+    struct Row {
+        qint64 id = 0;
+        QString username;
+        QString action;
+        QString details;
+        QJsonObject fields; // details_json
+        QDateTime timestamp;
+        QString cursor;
+    };
+    static constexpr int maxLimit = 500;
+
+    // Column list for readRow(), for other code that reads or inserts
+    // activity_log rows (SELECT and RETURNING)
+    static const char *columns;
+    static Row readRow(const QSqlQuery& query);
+
+    static bool isValidCursor(const QString& cursor);
+    // nextCursor is left empty on the last page. Returns false on a bad
+    // cursor or a database error.
+    static bool query(const QSqlDatabase& db, const Filter& filter, QList<Row>& rows, QString& nextCursor,
+                      QString* error = nullptr);
+};
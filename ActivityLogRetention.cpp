@@ -0,0 +1,154 @@
+#include "ActivityLogRetention.h"
+#include "DbConnection.h"
+#include "GzipFileWriter.h"
+#include "PgCopy.h"
+#include <QDate>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QList>
+#include <QSettings>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+
+// Moves one month's entries out of activity_log_default: into a new partition,
+// or back into the month's table if it was retired but only detached. Until
+// the month has its own partition, ensure_monthly_partitions cannot create it.
+static bool drainMonth(QSqlDatabase& db, const QDate& month) {
+    QSqlQuery query(db);
+    const QString partition = "activity_log_" + month.toString("yyyyMM");
+    const QString from = month.toString(Qt::ISODate);
+    const QString to = month.addMonths(1).toString(Qt::ISODate);
+    auto fail = [&](const QString& reason) {
+        qDebug() << "Activity log: could not move default partition entries into" << partition << ":" << reason;
+        db.rollback();
+        return false;
+    };
+    if (!db.transaction()) return fail(db.lastError().text());
+    if (!query.exec("SET LOCAL lock_timeout = '5s'")
+        || !query.exec("LOCK TABLE activity_log_default IN EXCLUSIVE MODE")
+        || !query.exec(QString("CREATE TEMP TABLE activity_log_moving ON COMMIT DROP AS "
+                               "WITH moved AS (DELETE FROM activity_log_default WHERE timestamp >= '%1' AND timestamp < '%2' RETURNING *) "
+                               "SELECT * FROM moved").arg(from, to))
+        || !query.exec(QString("SELECT to_regclass('%1') IS NOT NULL").arg(partition)) || !query.next()) {
+        return fail(query.lastError().text());
+    }
+    if (!query.value(0).toBool()
+        && !query.exec(QString("CREATE TABLE %1 PARTITION OF activity_log FOR VALUES FROM ('%2') TO ('%3')").arg(partition, from, to))) {
+        return fail(query.lastError().text());
+    }
+    if (!query.exec(QString("INSERT INTO %1 SELECT * FROM activity_log_moving").arg(partition))) return fail(query.lastError().text());
+    const int rows = query.numRowsAffected();
+    if (!db.commit()) return fail(db.lastError().text());
+    qDebug() << "Activity log: moved" << rows << "entries from the default partition into" << partition;
+    return true;
+}
+
+// Archives (when archiveDirectory is set) and detaches one partition in a
+// single transaction. The partition is share-locked while it is copied, so
+// no late insert can slip in between the copy and the detach; inserts into
+// the current month are unaffected. The final file name only appears once
+// the copy is complete.
+static bool retire(QSqlDatabase& db, const QString& partition, const QString& archiveDirectory) {
+    QSqlQuery query(db);
+    // A month retired before can come back through the default partition; keep the earlier archive
+    QString target;
+    if (!archiveDirectory.isEmpty()) {
+        target = QDir(archiveDirectory).filePath(partition + ".copy.gz");
+        for (int n = 2; QFile::exists(target); ++n) target = QDir(archiveDirectory).filePath(QString("%1-%2.copy.gz").arg(partition).arg(n));
+    }
+    const QString partial = target + ".part";
+    auto fail = [&](const QString& reason) {
+        qDebug() << "Activity log: could not retire" << partition << ":" << reason;
+        db.rollback();
+        if (!target.isEmpty()) QFile::remove(partial);
+        return false;
+    };
+    if (!db.transaction()) return fail(db.lastError().text());
+    // Detaching locks activity_log itself; give up rather than hold up logging
+    if (!query.exec("SET LOCAL lock_timeout = '5s'")
+        || !query.exec(QString("LOCK TABLE %1 IN SHARE MODE").arg(partition))) {
+        return fail(query.lastError().text());
+    }
+    if (!target.isEmpty()) {
+        GzipFileWriter writer;
+        if (!writer.open(partial, 6)) return fail("Could not write " + partial + ": " + writer.errorString());
+        bool written = true;
+        qint64 rows = 0;
+        PgCopy copy(db);
+        const bool copied = copy.copyOut(QString("COPY (SELECT id, username, action, details, details_json, timestamp FROM %1 ORDER BY id) TO STDOUT").arg(partition),
+                                         [&](const char *data, int size) {
+                                             ++rows;
+                                             written = writer.write(data, size);
+                                             return written;
+                                         });
+        if (!written || !writer.finish()) return fail("Could not write " + partial + ": " + writer.errorString());
+        if (!copied) return fail(copy.lastError());
+        if (!QFile::rename(partial, target)) return fail("Could not rename " + partial);
+        qDebug() << "Activity log: archived" << rows << "rows to" << target;
+    }
+    if (!query.exec(QString("ALTER TABLE activity_log DETACH PARTITION %1").arg(partition))
+        || (!target.isEmpty() && !query.exec("DROP TABLE " + partition))) {
+        return fail(query.lastError().text());
+    }
+    if (!db.commit()) return fail(db.lastError().text());
+    qDebug() << "Activity log:" << (target.isEmpty() ? "detached" : "dropped") << partition;
+    return true;
+}
+
+void ActivityLogRetention::runMaintenance() {
+    ScopedDbConnection connection("activity-log-retention");
+    if (!connection.isOpen()) {
+        qDebug() << "Activity log maintenance: no connection:" << connection.lastError();
+        return;
+    }
+    QSqlDatabase db = connection.database();
+    QSqlQuery query(db);
+    // Usually empty, so this is a cheap check
+    QList<QDate> strays;
+    if (query.exec("SELECT DISTINCT to_char(date_trunc('month', timestamp), 'YYYY-MM-DD') FROM activity_log_default")) {
+        while (query.next()) strays << QDate::fromString(query.value(0).toString(), Qt::ISODate);
+    } else {
+        qDebug() << "Failed to read the activity log default partition:" << query.lastError().text();
+    }
+    for (const QDate& month : strays) {
+        if (!drainMonth(db, month)) break; // Try again next hour
+    }
+    query.prepare("SELECT ensure_monthly_partitions('activity_log', ?)");
+    query.addBindValue(partitionMonthsAhead);
+    if (!query.exec()) {
+        qDebug() << "Failed to create activity log partitions:" << query.lastError().text();
+    }
+
+    QSettings settings;
+    const int retentionMonths = settings.value("activityLog/retentionMonths", 12).toInt();
+    if (retentionMonths <= 0) return;
+    const QString archiveDirectory = settings.value("activityLog/archiveDirectory").toString();
+    if (!archiveDirectory.isEmpty() && !QDir().mkpath(archiveDirectory)) {
+        qDebug() << "Activity log: archive folder" << archiveDirectory << "is not writable";
+        return;
+    }
+    if (!query.exec("SELECT pg_try_advisory_lock(hashtext('activity_log_retention'))") || !query.next()
+        || !query.value(0).toBool()) {
+        return; // Another terminal is at it
+    }
+    // Partition names end in YYYYMM, so they sort by month; the default partition stays
+    query.prepare("SELECT c.relname FROM pg_inherits i JOIN pg_class c ON c.oid = i.inhrelid "
+                  "WHERE i.inhparent = 'activity_log'::regclass AND c.relname <> 'activity_log_default' "
+                  "AND c.relname < 'activity_log_' || to_char(date_trunc('month', now()) - make_interval(months => ?), 'YYYYMM') "
+                  "ORDER BY c.relname");
+    query.addBindValue(retentionMonths);
+    QStringList expired;
+    if (query.exec()) {
+        while (query.next()) expired << query.value(0).toString();
+    } else {
+        qDebug() << "Failed to list activity log partitions:" << query.lastError().text();
+    }
+    for (const QString& partition : expired) {
+        if (!retire(db, partition, archiveDirectory)) break; // Try again next hour
+    }
+    query.exec("SELECT pg_advisory_unlock(hashtext('activity_log_retention'))");
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <QString>
+
+// Upkeep for the monthly activity_log partitions. The coming months are
+// created ahead of time so inserts never wait on DDL, and months older than
+// activityLog/retentionMonths (12; 0 keeps everything) leave the table, so
+// inserts and the latest-entries reads only ever touch a year of data.
+// Entries that landed in activity_log_default because their month had no
+// partition are moved into one first.
+//
+// With activityLog/archiveDirectory set, an expired month is written there as
+// activity_log_YYYYMM.copy.gz (COPY text format: id, username, action,
+// details, details_json, timestamp) and dropped. Without it the partition is only detached
+// and stays in the database as an ordinary table.
+class ActivityLogRetention {
+public:
+    // Opens its own connection, so it can run on a worker thread. Only one
+    // terminal retires partitions at a time.
+    static void runMaintenance();
+};
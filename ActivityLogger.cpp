@@ -0,0 +1,258 @@
+#include "ActivityLogger.h"
+#include "ActivityFeed.h"
+#include "DbConnection.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSettings>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QThread>
+#include <QVariant>
+#include <memory>
+
+// How often the writer retries the spill file while nothing new is logged
+static const int spillRetryMs = 30 * 1000;
+
+ActivityLogger& ActivityLogger::instance() {
+    static ActivityLogger logger;
+    return logger;
+}
+
+ActivityLogger::ActivityLogger() : head(&stub), tail(&stub) {
+    QSettings settings;
+    batchSize = qBound(1, settings.value("activityLog/batchSize", 200).toInt(), 1000);
+    flushMs = qMax(50, settings.value("activityLog/flushMilliseconds", 1000).toInt());
+    spillMaxBytes = qMax<qint64>(1, settings.value("activityLog/spillMaxMB", 16).toLongLong()) * 1024 * 1024;
+    const QString folder = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(folder);
+    spillPath = QDir(folder).filePath("activity_log_spill.jsonl");
+    thread = QThread::create([this] { run(); });
+    thread->start();
+}
+
+ActivityLogger::~ActivityLogger() {
+    shutdown();
+    while (Node *node = pop()) delete node;
+}
+
+void ActivityLogger::push(Node *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+}
+
+// Null when empty, or when a producer has swapped itself in but not linked yet
+ActivityLogger::Node *ActivityLogger::pop() {
+    Node *first = tail;
+    Node *next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+        if (!next) return nullptr;
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+        tail = next;
+        return first;
+    }
+    if (first != head.load(std::memory_order_acquire)) return nullptr;
+    // first is the last node; put the stub behind it so it can be taken
+    push(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next) {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
+
+void ActivityLogger::log(const QString& username, const QString& action, const QString& details,
+                         const QJsonObject& fields) {
+    Node *node = new Node;
+    node->entry = {username, action, details, fields, QDateTime::currentDateTime()};
+    push(node);
+    if (pending.fetch_add(1, std::memory_order_relaxed) + 1 == batchSize) wake.release();
+}
+
+void ActivityLogger::flushSoon() {
+    wake.release();
+}
+
+void ActivityLogger::flushThen(std::function<void()> done) {
+    if (!thread) {
+        QMetaObject::invokeMethod(QCoreApplication::instance(), std::move(done), Qt::QueuedConnection);
+        return;
+    }
+    {
+        QMutexLocker locker(&waitersMutex);
+        waiters.append(std::move(done));
+    }
+    wake.release();
+}
+
+void ActivityLogger::shutdown() {
+    if (!thread) return;
+    stopping = true;
+    wake.release();
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+}
+
+void ActivityLogger::run() {
+    std::unique_ptr<ScopedDbConnection> connection;
+    QDateTime lastAttempt;
+    // Writes a batch, or spills it if the database is unreachable
+    auto write = [&](const QList<Entry>& entries) {
+        lastAttempt = QDateTime::currentDateTime();
+        if (!connection || !connection->isOpen()) connection.reset(new ScopedDbConnection("activity-log"));
+        if (connection->isOpen()) {
+            QSqlDatabase db = connection->database();
+            QString error;
+            if (replaySpill(db) && (entries.isEmpty() || flush(db, entries, error))) return;
+            connection.reset(); // Reconnect for the next batch
+        }
+        spill(entries);
+    };
+
+    bool stop = false;
+    while (!stop) {
+        wake.tryAcquire(1, flushMs);
+        stop = stopping.load();
+        // Taken before draining, so each waiter's entries are already queued
+        QList<std::function<void()>> flushed;
+        {
+            QMutexLocker locker(&waitersMutex);
+            flushed.swap(waiters);
+        }
+        QList<Entry> batch;
+        // On the way out, wait for producers that are half way through a push
+        while (true) {
+            Node *node = pop();
+            if (!node) {
+                if (stop && pending.load() > 0) {
+                    QThread::yieldCurrentThread();
+                    continue;
+                }
+                break;
+            }
+            batch << std::move(node->entry);
+            delete node;
+            pending.fetch_sub(1, std::memory_order_relaxed);
+            if (batch.size() == batchSize) {
+                write(batch);
+                batch.clear();
+            }
+        }
+        if (!batch.isEmpty()) {
+            write(batch);
+        } else if (QFile::exists(spillPath) && (lastAttempt.isNull() || lastAttempt.msecsTo(QDateTime::currentDateTime()) > spillRetryMs)) {
+            write(batch);
+        }
+        for (std::function<void()>& done : flushed)
+            QMetaObject::invokeMethod(QCoreApplication::instance(), std::move(done), Qt::QueuedConnection);
+    }
+    if (dropped > 0) qDebug() << "Activity log: dropped" << dropped << "entries because the spill file was full";
+}
+
+// One multi-row INSERT. If it fails while the server still answers, the batch
+// itself is at fault (a deleted user, say); its rows are retried one at a time
+// and the ones that still fail are dropped. Returns false only when the
+// database is unreachable.
+bool ActivityLogger::flush(QSqlDatabase& db, const QList<Entry>& entries, QString& error) {
+    auto insert = [&db](const QList<Entry>& rows, QString& insertError) {
+        QStringList values;
+        for (int i = 0; i < rows.size(); ++i) values << "(?, ?, ?, CAST(? AS jsonb), ?)";
+        QSqlQuery query(db);
+        // The written rows, ids included, go straight into the recent activity feed
+        query.prepare(QString("INSERT INTO activity_log (username, action, details, details_json, timestamp) VALUES %1 RETURNING %2")
+                          .arg(values.join(", "), ActivityLogQuery::columns));
+        for (const Entry& entry : rows) {
+            query.addBindValue(entry.username);
+            query.addBindValue(entry.action);
+            query.addBindValue(entry.details);
+            query.addBindValue(QString::fromUtf8(QJsonDocument(entry.fields).toJson(QJsonDocument::Compact)));
+            query.addBindValue(entry.loggedAt);
+        }
+        if (query.exec()) {
+            QList<ActivityLogQuery::Row> written;
+            while (query.next()) written.append(ActivityLogQuery::readRow(query));
+            ActivityFeed::instance().add(written);
+            return true;
+        }
+        insertError = query.lastError().text();
+        return false;
+    };
+    if (insert(entries, error)) return true;
+    QSqlQuery probe(db);
+    if (!probe.exec("SELECT 1")) return false;
+    for (const Entry& entry : entries) {
+        QString rowError;
+        if (!insert({entry}, rowError)) qDebug() << "Failed to log activity" << entry.action << ":" << rowError;
+    }
+    return true;
+}
+
+void ActivityLogger::spill(const QList<Entry>& entries) {
+    QFile file(spillPath);
+    if (!file.open(QIODevice::Append)) {
+        dropped += entries.size();
+        qDebug() << "Activity log: could not spill to" << spillPath << ":" << file.errorString();
+        return;
+    }
+    QByteArray data;
+    for (const Entry& entry : entries) {
+        const QJsonObject line{{"username", entry.username}, {"action", entry.action}, {"details", entry.details},
+                               {"fields", entry.fields}, {"loggedAt", entry.loggedAt.toString(Qt::ISODateWithMs)}};
+        const QByteArray json = QJsonDocument(line).toJson(QJsonDocument::Compact) + "\n";
+        if (file.size() + data.size() + json.size() > spillMaxBytes) {
+            ++dropped;
+            continue;
+        }
+        data += json;
+    }
+    file.write(data);
+}
+
+// Writes the spill file back in batches, oldest first. Returns false, leaving
+// what's left in the file, if the database goes away part way.
+bool ActivityLogger::replaySpill(QSqlDatabase& db) {
+    QFile file(spillPath);
+    if (!file.exists()) return true;
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Activity log: could not read" << spillPath << ":" << file.errorString();
+        return true;
+    }
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    file.close();
+    QList<Entry> batch;
+    int written = 0; // Lines already in the database
+    for (int i = 0; i < lines.size(); ++i) {
+        const QJsonObject line = QJsonDocument::fromJson(lines[i]).object();
+        if (!line.isEmpty()) {
+            batch << Entry{line.value("username").toString(), line.value("action").toString(), line.value("details").toString(),
+                           line.value("fields").toObject(), QDateTime::fromString(line.value("loggedAt").toString(), Qt::ISODateWithMs)};
+        }
+        if (batch.size() < batchSize && i + 1 < lines.size()) continue;
+        QString error;
+        if (!batch.isEmpty() && !flush(db, batch, error)) {
+            QSaveFile rest(spillPath);
+            if (rest.open(QIODevice::WriteOnly)) {
+                rest.write(lines.mid(written).join('\n'));
+                rest.commit();
+            }
+            return false;
+        }
+        batch.clear();
+        written = i + 1;
+    }
+    QFile::remove(spillPath);
+    qDebug() << "Activity log: wrote back spilled entries";
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <QString>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSqlDatabase>
+#include <atomic>
+#include <functional>
+
+class QThread;
+
+// Writes activity_log entries off the calling thread. log() only appends to a
+// lock-free multi-producer queue; a background thread drains it into
+// multi-row INSERTs once batchSize entries are waiting or every flush
+// interval, whichever comes first. Entries keep the time they were logged,
+// not the time they were written.
+//
+// While the database can't be reached, batches go to a spill file in the app
+// data folder instead (bounded by activityLog/spillMaxMB; entries beyond it
+// are dropped and counted in qDebug). The spill file is written back, oldest
+// first, as soon as a flush succeeds again. shutdown() drains the queue and
+// stops the thread; main() calls it after the event loop ends.
+//
+// Settings (QSettings): activityLog/batchSize (200),
+// activityLog/flushMilliseconds (1000), activityLog/spillMaxMB (16).
+class ActivityLogger {
+public:
+    struct Entry {
+        QString username;
+        QString action;
+        QString details;
+        QJsonObject fields; // Stored as details_json for indexed lookups
+        QDateTime loggedAt;
+    };
+
+    static ActivityLogger& instance();
+
+    void log(const QString& username, const QString& action, const QString& details,
+             const QJsonObject& fields = QJsonObject()); // Never blocks
+    void flushSoon();  // Wakes the writer without waiting for a full batch
+    // Like flushSoon(), then runs done on the GUI thread once everything this
+    // thread logged before the call is written (or spilled)
+    void flushThen(std::function<void()> done);
+    void shutdown();   // Blocks until everything queued is written or spilled
+
+private:
+    ActivityLogger();
+    ~ActivityLogger();
+
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        Entry entry;
+    };
+    // Vyukov's intrusive MPSC queue: producers swap themselves in at head,
+    // the writer thread alone walks from tail
+    void push(Node *node);
+    Node *pop();
+
+    void run();
+    bool flush(QSqlDatabase& db, const QList<Entry>& entries, QString& error);
+    void spill(const QList<Entry>& entries);
+    bool replaySpill(QSqlDatabase& db);
+
+    std::atomic<Node*> head;
+    Node *tail;
+    Node stub;
+    std::atomic<int> pending{0};
+    std::atomic<bool> stopping{false};
+    QSemaphore wake;
+    QMutex waitersMutex;
+    QList<std::function<void()>> waiters; // flushThen() callbacks for the next pass
+    QThread *thread = nullptr;
+    int batchSize;
+    int flushMs;
+    qint64 spillMaxBytes;
+    QString spillPath;
+    qint64 dropped = 0; // Writer thread only
+};
@@ -0,0 +1,318 @@
+#include "BackupManager.h"
+#include "ReportJobRunner.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QVariant>
+#include <zlib.h>
+#include <functional>
+
+// Marks a backup that passed verification; only these count towards backup/keep
+static const char *verifiedMarker = "backup_verified";
+static const char *backupPrefix = "MonsterDB_";
+
+// Reads a gzip file to the end so its CRC and length are checked
+static bool verifyGzip(const QString& path, QString& error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        error = "zlib initialisation failed";
+        return false;
+    }
+    QByteArray input;
+    QByteArray output(256 * 1024, Qt::Uninitialized);
+    int result = Z_OK;
+    while (true) {
+        if (stream.avail_in == 0) {
+            input = file.read(256 * 1024);
+            if (input.isEmpty()) break;
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = uInt(input.size());
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = uInt(output.size());
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) {
+            if (stream.avail_in == 0 && file.atEnd()) break;
+            inflateReset(&stream); // Another gzip member follows
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        error = stream.msg ? QString::fromLatin1(stream.msg) : QString("truncated");
+        return false;
+    }
+    return true;
+}
+
+// host:port:database:user:password, with ':' and '\' escaped
+static QString passFileField(QString text) {
+    return text.replace("\\", "\\\\").replace(":", "\\:");
+}
+
+BackupManager::Options BackupManager::options() {
+    QSettings settings;
+    Options options;
+    options.directory = settings.value("backup/directory", QDir::homePath() + "/MonsterDB_backups").toString();
+    options.jobs = qMax(1, settings.value("backup/jobs", qBound(1, QThread::idealThreadCount(), 4)).toInt());
+    options.compression = settings.value("backup/compression", "6").toString();
+    options.keep = qMax(1, settings.value("backup/keep", 7).toInt());
+    options.pgDumpPath = settings.value("backup/pgDumpPath", "pg_dump").toString();
+    options.baselineDays = qMax(1, settings.value("backup/baselineDays", 7).toInt());
+    options.keepChains = qMax(1, settings.value("backup/keepChains", 2).toInt());
+    const QFileInfo pgDump(options.pgDumpPath);
+    options.pgRestorePath = pgDump.path() == "." ? QString("pg_restore")
+                                                 : pgDump.dir().filePath(QString(pgDump.fileName()).replace("pg_dump", "pg_restore"));
+    return options;
+}
+
+QStringList BackupManager::backups(const QString& directory) {
+    QStringList result;
+    const QDir root(directory);
+    // Names carry the start time, so name order is age order
+    for (const QString& name : root.entryList({QString(backupPrefix) + "*"}, QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Reversed)) {
+        if (QFile::exists(root.filePath(name + "/" + verifiedMarker))) result << root.filePath(name);
+    }
+    return result;
+}
+
+// Points libpq at a temporary password file holding db's credentials, readable
+// by the current user only; the environment and command line never see it
+static bool passwordEnvironment(const QSqlDatabase& db, QTemporaryFile& passFile, QProcessEnvironment& env, QString& error) {
+    if (!passFile.open()) {
+        error = "Could not create a temporary password file: " + passFile.errorString();
+        return false;
+    }
+    passFile.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    const QString host = db.hostName().isEmpty() ? QString("localhost") : db.hostName();
+    const QString port = QString::number(db.port() > 0 ? db.port() : 5432);
+    passFile.write(QStringList({passFileField(host), port, "*", passFileField(db.userName()),
+                                passFileField(db.password())}).join(':').toUtf8() + "\n");
+    passFile.flush();
+    env = QProcessEnvironment::systemEnvironment();
+    env.remove("PGPASSWORD");
+    env.insert("PGPASSFILE", QDir::toNativeSeparators(passFile.fileName()));
+    return true;
+}
+
+static QStringList connectionArguments(const QSqlDatabase& db) {
+    return {"-h", db.hostName().isEmpty() ? QString("localhost") : db.hostName(),
+            "-p", QString::number(db.port() > 0 ? db.port() : 5432), "-U", db.userName(), "--no-password"};
+}
+
+// Feeds the lines a --verbose pg_dump/pg_restore writes to stderr to onLine until
+// the process exits; kills it if the job is cancelled. Returns false if cancelled.
+static bool followProcess(QProcess& process, ReportJobContext& context, const std::function<void(const QString&)>& onLine) {
+    QByteArray pending;
+    while (true) {
+        const bool running = process.state() != QProcess::NotRunning;
+        if (running) process.waitForReadyRead(250);
+        pending += process.readAllStandardError();
+        int newline;
+        while ((newline = pending.indexOf('\n')) >= 0) {
+            const QString line = QString::fromLocal8Bit(pending.left(newline)).trimmed();
+            pending.remove(0, newline + 1);
+            if (!line.isEmpty()) onLine(line);
+        }
+        if (context.isCancelled()) {
+            process.kill();
+            process.waitForFinished();
+            return false;
+        }
+        if (!running) return true;
+    }
+}
+
+bool BackupManager::dump(ReportJobContext& context, const Options& options, const QString& target, const QString& snapshot,
+                         QString& message, int* tableCount) {
+    const QSqlDatabase db = context.database();
+    auto fail = [&](const QString& reason) {
+        QDir(target).removeRecursively();
+        message = reason;
+        return false;
+    };
+
+    // Tables whose data pg_dump will write, for the progress count
+    int tables = 0;
+    QSqlQuery count(db);
+    if (count.exec("SELECT COUNT(*) FROM pg_class c JOIN pg_namespace n ON n.oid = c.relnamespace "
+                   "WHERE c.relkind = 'r' AND n.nspname NOT IN ('pg_catalog', 'information_schema') "
+                   "AND n.nspname NOT LIKE 'pg_toast%'") && count.next()) {
+        tables = count.value(0).toInt();
+    }
+
+    QTemporaryFile passFile;
+    QProcessEnvironment env;
+    if (!passwordEnvironment(db, passFile, env, message)) return false;
+    QStringList arguments = connectionArguments(db);
+    arguments << "--format=directory" << "--jobs=" + QString::number(options.jobs)
+              << "--compress=" + options.compression << "--verbose" << "--file=" + target;
+    if (!snapshot.isEmpty()) arguments << "--snapshot=" + snapshot;
+    arguments << db.databaseName();
+    QProcess dump;
+    dump.setProcessEnvironment(env);
+    context.setStatus("Dumping");
+    dump.start(options.pgDumpPath, arguments);
+    if (!dump.waitForStarted()) {
+        message = "Could not start pg_dump. Make sure PostgreSQL tools are installed and in your PATH, or set backup/pgDumpPath.";
+        return false;
+    }
+    // pg_dump --verbose logs each table as its data is written
+    QStringList log;
+    int dumped = 0;
+    context.setProgress(0, tables);
+    const bool finished = followProcess(dump, context, [&](const QString& line) {
+        if (line.contains("dumping contents of table")) {
+            context.setProgress(++dumped, qMax(tables, dumped));
+        } else {
+            log << line;
+            if (log.size() > 20) log.removeFirst();
+        }
+    });
+    if (!finished) return fail(QString());
+    if (dump.exitStatus() != QProcess::NormalExit || dump.exitCode() != 0) {
+        return fail("pg_dump failed.\n\n" + log.join('\n'));
+    }
+
+    // Verify: the table of contents must list, and each table's data must be intact
+    context.setStatus("Verifying");
+    QProcess list;
+    list.start(options.pgRestorePath, {"--list", target});
+    if (!list.waitForFinished(-1) || list.exitStatus() != QProcess::NormalExit || list.exitCode() != 0) {
+        return fail("Backup verification failed: pg_restore could not read the backup.\n\n"
+                    + QString::fromLocal8Bit(list.readAllStandardError()));
+    }
+    static const QRegularExpression dataEntry("^(\\d+); \\d+ \\d+ TABLE DATA ");
+    QStringList dataIds;
+    for (const QByteArray& line : list.readAllStandardOutput().split('\n')) {
+        const QRegularExpressionMatch match = dataEntry.match(QString::fromUtf8(line));
+        if (match.hasMatch()) dataIds << match.captured(1);
+    }
+    const QDir backupDir(target);
+    for (int i = 0; i < dataIds.size(); ++i) {
+        const QStringList files = backupDir.entryList({dataIds[i] + ".dat*"}, QDir::Files);
+        if (files.isEmpty()) return fail(QString("Backup verification failed: data file %1.dat is missing.").arg(dataIds[i]));
+        QString error;
+        if (files.first().endsWith(".gz") && !verifyGzip(backupDir.filePath(files.first()), error)) {
+            return fail(QString("Backup verification failed: %1 is corrupt (%2).").arg(files.first(), error));
+        }
+        context.setProgress(i + 1, dataIds.size());
+        if (context.isCancelled()) return fail(QString());
+    }
+    QFile marker(backupDir.filePath(verifiedMarker));
+    if (!marker.open(QIODevice::WriteOnly) || marker.write(QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8() + "\n") < 0) {
+        return fail("Could not write to the backup folder: " + marker.errorString());
+    }
+    marker.close();
+    if (tableCount) *tableCount = dataIds.size();
+    return true;
+}
+
+bool BackupManager::run(ReportJobContext& context, const Options& options, QString& message) {
+    if (!QDir().mkpath(options.directory)) {
+        message = "Could not create the backup folder " + options.directory;
+        return false;
+    }
+    const QDateTime started = QDateTime::currentDateTime();
+    const QString target = QDir(options.directory).filePath(backupPrefix + started.toString("yyyyMMdd_HHmmss"));
+    int tables = 0;
+    if (!dump(context, options, target, QString(), message, &tables)) return false;
+
+    // Rotate: keep the newest verified backups, and clear out day-old leftovers of failed runs
+    context.setStatus("Rotating");
+    const QStringList verified = backups(options.directory);
+    for (int i = options.keep; i < verified.size(); ++i) QDir(verified[i]).removeRecursively();
+    const QDir root(options.directory);
+    for (const QFileInfo& info : root.entryInfoList({QString(backupPrefix) + "*"}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (!QFile::exists(info.filePath() + "/" + verifiedMarker) && info.lastModified().secsTo(started) > 24 * 60 * 60) {
+            QDir(info.filePath()).removeRecursively();
+        }
+    }
+
+    qint64 bytes = 0;
+    QDirIterator files(target, QDir::Files);
+    while (files.hasNext()) {
+        files.next();
+        bytes += files.fileInfo().size();
+    }
+    message = QString("%1\n%2 tables, %3 MB in %4 s")
+                  .arg(QDir::toNativeSeparators(target))
+                  .arg(tables)
+                  .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1)
+                  .arg(started.secsTo(QDateTime::currentDateTime()));
+    return true;
+}
+
+bool BackupManager::isVerified(const QString& backup) {
+    return QFile::exists(QDir(backup).filePath(verifiedMarker));
+}
+
+bool BackupManager::restore(ReportJobContext& context, const Options& options, const QString& backup, const QString& database,
+                            QString& message) {
+    QSqlDatabase db = context.database();
+    const QString name = db.driver()->escapeIdentifier(database, QSqlDriver::TableName);
+    QSqlQuery create(db);
+    if (!create.exec("CREATE DATABASE " + name)) {
+        message = QString("Could not create database %1: %2").arg(database, create.lastError().text());
+        return false;
+    }
+    auto fail = [&](const QString& reason) {
+        QSqlQuery(db).exec("DROP DATABASE IF EXISTS " + name);
+        message = reason;
+        return false;
+    };
+
+    QProcess list;
+    list.start(options.pgRestorePath, {"--list", backup});
+    if (!list.waitForFinished(-1) || list.exitStatus() != QProcess::NormalExit || list.exitCode() != 0) {
+        return fail("pg_restore could not read the backup.\n\n" + QString::fromLocal8Bit(list.readAllStandardError()));
+    }
+    const int tables = int(list.readAllStandardOutput().count(" TABLE DATA "));
+
+    QTemporaryFile passFile;
+    QProcessEnvironment env;
+    if (!passwordEnvironment(db, passFile, env, message)) return fail(message);
+    QProcess restore;
+    restore.setProcessEnvironment(env);
+    context.setStatus("Restoring");
+    restore.start(options.pgRestorePath, connectionArguments(db) << "--dbname=" + database << "--no-owner"
+                                             << "--jobs=" + QString::number(options.jobs) << "--exit-on-error"
+                                             << "--verbose" << backup);
+    if (!restore.waitForStarted()) {
+        return fail("Could not start pg_restore. Make sure PostgreSQL tools are installed and in your PATH, or set backup/pgDumpPath.");
+    }
+    QStringList log;
+    int restored = 0;
+    context.setProgress(0, tables);
+    const bool finished = followProcess(restore, context, [&](const QString& line) {
+        if (line.contains("processing data for table")) {
+            context.setProgress(++restored, qMax(tables, restored));
+        } else {
+            log << line;
+            if (log.size() > 20) log.removeFirst();
+        }
+    });
+    if (!finished) return fail(QString());
+    if (restore.exitStatus() != QProcess::NormalExit || restore.exitCode() != 0) {
+        return fail("pg_restore failed.\n\n" + log.join('\n'));
+    }
+    message = QString("Restored %1 tables into %2").arg(tables).arg(database);
+    return true;
+}
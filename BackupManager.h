@@ -0,0 +1,56 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+
+class ReportJobContext;
+
+// Database backups for the Reports screen. pg_dump writes the directory
+// format with several parallel workers and compressed table data, so a large
+// database backs up in a fraction of the time a single plain-SQL dump takes.
+// Each backup is then verified: pg_restore must be able to list it, and every
+// table's data file must be present and decompress cleanly. Verified backups
+// beyond the keep count are deleted, oldest first.
+//
+// The password reaches pg_dump through a temporary password file readable by
+// the current user only, never through the environment or the command line.
+// pg_restore connects the same way.
+//
+// Settings (QSettings): backup/directory (~/MonsterDB_backups), backup/jobs
+// (parallel workers, up to 4 by default), backup/compression (6; passed to
+// pg_dump -Z, so "zstd:3" works with newer PostgreSQL), backup/keep (7),
+// backup/pgDumpPath (pg_dump; pg_restore is expected alongside it),
+// backup/nightlyTime ("HH:mm" to back up daily from this machine; off if empty)
+// and backup/nightlyMode ("incremental", the default, or "full"). Incremental
+// backups (see IncrementalBackup) also read backup/baselineDays (7) and
+// backup/keepChains (2).
+class BackupManager {
+public:
+    struct Options {
+        QString directory; // Each backup is a timestamped subdirectory of this
+        int jobs = 4;
+        QString compression;
+        int keep = 7;
+        QString pgDumpPath;
+        QString pgRestorePath;
+        int baselineDays = 7; // Incremental backups start a new chain this often
+        int keepChains = 2;
+    };
+    static Options options(); // From settings
+    static QStringList backups(const QString& directory); // Verified backups, newest first
+    static bool isVerified(const QString& backup);
+
+    // Runs inside a ReportJobRunner job, connecting as the job's connection
+    // does. On success message names the new backup; a failed or cancelled
+    // backup is deleted.
+    static bool run(ReportJobContext& context, const Options& options, QString& message);
+
+    // Dumps into target and verifies it, without rotating. A non-empty snapshot
+    // (from pg_export_snapshot() in a transaction the caller keeps open) makes
+    // pg_dump read exactly what that transaction sees.
+    static bool dump(ReportJobContext& context, const Options& options, const QString& target, const QString& snapshot,
+                     QString& message, int* tableCount = nullptr);
+    // Creates database and restores backup into it with parallel pg_restore
+    // workers. The database must not exist yet; it is dropped again on failure.
+    static bool restore(ReportJobContext& context, const Options& options, const QString& backup, const QString& database,
+                        QString& message);
+};
@@ -7,13 +7,20 @@
 #include <QDateTime>
 #include <QPrinter>
 #include <QPrintDialog>
-#include <QPainter>
 #include <QHBoxLayout>
 #include <QFont>
 #include <QFileDialog>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QApplication>
+#include <QMessageBox>
+#include <QDebug>
+#include <memory>
+#include "ReceiptRenderer.h"
+#include "EscPosPrinter.h"
 
 BillDialog::BillDialog(const Bill& bill, QWidget* parent)
-    : QDialog(parent)
+    : QDialog(parent), bill(bill)
 {
     setWindowTitle("Receipt / Bill");
     setMinimumWidth(400);
@@ -74,65 +81,63 @@ void BillDialog::setupUI(const Bill& bill) {
 }
 
 void BillDialog::printBill() {
-    QPrinter printer(QPrinter::HighResolution);
-    QPrintDialog dialog(&printer, this);
+    // A configured thermal printer gets raw ESC/POS with no dialog and no rasterizing
+    const QString thermalTarget = EscPosPrinter::defaultTarget();
+    if (!thermalTarget.isEmpty()) {
+        const Bill receipt = bill;
+        // Empty when printed; otherwise the error, shown back on the GUI thread
+        QFutureWatcher<QString>* watcher = new QFutureWatcher<QString>(qApp);
+        connect(watcher, &QFutureWatcher<QString>::finished, watcher, [watcher, receipt, thermalTarget]() {
+            const QString error = watcher->result();
+            watcher->deleteLater();
+            if (error.isEmpty()) return;
+            qDebug() << "Failed to print receipt on" << thermalTarget << ":" << error;
+            QWidget* window = QApplication::activeWindow();
+            const auto answer = QMessageBox::warning(window, "Print Failed",
+                QString("The receipt for sale %1 could not be printed on %2:\n%3\n\nPrint it on a regular printer instead?")
+                    .arg(receipt.saleId).arg(thermalTarget, error),
+                QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+            if (answer == QMessageBox::Yes) printWithDialog(receipt, window);
+        });
+        watcher->setFuture(QtConcurrent::run([receipt, thermalTarget]() {
+            QString error;
+            if (!EscPosPrinter::print(receipt, thermalTarget, &error) && error.isEmpty()) error = "Unknown error";
+            return error;
+        }));
+        return;
+    }
+    printWithDialog(bill, this);
+}
+
+void BillDialog::printWithDialog(const Bill& receipt, QWidget* parent) {
+    auto printer = std::make_shared<QPrinter>(QPrinter::HighResolution);
+    QPrintDialog dialog(printer.get(), parent);
     dialog.setWindowTitle("Print Bill");
     if (dialog.exec() != QDialog::Accepted)
         return;
-    QPainter painter(&printer);
-    int y = 100;
-    int x = 100;
-    int lineHeight = 30;
-    QFont font = painter.font();
-    font.setPointSize(12);
-    painter.setFont(font);
-    painter.drawText(x, y, "Monster POS Receipt");
-    y += lineHeight * 2;
-    painter.drawText(x, y, infoLabel->text().replace("<br>", " ").replace("<b>", "").replace("</b>", ""));
-    y += lineHeight * 2;
-    painter.drawText(x, y, "Items:");
-    y += lineHeight;
-    painter.drawText(x, y, "Name         Qty   Price   Total");
-    y += lineHeight;
-    for (int i = 0; i < itemsTable->rowCount(); ++i) {
-        QString name = itemsTable->item(i, 0)->text();
-        QString qty = itemsTable->item(i, 1)->text();
-        QString price = itemsTable->item(i, 2)->text();
-        QString total = itemsTable->item(i, 3)->text();
-        painter.drawText(x, y, QString("%1   %2   %3   %4").arg(name, -12).arg(qty, -4).arg(price, -6).arg(total, -6));
-        y += lineHeight;
-    }
-    y += lineHeight;
-    painter.drawText(x, y, summaryLabel->text().replace("<br>", " ").replace("<b>", "").replace("</b>", "").replace("<hr>", "----------------------"));
-    painter.end();
+    // Render on the thread pool so the dialog can close and the next sale can start.
+    // The watcher outlives the dialog, so a failure is reported over whatever window is up.
+    QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(qApp);
+    connect(watcher, &QFutureWatcher<bool>::finished, watcher, [watcher, printer, receipt]() {
+        if (!watcher->result()) {
+            qDebug() << "Failed to print receipt for sale" << receipt.saleId;
+            QMessageBox::warning(QApplication::activeWindow(), "Print Failed",
+                                 QString("The receipt for sale %1 could not be printed on %2.")
+                                     .arg(receipt.saleId).arg(printer->printerName()));
+        }
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([printer, receipt]() { return ReceiptRenderer::print(*printer, receipt); }));
 }
 
 void BillDialog::exportPdf() {
     QString fileName = QFileDialog::getSaveFileName(this, "Export Bill as PDF", "receipt.pdf", "PDF Files (*.pdf)");
     if (fileName.isEmpty()) return;
-    QPrinter printer(QPrinter::HighResolution);
-    printer.setOutputFormat(QPrinter::PdfFormat);
-    printer.setOutputFileName(fileName);
-    QPainter painter(&printer);
-    int x = 100, y = 100, lineHeight = 30;
-    painter.setFont(QFont("Arial", 12));
-    painter.drawText(x, y, "Monster POS Receipt");
-    y += lineHeight;
-    painter.drawText(x, y, infoLabel->text().replace("<br>", " ").replace("<b>", "").replace("</b>", ""));
-    y += lineHeight;
-    painter.drawText(x, y, "----------------------------------------");
-    y += lineHeight;
-    painter.drawText(x, y, "Name         Qty   Price   Total");
-    y += lineHeight;
-    for (int i = 0; i < itemsTable->rowCount(); ++i) {
-        QString name = itemsTable->item(i, 0)->text();
-        QString price = itemsTable->item(i, 1)->text();
-        QString qty = itemsTable->item(i, 2)->text();
-        QString total = itemsTable->item(i, 3)->text();
-        painter.drawText(x, y, QString("%1   %2   %3   %4").arg(name, -10).arg(qty, -4).arg(price, -7).arg(total));
-        y += lineHeight;
-    }
-    y += lineHeight;
-    painter.drawText(x, y, summaryLabel->text().replace("<br>", " ").replace("<b>", "").replace("</b>", "").replace("<hr>", "----------------------"));
-    painter.end();
-} 
\ No newline at end of file
+    QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(qApp);
+    connect(watcher, &QFutureWatcher<bool>::finished, watcher, [watcher, fileName]() {
+        if (!watcher->result())
+            qDebug() << "Failed to export receipt PDF:" << fileName;
+        watcher->deleteLater();
+    });
+    watcher->setFuture(ReceiptRenderer::writePdfAsync(bill, fileName));
+}
@@ -12,6 +12,7 @@ class BillDialog : public QDialog {
 public:
     explicit BillDialog(const Bill& bill, QWidget* parent = nullptr);
 private:
+    Bill bill; // Kept so printing and PDF export render from the data, not the widgets
     QLabel* headerLabel;
     QLabel* infoLabel;
     QTableWidget* itemsTable;
@@ -20,6 +21,7 @@ private:
     QPushButton* closeButton;
     QPushButton* exportPdfButton;
     void setupUI(const Bill& bill);
+    static void printWithDialog(const Bill& receipt, QWidget* parent);
 private slots:
     void printBill();
     void exportPdf();
@@ -0,0 +1,154 @@
+#include "BulkReceiptExporter.h"
+#include "Bill.h"
+#include "DbConnection.h"
+#include "ReceiptRenderer.h"
+#include <QtConcurrent>
+#include <QPdfWriter>
+#include <QPainter>
+#include <QPageSize>
+#include <QDir>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QVariant>
+
+// Bills held in memory at once; each chunk is rendered in parallel before the next is read
+static int chunkSize() {
+    return qMax(1, QThread::idealThreadCount()) * 32;
+}
+
+BulkReceiptExporter::BulkReceiptExporter(QObject *parent) : QObject(parent) {
+}
+
+BulkReceiptExporter::~BulkReceiptExporter() {
+    cancel();
+    future.waitForFinished();
+}
+
+void BulkReceiptExporter::start(const QDateTime& from, const QDateTime& to, Mode mode, const QString& target) {
+    if (isRunning()) return;
+    cancelled = false;
+    future = QtConcurrent::run([this, from, to, mode, target]() { run(from, to, mode, target); });
+}
+
+void BulkReceiptExporter::cancel() {
+    cancelled = true;
+}
+
+bool BulkReceiptExporter::isRunning() const {
+    return future.isRunning();
+}
+
+void BulkReceiptExporter::run(QDateTime from, QDateTime to, Mode mode, QString target) {
+    ScopedDbConnection connection("bulk-receipts");
+    if (!connection.isOpen()) {
+        emit finished(false, "Database error: " + connection.lastError());
+        return;
+    }
+    QSqlDatabase db = connection.database();
+
+    int total = 0;
+    {
+        QSqlQuery countQuery(db);
+        countQuery.prepare("SELECT COUNT(*) FROM sales WHERE sale_time >= ? AND sale_time < ?");
+        countQuery.addBindValue(from);
+        countQuery.addBindValue(to);
+        if (countQuery.exec() && countQuery.next()) total = countQuery.value(0).toInt();
+    }
+    emit progress(0, total);
+    if (total == 0) {
+        emit finished(true, "No sales in the selected range.");
+        return;
+    }
+
+    QPdfWriter* writer = nullptr;
+    QPainter painter;
+    if (mode == Mode::SinglePdf) {
+        writer = new QPdfWriter(target);
+        writer->setPageSize(QPageSize(QPageSize::A5));
+        writer->setResolution(300);
+        writer->setTitle("Receipts");
+        if (!painter.begin(writer)) {
+            delete writer;
+            emit finished(false, "Could not open " + target + " for writing.");
+            return;
+        }
+    }
+    const QDir dir(target);
+    bool firstPage = true;
+    int done = 0;
+    QString error;
+
+    // Lines come out grouped by sale; a Bill is complete when the sale ID changes
+    auto renderChunk = [&](QList<Bill>& chunk) {
+        if (chunk.isEmpty() || cancelled) return;
+        if (mode == Mode::DirectoryOfPdfs) {
+            QtConcurrent::blockingMap(chunk, [&dir, this](const Bill& bill) {
+                if (cancelled) return;
+                ReceiptRenderer::writePdf(bill, dir.filePath(QString("receipt_%1.pdf").arg(bill.saleId)));
+            });
+        } else {
+            // Layout is the expensive part and runs in parallel; painting into one file is sequential
+            const QList<QStringList> layouts = QtConcurrent::blockingMapped<QList<QStringList>>(
+                chunk, [](const Bill& bill) { return ReceiptRenderer::layoutLines(bill); });
+            for (const QStringList& lines : layouts) {
+                if (!firstPage) writer->newPage();
+                firstPage = false;
+                ReceiptRenderer::paintLines(painter, *writer, lines);
+            }
+        }
+        done += chunk.size();
+        chunk.clear();
+        emit progress(done, total);
+    };
+
+    {
+        SqlCursor cursor(db, "bulk_receipts_cursor", 2000);
+        if (!cursor.open("SELECT s.id, s.cashier, s.sale_time, s.total, si.product_name, si.quantity, si.price "
+                         "FROM sales s LEFT JOIN sales_items si ON si.sale_id = s.id "
+                         "WHERE s.sale_time >= ? AND s.sale_time < ? ORDER BY s.id, si.id",
+                         {from, to})) {
+            error = cursor.lastError();
+        }
+        QList<Bill> chunk;
+        Bill current;
+        QSqlQuery batch(db);
+        while (error.isEmpty() && !cancelled && cursor.fetch(batch)) {
+            do {
+                int saleId = batch.value(0).toInt();
+                if (saleId != current.saleId) {
+                    if (current.saleId != -1) chunk.append(current);
+                    if (chunk.size() >= chunkSize()) renderChunk(chunk);
+                    current = Bill();
+                    current.saleId = saleId;
+                    current.cashier = batch.value(1).toString();
+                    current.dateTime = batch.value(2).toDateTime();
+                    current.taxRate = 0.085; // Rate SalesScreen charges; not stored per sale
+                    current.paid = batch.value(3).toDouble();
+                }
+                if (!batch.value(4).isNull()) {
+                    BillItem item;
+                    item.name = batch.value(4).toString();
+                    item.quantity = batch.value(5).toInt();
+                    item.price = batch.value(6).toDouble();
+                    current.items.append(item);
+                }
+            } while (batch.next());
+        }
+        if (error.isEmpty() && !cancelled && !cursor.atEnd()) error = cursor.lastError();
+        if (current.saleId != -1) chunk.append(current);
+        renderChunk(chunk);
+    }
+
+    if (writer) {
+        painter.end();
+        delete writer;
+    }
+    if (!error.isEmpty()) {
+        emit finished(false, "Database error: " + error);
+    } else if (cancelled) {
+        emit finished(false, QString("Export cancelled after %1 of %2 receipts.").arg(done).arg(total));
+    } else {
+        emit finished(true, QString("Exported %1 receipts.").arg(done));
+    }
+}
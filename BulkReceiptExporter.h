@@ -0,0 +1,33 @@
+#pragma once
+#include <QObject>
+#include <QDateTime>
+#include <QString>
+#include <QFuture>
+#include <atomic>
+
+// Regenerates receipts for every sale in a date range. Sales are streamed from
+// the database through a cursor in fixed-size chunks and each chunk is rendered
+// across all cores, so memory use is bounded by the chunk size, not the range.
+class BulkReceiptExporter : public QObject {
+    Q_OBJECT
+public:
+    enum class Mode { SinglePdf, DirectoryOfPdfs };
+
+    explicit BulkReceiptExporter(QObject *parent = nullptr);
+    ~BulkReceiptExporter();
+
+    // target is the PDF file for SinglePdf, or an existing directory
+    void start(const QDateTime& from, const QDateTime& to, Mode mode, const QString& target);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void progress(int done, int total);
+    void finished(bool ok, const QString& message);
+
+private:
+    void run(QDateTime from, QDateTime to, Mode mode, QString target);
+
+    std::atomic_bool cancelled{false};
+    QFuture<void> future;
+};
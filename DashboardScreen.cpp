@@ -7,6 +7,10 @@
 #include <QFrame>
 #include <QFont>
 #include <QStyle>
+#include <QSqlQuery>
+#include <QDebug>
+#include "SalesRollup.h"
+#include "TopSellers.h"
 
 DashboardScreen::DashboardScreen(QWidget *parent) : QWidget(parent) {
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
@@ -78,6 +82,20 @@ DashboardScreen::DashboardScreen(QWidget *parent) : QWidget(parent) {
 
     mainLayout->addLayout(metricsLayout);
 
+    QFrame *topSellersCard = new QFrame;
+    topSellersCard->setFrameStyle(QFrame::Box);
+    topSellersCard->setStyleSheet("QFrame { background: #2d313a; border-radius: 10px; padding: 20px; }");
+    QVBoxLayout *topSellersLayout = new QVBoxLayout(topSellersCard);
+    QLabel *topSellersTitle = new QLabel("Top Sellers Today");
+    topSellersTitle->setStyleSheet("color: #888888; font-size: 14px;");
+    topSellersLabel = new QLabel("No sales yet");
+    topSellersLabel->setStyleSheet("color: #ffffff; font-size: 16px;");
+    topSellersLayout->addWidget(topSellersTitle);
+    topSellersLayout->addWidget(topSellersLabel);
+    mainLayout->addWidget(topSellersCard);
+    // Refreshed live as sales come in on any terminal
+    connect(&TopSellers::instance(), &TopSellers::updated, this, &DashboardScreen::updateTopSellers);
+
     // Quick Actions Section
     QLabel *actionsLabel = new QLabel("Quick Actions");
     QFont actionsFont = actionsLabel->font();
@@ -113,10 +131,37 @@ DashboardScreen::DashboardScreen(QWidget *parent) : QWidget(parent) {
 
     mainLayout->addLayout(actionsLayout);
     mainLayout->addStretch();
+
+    updateMetrics();
 }
 
 void DashboardScreen::updateMetrics() {
-    // This method will be called to refresh dashboard metrics
-    // All data will come from user interactions and database
-    // For now, we'll keep the zero values until data is added
-} 
\ No newline at end of file
+    // Sales figures come from the daily rollups, so this stays cheap however many sales there are
+    SalesRollup::Totals totals;
+    QString error;
+    if (SalesRollup::totals(totals, &error)) {
+        totalSalesLabel->setText(QString("$%1").arg(totals.allSales, 0, 'f', 2));
+        todaySalesLabel->setText(QString("$%1").arg(totals.todaySales, 0, 'f', 2));
+        totalOrdersLabel->setText(QString::number(totals.allOrders));
+    } else {
+        qDebug() << "Failed to load dashboard metrics:" << error;
+    }
+    QSqlQuery lowStockQuery("SELECT COUNT(*) FROM products WHERE quantity <= min_stock");
+    if (lowStockQuery.next()) lowStockLabel->setText(QString::number(lowStockQuery.value(0).toInt()));
+    updateTopSellers();
+}
+
+void DashboardScreen::updateTopSellers() {
+    const TopSellers::Result result = TopSellers::instance().top(TopSellers::Window::Today, 5);
+    if (result.entries.isEmpty()) {
+        topSellersLabel->setText(result.updatedAt.isNull() ? "Loading..." : "No sales yet");
+        return;
+    }
+    QStringList lines;
+    for (int i = 0; i < result.entries.size(); ++i) {
+        const TopSellers::Entry &entry = result.entries[i];
+        // A "~" marks counts that may be overstated by the sketch
+        lines << QString("%1. %2 - %3%4 sold").arg(i + 1).arg(entry.product).arg(entry.error > 0 ? "~" : "").arg(entry.quantity);
+    }
+    topSellersLabel->setText(lines.join('\n'));
+}
@@ -13,10 +13,13 @@ public:
     void updateMetrics();
 
 private:
+    void updateTopSellers();
+
     QLabel *totalSalesLabel;
     QLabel *todaySalesLabel;
     QLabel *totalOrdersLabel;
     QLabel *lowStockLabel;
+    QLabel *topSellersLabel;
     QPushButton *newSaleBtn;
     QPushButton *viewInventoryBtn;
     QPushButton *viewReportsBtn;
@@ -0,0 +1,94 @@
+#include "DbConnection.h"
+#include <QSqlDriver>
+#include <QSqlField>
+#include <QSqlError>
+#include <QThread>
+#include <QAtomicInt>
+
+static QAtomicInt connectionCounter;
+
+ScopedDbConnection::ScopedDbConnection(const QString& purpose) {
+    name = QString("%1-%2").arg(purpose).arg(connectionCounter.fetchAndAddRelaxed(1));
+    QSqlDatabase db = QSqlDatabase::cloneDatabase(QString::fromLatin1(QSqlDatabase::defaultConnection), name);
+    db.open();
+}
+
+ScopedDbConnection::~ScopedDbConnection() {
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(name);
+}
+
+QSqlDatabase ScopedDbConnection::database() const {
+    return QSqlDatabase::database(name, false);
+}
+
+bool ScopedDbConnection::isOpen() const {
+    return database().isOpen();
+}
+
+QString ScopedDbConnection::lastError() const {
+    return database().lastError().text();
+}
+
+SqlCursor::SqlCursor(const QSqlDatabase& db, const QString& name, int fetchSize)
+    : db(db), name(name), fetchSize(fetchSize)
+{
+}
+
+SqlCursor::~SqlCursor() {
+    close();
+}
+
+bool SqlCursor::open(const QString& sql, const QVariantList& bindValues) {
+    QString statement;
+    int bind = 0;
+    for (QChar c : sql) {
+        if (c == '?' && bind < bindValues.size()) {
+            const QVariant& value = bindValues[bind++];
+            QSqlField field(QString(), value.metaType());
+            field.setValue(value);
+            statement += db.driver()->formatValue(field);
+        } else {
+            statement += c;
+        }
+    }
+    if (ownsTransaction && !db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+    QSqlQuery declare(db);
+    if (!declare.exec(QString("DECLARE %1 NO SCROLL CURSOR FOR %2").arg(name, statement))) {
+        error = declare.lastError().text();
+        if (ownsTransaction) db.rollback();
+        return false;
+    }
+    isOpen = true;
+    return true;
+}
+
+bool SqlCursor::fetch(QSqlQuery& batch) {
+    if (!isOpen || exhausted) return false;
+    batch = QSqlQuery(db);
+    batch.setForwardOnly(true);
+    if (!batch.exec(QString("FETCH %1 FROM %2").arg(fetchSize).arg(name))) {
+        error = batch.lastError().text();
+        return false;
+    }
+    // Forward-only results report no size(); an empty batch is the end
+    if (!batch.next()) {
+        exhausted = batch.lastError().type() == QSqlError::NoError;
+        if (!exhausted) error = batch.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void SqlCursor::close() {
+    if (!isOpen) return;
+    isOpen = false;
+    QSqlQuery(db).exec(QString("CLOSE %1").arg(name));
+    if (ownsTransaction) db.commit();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <QString>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariantList>
+
+// Monthly partitions (stock_movements, activity_log) are created this many
+// months ahead of the current one by ensure_monthly_partitions()
+constexpr int partitionMonthsAhead = 3;
+
+// Opens a private clone of the default connection for use on a worker thread.
+// QSqlDatabase connections may only be used from the thread that opened them,
+// so background jobs create one of these for their lifetime.
+class ScopedDbConnection {
+public:
+    explicit ScopedDbConnection(const QString& purpose);
+    ~ScopedDbConnection();
+    ScopedDbConnection(const ScopedDbConnection&) = delete;
+    ScopedDbConnection& operator=(const ScopedDbConnection&) = delete;
+
+    QSqlDatabase database() const;
+    bool isOpen() const;
+    QString lastError() const;
+
+private:
+    QString name;
+};
+
+// Server-side cursor that reads a large result in fixed-size batches, so
+// client memory stays bounded no matter how many rows the query returns.
+class SqlCursor {
+public:
+    SqlCursor(const QSqlDatabase& db, const QString& name, int fetchSize = 1000);
+    ~SqlCursor();
+
+    // '?' placeholders are filled with literals formatted by the driver, since
+    // DECLARE cannot be sent as a prepared statement.
+    bool open(const QString& sql, const QVariantList& bindValues = QVariantList());
+    // Leaves batch on its first row, so read it with do { ... } while (batch.next()).
+    // False once the cursor is exhausted (see atEnd()) or on error. batch should
+    // be built on the cursor's connection; the default one belongs to the GUI thread.
+    bool fetch(QSqlQuery& batch);
+    bool atEnd() const { return exhausted; } // Every row has been fetched
+    void close();
+    QString lastError() const { return error; }
+
+    // Declares the cursor inside a transaction the caller already opened, so
+    // several cursors can read one snapshot; the caller commits it.
+    void joinTransaction() { ownsTransaction = false; }
+
+private:
+    QSqlDatabase db;
+    QString name;
+    int fetchSize;
+    bool isOpen = false;
+    bool exhausted = false;
+    bool ownsTransaction = true;
+    QString error;
+};
@@ -0,0 +1,72 @@
+#include "EscPosPrinter.h"
+#include "ReceiptRenderer.h"
+#include <QFile>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QSettings>
+
+// ESC/POS command bytes
+static const char ESC = 0x1B;
+static const char GS = 0x1D;
+
+QByteArray EscPosPrinter::encode(const Bill& bill) {
+    QByteArray out;
+    out.reserve(2048);
+    out.append(ESC).append('@');                 // Initialize printer
+
+    const QStringList lines = ReceiptRenderer::layoutLines(bill, columns);
+    for (int i = 0; i < lines.size(); ++i) {
+        bool title = i == 0;
+        if (title) out.append(ESC).append('E').append(char(1)); // Bold on
+        out.append(lines[i].toLatin1()).append('\n');
+        if (title) out.append(ESC).append('E').append(char(0));
+    }
+
+    if (bill.saleId != -1) {
+        const QByteArray code = "{B" + QByteArray::number(bill.saleId); // CODE128, code set B
+        out.append(ESC).append('a').append(char(1));  // Center
+        out.append(GS).append('h').append(char(80));  // Barcode height in dots
+        out.append(GS).append('w').append(char(2));   // Module width
+        out.append(GS).append('H').append(char(2));   // Human-readable text below
+        out.append(GS).append('k').append(char(73)).append(char(code.size())).append(code);
+        out.append(ESC).append('a').append(char(0));  // Left
+    }
+
+    out.append(ESC).append('d').append(char(4));      // Feed past the cutter
+    out.append(GS).append('V').append(char(66)).append(char(0)); // Partial cut
+    return out;
+}
+
+bool EscPosPrinter::print(const Bill& bill, const QString& target, QString* error) {
+    return send(encode(bill), target, error);
+}
+
+bool EscPosPrinter::send(const QByteArray& data, const QString& target, QString* error) {
+    if (target.startsWith("tcp://")) {
+        QUrl url(target);
+        QTcpSocket socket;
+        socket.connectToHost(url.host(), url.port(9100));
+        if (!socket.waitForConnected(2000)) {
+            if (error) *error = socket.errorString();
+            return false;
+        }
+        socket.write(data);
+        bool ok = socket.waitForBytesWritten(2000);
+        if (!ok && error) *error = socket.errorString();
+        socket.disconnectFromHost();
+        return ok;
+    }
+
+    QFile device(target.startsWith("file:") ? target.mid(5) : target);
+    if (!device.open(QIODevice::WriteOnly)) {
+        if (error) *error = device.errorString();
+        return false;
+    }
+    bool ok = device.write(data) == data.size() && device.flush();
+    if (!ok && error) *error = device.errorString();
+    return ok;
+}
+
+QString EscPosPrinter::defaultTarget() {
+    return QSettings().value("printer/escposTarget").toString();
+}
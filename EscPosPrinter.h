@@ -0,0 +1,24 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include "Bill.h"
+
+// Raw ESC/POS output for 80mm thermal receipt printers. The receipt text comes
+// from ReceiptRenderer so it matches the printed/PDF layout, followed by a
+// CODE128 barcode of the sale ID and a cut command.
+//
+// Targets:
+//   tcp://host:port     network printer (usually port 9100)
+//   file:/path          regular file, handy as a stand-in when testing
+//   /dev/usb/lp0, COM3  anything else is opened as a device file
+class EscPosPrinter {
+public:
+    static constexpr int columns = 48; // Font A on 80mm paper
+
+    static QByteArray encode(const Bill& bill);
+    static bool print(const Bill& bill, const QString& target, QString* error = nullptr);
+    static bool send(const QByteArray& data, const QString& target, QString* error = nullptr);
+
+    // Configured default printer ("printer/escposTarget"); empty means use the print dialog
+    static QString defaultTarget();
+};
@@ -0,0 +1,45 @@
+#include "GzipFileWriter.h"
+
+static const int chunkSize = 256 * 1024;
+
+GzipFileWriter::GzipFileWriter() : out(chunkSize, Qt::Uninitialized) {}
+
+GzipFileWriter::~GzipFileWriter() {
+    if (started) deflateEnd(&stream);
+}
+
+bool GzipFileWriter::open(const QString& path, int level) {
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    started = deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    return started;
+}
+
+bool GzipFileWriter::write(const char *data, int size) {
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = uInt(size);
+    return drain(Z_NO_FLUSH);
+}
+
+bool GzipFileWriter::finish() {
+    const bool ok = drain(Z_FINISH);
+    file.close();
+    return ok && file.error() == QFileDevice::NoError;
+}
+
+bool GzipFileWriter::drain(int flush) {
+    int result;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = uInt(out.size());
+        result = deflate(&stream, flush);
+        if (result == Z_STREAM_ERROR) return false;
+        const qint64 size = out.size() - qint64(stream.avail_out);
+        if (size > 0) {
+            if (file.write(out.constData(), size) != size) return false;
+            hash.addData(QByteArrayView(out.constData(), size));
+            written += size;
+        }
+    } while (stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    return true;
+}
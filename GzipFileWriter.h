@@ -0,0 +1,33 @@
+#pragma once
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QString>
+#include <zlib.h>
+
+// Deflates into a gzip file and hashes the compressed bytes as they are
+// written. Used for incremental backup segments and activity log archives.
+class GzipFileWriter {
+public:
+    GzipFileWriter();
+    ~GzipFileWriter();
+    GzipFileWriter(const GzipFileWriter&) = delete;
+    GzipFileWriter& operator=(const GzipFileWriter&) = delete;
+
+    bool open(const QString& path, int level);
+    bool write(const char *data, int size);
+    bool finish(); // Flushes the gzip trailer and closes the file
+    QString errorString() const { return file.errorString(); }
+    QByteArray sha256() const { return hash.result().toHex(); }
+    qint64 bytes() const { return written; }
+
+private:
+    bool drain(int flush);
+
+    QFile file;
+    z_stream stream = {};
+    bool started = false;
+    QByteArray out;
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    qint64 written = 0;
+};
@@ -1,4 +1,10 @@
 #include "HttpServer.h"
+#include "ProductSearch.h"
+#include "SalesRollup.h"
+#include "TopSellers.h"
+#include "OrderQuantiles.h"
+#include "ActivityLogQuery.h"
+#include "ActivityFeed.h"
 #include <QDebug>
 #include <QDateTime>
 #include <QUrlQuery>
@@ -50,14 +56,38 @@ bool HttpServer::start(int port)
                       handleGetSummary(request, responder);
                   });
 
+    server->route("/api/products/search", QHttpServerRequest::Method::Get,
+                  [this](const QHttpServerRequest &request, QHttpServerResponder &responder) {
+                      handleSearchProducts(request, responder);
+                  });
+
+    server->route("/api/forecast", QHttpServerRequest::Method::Get,
+                  [this](const QHttpServerRequest &request, QHttpServerResponder &responder) {
+                      handleGetForecast(request, responder);
+                  });
+
+    server->route("/api/top-sellers", QHttpServerRequest::Method::Get,
+                  [this](const QHttpServerRequest &request, QHttpServerResponder &responder) {
+                      handleGetTopSellers(request, responder);
+                  });
+
+    server->route("/api/basket-quantiles", QHttpServerRequest::Method::Get,
+                  [this](const QHttpServerRequest &request, QHttpServerResponder &responder) {
+                      handleGetBasketQuantiles(request, responder);
+                  });
+
     // Try to start the server
     try {
         qDebug() << "HTTP Server started on port" << port;
         qDebug() << "API Endpoints:";
         qDebug() << "  GET  /api/sales - Get sales data";
         qDebug() << "  GET  /api/inventory - Get inventory status";
-        qDebug() << "  GET  /api/activity-log - Get recent activity";
+        qDebug() << "  GET  /api/activity-log?username=&action=&sale_id=&cursor= - Get activity, filtered and paged";
         qDebug() << "  GET  /api/summary - Get summary statistics";
+        qDebug() << "  GET  /api/products/search?q= - Search products";
+        qDebug() << "  GET  /api/forecast - Get stock-out and reorder forecast";
+        qDebug() << "  GET  /api/top-sellers?window= - Get approximate best sellers";
+        qDebug() << "  GET  /api/basket-quantiles - Get order value and basket size percentiles";
         return true;
     } catch (...) {
         qDebug() << "Failed to start HTTP Server on port" << port;
@@ -120,15 +150,63 @@ void HttpServer::handleGetActivityLog(const QHttpServerRequest &request, QHttpSe
         return;
     }
 
-    QSqlQuery query;
-    query.prepare("SELECT username, action, details, timestamp FROM activity_log ORDER BY timestamp DESC LIMIT 100");
-    
-    if (query.exec()) {
-        QJsonArray logArray = queryToJsonArray(query);
-        responder.write(QJsonDocument(createSuccessResponse(logArray)).toJson(), "application/json");
-    } else {
-        responder.write(QJsonDocument(createErrorResponse("Database error: " + query.lastError().text())).toJson(), "application/json");
+    QUrlQuery params = request.query();
+    ActivityLogQuery::Filter filter;
+    filter.username = params.queryItemValue("username");
+    filter.action = params.queryItemValue("action");
+    filter.product = params.queryItemValue("product");
+    filter.cursor = params.queryItemValue("cursor");
+    // Both optional; to is inclusive
+    const QDate from = QDate::fromString(params.queryItemValue("from"), Qt::ISODate);
+    const QDate to = QDate::fromString(params.queryItemValue("to"), Qt::ISODate);
+    if ((params.hasQueryItem("from") && !from.isValid()) || (params.hasQueryItem("to") && !to.isValid())
+        || (from.isValid() && to.isValid() && from > to)) {
+        responder.write(QJsonDocument(createErrorResponse("from and to must be dates (YYYY-MM-DD), from not after to")).toJson(), "application/json");
+        return;
     }
+    if (from.isValid()) filter.from = from.startOfDay();
+    if (to.isValid()) filter.to = to.addDays(1).startOfDay();
+    bool ok = true;
+    if (params.hasQueryItem("sale_id")) filter.saleId = params.queryItemValue("sale_id").toLongLong(&ok);
+    if (ok && params.hasQueryItem("product_id")) filter.productId = params.queryItemValue("product_id").toLongLong(&ok);
+    if (!ok || filter.saleId < 0 || filter.productId < 0) {
+        responder.write(QJsonDocument(createErrorResponse("sale_id and product_id must be positive numbers")).toJson(), "application/json");
+        return;
+    }
+    if (params.hasQueryItem("limit")) {
+        filter.limit = params.queryItemValue("limit").toInt(&ok);
+        if (!ok || filter.limit < 1 || filter.limit > ActivityLogQuery::maxLimit) {
+            responder.write(QJsonDocument(createErrorResponse(QString("limit must be from 1 to %1").arg(ActivityLogQuery::maxLimit))).toJson(), "application/json");
+            return;
+        }
+    }
+    if (!filter.cursor.isEmpty() && !ActivityLogQuery::isValidCursor(filter.cursor)) {
+        responder.write(QJsonDocument(createErrorResponse("cursor must be a next_cursor from an earlier response")).toJson(), "application/json");
+        return;
+    }
+
+    QList<ActivityLogQuery::Row> rows;
+    QString nextCursor, error;
+    // Recent pages are answered from memory
+    if (!ActivityFeed::instance().query(filter, rows, nextCursor)
+        && !ActivityLogQuery::query(QSqlDatabase::database(), filter, rows, nextCursor, &error)) {
+        responder.write(QJsonDocument(createErrorResponse("Database error: " + error)).toJson(), "application/json");
+        return;
+    }
+    QJsonArray logArray;
+    for (const ActivityLogQuery::Row &row : rows) {
+        QJsonObject entry;
+        entry["id"] = row.id;
+        entry["username"] = row.username;
+        entry["action"] = row.action;
+        entry["details"] = row.details;
+        entry["fields"] = row.fields;
+        entry["timestamp"] = row.timestamp.toString(Qt::ISODate);
+        logArray.append(entry);
+    }
+    QJsonObject response = createSuccessResponse(logArray);
+    response["next_cursor"] = nextCursor.isEmpty() ? QJsonValue() : QJsonValue(nextCursor);
+    responder.write(QJsonDocument(response).toJson(), "application/json");
 }
 
 void HttpServer::handleGetSummary(const QHttpServerRequest &request, QHttpServerResponder &responder)
@@ -140,21 +218,17 @@ void HttpServer::handleGetSummary(const QHttpServerRequest &request, QHttpServer
 
     QJsonObject summary;
     
-    // Total sales
-    QSqlQuery salesQuery;
-    salesQuery.prepare("SELECT COUNT(*) as count, COALESCE(SUM(total), 0) as total FROM sales");
-    if (salesQuery.exec() && salesQuery.next()) {
-        summary["total_sales"] = salesQuery.value("total").toDouble();
-        summary["total_orders"] = salesQuery.value("count").toInt();
-    }
-    
-    // Today's sales
-    QSqlQuery todayQuery;
-    todayQuery.prepare("SELECT COUNT(*) as count, COALESCE(SUM(total), 0) as total FROM sales WHERE DATE(sale_time) = CURRENT_DATE");
-    if (todayQuery.exec() && todayQuery.next()) {
-        summary["today_sales"] = todayQuery.value("total").toDouble();
-        summary["today_orders"] = todayQuery.value("count").toInt();
+    // Sales totals, from the daily rollups
+    SalesRollup::Totals totals;
+    QString error;
+    if (!SalesRollup::totals(totals, &error)) {
+        responder.write(QJsonDocument(createErrorResponse("Database error: " + error)).toJson(), "application/json");
+        return;
     }
+    summary["total_sales"] = totals.allSales;
+    summary["total_orders"] = totals.allOrders;
+    summary["today_sales"] = totals.todaySales;
+    summary["today_orders"] = totals.todayOrders;
     
     // Low stock items
     QSqlQuery lowStockQuery;
@@ -173,6 +247,166 @@ void HttpServer::handleGetSummary(const QHttpServerRequest &request, QHttpServer
     responder.write(QJsonDocument(createSuccessResponse(summary)).toJson(), "application/json");
 }
 
+void HttpServer::handleSearchProducts(const QHttpServerRequest &request, QHttpServerResponder &responder)
+{
+    if (!validateApiKey(request)) {
+        responder.write(QJsonDocument(createErrorResponse("Invalid API key")).toJson(), "application/json");
+        return;
+    }
+
+    QUrlQuery params = request.query();
+    QString text = params.queryItemValue("q", QUrl::FullyDecoded).trimmed();
+    if (text.isEmpty()) {
+        responder.write(QJsonDocument(createErrorResponse("Missing search text (q)")).toJson(), "application/json");
+        return;
+    }
+    int limit = qBound(1, params.hasQueryItem("limit") ? params.queryItemValue("limit").toInt() : 50, 200);
+    int offset = qMax(0, params.queryItemValue("offset").toInt());
+
+    QString error;
+    QJsonArray results = ProductSearch::search(text, limit, offset, &error);
+    if (!error.isEmpty()) {
+        responder.write(QJsonDocument(createErrorResponse("Database error: " + error)).toJson(), "application/json");
+        return;
+    }
+    responder.write(QJsonDocument(createSuccessResponse(results)).toJson(), "application/json");
+}
+
+void HttpServer::handleGetForecast(const QHttpServerRequest &request, QHttpServerResponder &responder)
+{
+    if (!validateApiKey(request)) {
+        responder.write(QJsonDocument(createErrorResponse("Invalid API key")).toJson(), "application/json");
+        return;
+    }
+
+    QUrlQuery params = request.query();
+    int limit = qBound(1, params.hasQueryItem("limit") ? params.queryItemValue("limit").toInt() : 100, 1000);
+    bool reorderOnly = params.queryItemValue("reorder_only") == "true";
+
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT p.id, p.name, p.quantity, p.min_stock, f.daily_velocity::float8, f.weekday_factors::float8[]::text, "
+                          "f.stockout_date, f.reorder_point, f.suggested_order, f.computed_at "
+                          "FROM product_forecasts f JOIN products p ON p.id = f.product_id %1"
+                          "ORDER BY f.stockout_date NULLS LAST, p.name LIMIT ?")
+                      .arg(reorderOnly ? "WHERE f.suggested_order > 0 " : ""));
+    query.addBindValue(limit);
+    if (!query.exec()) {
+        responder.write(QJsonDocument(createErrorResponse("Database error: " + query.lastError().text())).toJson(), "application/json");
+        return;
+    }
+    QJsonArray forecasts;
+    while (query.next()) {
+        QJsonObject forecast;
+        forecast["product_id"] = query.value(0).toInt();
+        forecast["name"] = query.value(1).toString();
+        forecast["quantity"] = query.value(2).toInt();
+        forecast["min_stock"] = query.value(3).toInt();
+        forecast["daily_velocity"] = query.value(4).toDouble();
+        QJsonArray factors;
+        const QString factorText = query.value(5).toString().remove('{').remove('}');
+        for (const QString &factor : factorText.split(',', Qt::SkipEmptyParts)) factors.append(factor.toDouble());
+        forecast["weekday_factors"] = factors;
+        forecast["stockout_date"] = query.value(6).isNull() ? QJsonValue() : QJsonValue(query.value(6).toDate().toString(Qt::ISODate));
+        forecast["reorder_point"] = query.value(7).toInt();
+        forecast["suggested_order"] = query.value(8).toInt();
+        forecast["computed_at"] = query.value(9).toDateTime().toString(Qt::ISODate);
+        forecasts.append(forecast);
+    }
+    responder.write(QJsonDocument(createSuccessResponse(forecasts)).toJson(), "application/json");
+}
+
+void HttpServer::handleGetTopSellers(const QHttpServerRequest &request, QHttpServerResponder &responder)
+{
+    if (!validateApiKey(request)) {
+        responder.write(QJsonDocument(createErrorResponse("Invalid API key")).toJson(), "application/json");
+        return;
+    }
+
+    // Served from memory; see TopSellers for what the bounds mean
+    QUrlQuery params = request.query();
+    TopSellers::Window window = TopSellers::Window::Today;
+    if (params.hasQueryItem("window") && !TopSellers::parseWindow(params.queryItemValue("window"), window)) {
+        responder.write(QJsonDocument(createErrorResponse("window must be hour, today or 7d")).toJson(), "application/json");
+        return;
+    }
+    int limit = qBound(1, params.hasQueryItem("limit") ? params.queryItemValue("limit").toInt() : 10, int(TopSellers::listed));
+    const TopSellers::Result result = TopSellers::instance().top(window, limit);
+    QJsonArray products;
+    for (const TopSellers::Entry &entry : result.entries) {
+        QJsonObject product;
+        product["product_name"] = entry.product;
+        product["quantity"] = entry.quantity;
+        product["min_quantity"] = entry.quantity - entry.error;
+        products.append(product);
+    }
+    QJsonObject data;
+    data["window"] = TopSellers::windowName(window);
+    data["products"] = products;
+    data["total_quantity"] = result.totalQuantity;
+    data["error_bound"] = result.errorBound;
+    data["updated_at"] = result.updatedAt.isNull() ? QJsonValue() : QJsonValue(result.updatedAt.toString(Qt::ISODate));
+    responder.write(QJsonDocument(createSuccessResponse(data)).toJson(), "application/json");
+}
+
+void HttpServer::handleGetBasketQuantiles(const QHttpServerRequest &request, QHttpServerResponder &responder)
+{
+    if (!validateApiKey(request)) {
+        responder.write(QJsonDocument(createErrorResponse("Invalid API key")).toJson(), "application/json");
+        return;
+    }
+
+    QUrlQuery params = request.query();
+    const QDate today = QDate::currentDate();
+    QDate from = params.hasQueryItem("from") ? QDate::fromString(params.queryItemValue("from"), Qt::ISODate) : today.addDays(-6);
+    QDate to = params.hasQueryItem("to") ? QDate::fromString(params.queryItemValue("to"), Qt::ISODate) : today;
+    if (!from.isValid() || !to.isValid() || from > to) {
+        responder.write(QJsonDocument(createErrorResponse("from and to must be dates (YYYY-MM-DD), from not after to")).toJson(), "application/json");
+        return;
+    }
+    OrderQuantiles::GroupBy groupBy = OrderQuantiles::GroupBy::Total;
+    if (params.hasQueryItem("group_by") && !OrderQuantiles::parseGroupBy(params.queryItemValue("group_by"), groupBy)) {
+        responder.write(QJsonDocument(createErrorResponse("group_by must be total, hour, day, cashier or terminal")).toJson(), "application/json");
+        return;
+    }
+    QList<double> quantiles = {0.5, 0.9, 0.99};
+    if (params.hasQueryItem("q")) {
+        quantiles.clear();
+        for (const QString &text : params.queryItemValue("q").split(',', Qt::SkipEmptyParts)) {
+            bool ok;
+            const double q = text.toDouble(&ok);
+            if (!ok || q < 0 || q > 1) {
+                responder.write(QJsonDocument(createErrorResponse("q must be a comma-separated list of numbers from 0 to 1")).toJson(), "application/json");
+                return;
+            }
+            quantiles << q;
+        }
+    }
+
+    QList<OrderQuantiles::Row> rows;
+    QString error;
+    if (!OrderQuantiles::query(QSqlDatabase::database(), from, to, groupBy, params.queryItemValue("cashier"), quantiles, rows, &error)) {
+        responder.write(QJsonDocument(createErrorResponse("Database error: " + error)).toJson(), "application/json");
+        return;
+    }
+    QJsonArray groups;
+    for (const OrderQuantiles::Row &row : rows) {
+        QJsonObject group;
+        group["group"] = row.label;
+        group["orders"] = row.orders;
+        QJsonObject value, items;
+        for (int i = 0; i < quantiles.size(); ++i) {
+            const QString name = "p" + QString::number(quantiles[i] * 100, 'g', 4);
+            value[name] = qRound64(row.values[i] * 100) / 100.0;
+            items[name] = qRound64(row.items[i] * 10) / 10.0;
+        }
+        group["order_value"] = value;
+        group["items"] = items;
+        groups.append(group);
+    }
+    responder.write(QJsonDocument(createSuccessResponse(groups)).toJson(), "application/json");
+}
+
 QJsonObject HttpServer::createErrorResponse(const QString &message)
 {
     QJsonObject response;
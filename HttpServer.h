@@ -27,6 +27,10 @@ private:
     void handleGetInventory(const QHttpServerRequest &request, QHttpServerResponder &responder);
     void handleGetActivityLog(const QHttpServerRequest &request, QHttpServerResponder &responder);
     void handleGetSummary(const QHttpServerRequest &request, QHttpServerResponder &responder);
+    void handleSearchProducts(const QHttpServerRequest &request, QHttpServerResponder &responder);
+    void handleGetForecast(const QHttpServerRequest &request, QHttpServerResponder &responder);
+    void handleGetTopSellers(const QHttpServerRequest &request, QHttpServerResponder &responder);
+    void handleGetBasketQuantiles(const QHttpServerRequest &request, QHttpServerResponder &responder);
 
     QHttpServer *server;
     bool validateApiKey(const QHttpServerRequest &request);
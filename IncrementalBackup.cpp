@@ -0,0 +1,625 @@
+#include "IncrementalBackup.h"
+#include "GzipFileWriter.h"
+#include "PgCopy.h"
+#include "ReportJobRunner.h"
+#include <QAtomicInt>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QtConcurrent>
+#include <atomic>
+#include <zlib.h>
+
+static const char *chainPrefix = "chain_";
+static const char *manifestName = "manifest.json";
+static const qint64 watermarkMargin = 1000;
+static const int chunkSize = 256 * 1024;
+
+namespace {
+// An append-only table: rows past the watermark column go into each increment
+struct AppendTable {
+    QString name;
+    QString watermark; // Empty for sales_items, which follows its sales
+};
+
+const QList<AppendTable> appendTables = {
+    {"sales", "ingest_seq"},
+    {"sales_items", QString()},
+    {"activity_log", "id"},
+    {"stock_movements", "id"},
+};
+const QStringList referenceTables = {"users", "products"};
+
+// Replayed one after another on one connection, for the foreign key
+const QList<QStringList> replayGroups = {{"sales", "sales_items"}, {"activity_log"}, {"stock_movements"}};
+
+// Columns replayed with a fixed value. The baseline's rollups don't include
+// the restored sales, so the rollup catch-up has to count them.
+const QHash<QString, QString> replayOverrides = {{"sales.rolled_up", "false"}};
+
+// A connection to another database on the same server, for the current thread
+class TargetConnection {
+public:
+    TargetConnection(const QSqlDatabase& server, const QString& database) {
+        static QAtomicInt counter;
+        name = QString("restore-%1").arg(counter.fetchAndAddRelaxed(1));
+        QSqlDatabase db = QSqlDatabase::cloneDatabase(server.connectionName(), name);
+        db.setDatabaseName(database);
+        if (db.open()) QSqlQuery(db).exec("SET statement_timeout = 0");
+    }
+    ~TargetConnection() {
+        {
+            QSqlDatabase db = QSqlDatabase::database(name, false);
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    }
+    TargetConnection(const TargetConnection&) = delete;
+    TargetConnection& operator=(const TargetConnection&) = delete;
+
+    QSqlDatabase database() const { return QSqlDatabase::database(name, false); }
+
+private:
+    QString name;
+};
+}
+
+static bool readManifest(const QString& chain, QJsonObject& manifest, QString& error) {
+    QFile file(QDir(chain).filePath(manifestName));
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject() || document.object().value("version").toInt() != 1) {
+        error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : QString("unknown manifest version");
+        return false;
+    }
+    manifest = document.object();
+    return true;
+}
+
+// Replaced in one rename, so a crash never leaves half a manifest
+static bool writeManifest(const QString& chain, const QJsonObject& manifest, QString& error) {
+    QSaveFile file(QDir(chain).filePath(manifestName));
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(manifest).toJson()) < 0 || !file.commit()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+static QString identifier(const QSqlDatabase& db, const QString& name) {
+    return db.driver()->escapeIdentifier(name, QSqlDriver::FieldName);
+}
+
+// Stored columns in table order; generated columns can't be copied back in
+static bool tableColumns(const QSqlDatabase& db, const QString& table, QStringList& columns, QString& error) {
+    QSqlQuery query(db);
+    query.prepare("SELECT column_name FROM information_schema.columns "
+                  "WHERE table_schema = current_schema() AND table_name = ? AND is_generated = 'NEVER' "
+                  "ORDER BY ordinal_position");
+    query.addBindValue(table);
+    if (!query.exec()) {
+        error = query.lastError().text();
+        return false;
+    }
+    columns.clear();
+    while (query.next()) columns << query.value(0).toString();
+    if (columns.isEmpty()) error = "Table " + table + " not found";
+    return !columns.isEmpty();
+}
+
+// Highest value of the watermark column, never below from
+static bool readWatermark(const QSqlDatabase& db, const AppendTable& table, qint64 from, qint64& watermark, QString& error) {
+    QSqlQuery query(db);
+    if (!query.exec(QString("SELECT MAX(%1) FROM %2 WHERE %1 > %3").arg(table.watermark, table.name).arg(from))
+        || !query.next()) {
+        error = query.lastError().text();
+        return false;
+    }
+    watermark = query.value(0).isNull() ? from : query.value(0).toLongLong();
+    return true;
+}
+
+static QByteArray fileSha256(const QString& path, QString& error) {
+    QFile file(path);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+        error = file.errorString();
+        return QByteArray();
+    }
+    return hash.result().toHex();
+}
+
+QStringList IncrementalBackup::chains(const QString& directory) {
+    QStringList result;
+    const QDir root(directory);
+    // Names carry the baseline's time, so name order is age order
+    for (const QString& name : root.entryList({QString(chainPrefix) + "*"}, QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name | QDir::Reversed)) {
+        if (isChain(root.filePath(name))) result << root.filePath(name);
+    }
+    return result;
+}
+
+bool IncrementalBackup::isChain(const QString& path) {
+    return QFile::exists(QDir(path).filePath(manifestName));
+}
+
+// Dumps a new baseline from the snapshot the caller's transaction holds
+static bool writeBaseline(ReportJobContext& context, const BackupManager::Options& options, const QDateTime& started,
+                          QString& message) {
+    QSqlDatabase db = context.database();
+    const QString chain = QDir(options.directory).filePath(chainPrefix + started.toString("yyyyMMdd_HHmmss"));
+    auto fail = [&](const QString& reason) {
+        QDir(chain).removeRecursively();
+        message = reason;
+        return false;
+    };
+    if (!QDir().mkpath(chain)) return fail("Could not create the backup folder " + chain);
+
+    QJsonObject watermarks;
+    QString error;
+    for (const AppendTable& table : appendTables) {
+        if (table.watermark.isEmpty()) continue;
+        qint64 watermark = 0;
+        if (!readWatermark(db, table, 0, watermark, error)) return fail("Backup failed: " + error);
+        watermarks.insert(table.name, watermark);
+    }
+    QSqlQuery query(db);
+    if (!query.exec("SELECT pg_export_snapshot()") || !query.next()) {
+        return fail("Backup failed: " + query.lastError().text());
+    }
+    int tables = 0;
+    if (!BackupManager::dump(context, options, QDir(chain).filePath("baseline"), query.value(0).toString(), message, &tables)) {
+        return fail(message);
+    }
+
+    QJsonObject baseline;
+    baseline.insert("directory", "baseline");
+    baseline.insert("time", started.toString(Qt::ISODate));
+    baseline.insert("watermarks", watermarks);
+    QJsonObject manifest;
+    manifest.insert("version", 1);
+    manifest.insert("database", db.databaseName());
+    manifest.insert("baseline", baseline);
+    manifest.insert("increments", QJsonArray());
+    if (!writeManifest(chain, manifest, error)) return fail("Could not write the backup manifest: " + error);
+    message = QString("New chain %1\nBaseline of %2 tables").arg(QDir::toNativeSeparators(chain)).arg(tables);
+    return true;
+}
+
+// Exports everything past the chain's watermarks into the next increment folder
+static bool writeIncrement(ReportJobContext& context, const BackupManager::Options& options, const QString& chain,
+                           QJsonObject& manifest, const QDateTime& started, QString& message) {
+    QSqlDatabase db = context.database();
+    QJsonArray increments = manifest.value("increments").toArray();
+    const QJsonObject previous = increments.isEmpty() ? manifest.value("baseline").toObject() : increments.last().toObject();
+    const QString name = QString("%1").arg(increments.size() + 1, 6, 10, QChar('0'));
+    const QDir folder(QDir(chain).filePath(name));
+    auto fail = [&](const QString& reason) {
+        QDir(folder.path()).removeRecursively();
+        message = reason;
+        return false;
+    };
+    QDir(folder.path()).removeRecursively(); // Leftovers of an interrupted run
+    if (!QDir().mkpath(folder.path())) return fail("Could not create the backup folder " + folder.path());
+
+    bool numeric = false;
+    const int level = qBound(1, options.compression.toInt(&numeric), 9);
+
+    QString error;
+    const QJsonObject previousMarks = previous.value("watermarks").toObject();
+    QJsonObject watermarks;
+    QHash<QString, QString> ranges; // Table -> WHERE clause of its new rows
+    for (const AppendTable& table : appendTables) {
+        if (table.watermark.isEmpty()) continue;
+        const qint64 reached = previousMarks.value(table.name).toInteger();
+        const qint64 from = qMax<qint64>(0, reached - watermarkMargin);
+        qint64 to = 0;
+        if (!readWatermark(db, table, from, to, error)) return fail("Backup failed: " + error);
+        to = qMax(to, reached);
+        watermarks.insert(table.name, to);
+        ranges.insert(table.name, QString(" WHERE %1 > %2 AND %1 <= %3").arg(table.watermark).arg(from).arg(to));
+    }
+    ranges.insert("sales_items", " WHERE sale_id IN (SELECT id FROM sales" + ranges.value("sales") + ")");
+
+    QStringList tables = referenceTables;
+    for (const AppendTable& table : appendTables) tables << table.name;
+    QJsonArray segments;
+    qint64 totalRows = 0;
+    qint64 totalBytes = 0;
+    context.setProgress(0, tables.size());
+    for (int i = 0; i < tables.size(); ++i) {
+        const QString& table = tables[i];
+        QStringList columns;
+        if (!tableColumns(db, table, columns, error)) return fail("Backup failed: " + error);
+        QStringList quoted;
+        for (const QString& column : columns) quoted << identifier(db, column);
+
+        const QString file = table + ".copy.gz";
+        GzipFileWriter writer;
+        if (!writer.open(folder.filePath(file), numeric ? level : 6)) {
+            return fail("Could not write " + folder.filePath(file) + ": " + writer.errorString());
+        }
+        qint64 rows = 0;
+        bool written = true;
+        PgCopy copy(db);
+        const bool copied = copy.copyOut(QString("COPY (SELECT %1 FROM %2%3) TO STDOUT").arg(quoted.join(", "), table, ranges.value(table)),
+                                         [&](const char *data, int size) {
+                                             ++rows;
+                                             written = writer.write(data, size);
+                                             return written && !context.isCancelled();
+                                         });
+        if (context.isCancelled()) return fail(QString());
+        if (!written || !writer.finish()) return fail("Could not write " + folder.filePath(file) + ": " + writer.errorString());
+        if (!copied) return fail("Backup failed: " + copy.lastError());
+
+        QJsonObject segment;
+        segment.insert("table", table);
+        segment.insert("file", name + "/" + file);
+        segment.insert("columns", QJsonArray::fromStringList(columns));
+        segment.insert("rows", rows);
+        segment.insert("bytes", writer.bytes());
+        segment.insert("sha256", QString::fromLatin1(writer.sha256()));
+        segments.append(segment);
+        if (!referenceTables.contains(table)) totalRows += rows;
+        totalBytes += writer.bytes();
+        context.setProgress(i + 1, tables.size());
+    }
+
+    QJsonObject increment;
+    increment.insert("directory", name);
+    increment.insert("time", started.toString(Qt::ISODate));
+    increment.insert("watermarks", watermarks);
+    increment.insert("segments", segments);
+    increments.append(increment);
+    manifest.insert("increments", increments);
+    if (!writeManifest(chain, manifest, error)) return fail("Could not write the backup manifest: " + error);
+    message = QString("%1, increment %2\n%3 new rows, %4 KB")
+                  .arg(QDir::toNativeSeparators(chain), name)
+                  .arg(totalRows)
+                  .arg(totalBytes / 1024);
+    return true;
+}
+
+bool IncrementalBackup::run(ReportJobContext& context, const BackupManager::Options& options, QString& message) {
+    QSqlDatabase db = context.database();
+    if (!QDir().mkpath(options.directory)) {
+        message = "Could not create the backup folder " + options.directory;
+        return false;
+    }
+    const QDateTime started = QDateTime::currentDateTime();
+
+    // Extend the newest chain while its baseline is recent and for this database
+    QString chain;
+    QJsonObject manifest;
+    const QStringList existing = chains(options.directory);
+    QString error;
+    if (!existing.isEmpty() && readManifest(existing.first(), manifest, error)) {
+        const QDateTime baseline = QDateTime::fromString(manifest.value("baseline").toObject().value("time").toString(), Qt::ISODate);
+        if (manifest.value("database").toString() == db.databaseName() && baseline.isValid()
+            && baseline.daysTo(started) < options.baselineDays) {
+            chain = existing.first();
+        }
+    }
+
+    // One snapshot for the watermarks and everything exported up to them
+    if (!db.transaction()) {
+        message = "Backup failed: " + db.lastError().text();
+        return false;
+    }
+    QSqlQuery isolation(db);
+    if (!isolation.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ, READ ONLY")) {
+        message = "Backup failed: " + isolation.lastError().text();
+        db.rollback();
+        return false;
+    }
+    bool ok;
+    if (chain.isEmpty()) {
+        ok = writeBaseline(context, options, started, message);
+    } else {
+        context.setStatus("Exporting");
+        ok = writeIncrement(context, options, chain, manifest, started, message);
+    }
+    db.rollback(); // Read only; nothing to commit
+    if (!ok) return false;
+
+    // Rotate: keep the newest chains, and clear out day-old chains that never got a manifest
+    context.setStatus("Rotating");
+    const QStringList kept = chains(options.directory);
+    for (int i = options.keepChains; i < kept.size(); ++i) QDir(kept[i]).removeRecursively();
+    const QDir root(options.directory);
+    for (const QFileInfo& info : root.entryInfoList({QString(chainPrefix) + "*"}, QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (!isChain(info.filePath()) && info.lastModified().secsTo(started) > 24 * 60 * 60) {
+            QDir(info.filePath()).removeRecursively();
+        }
+    }
+    message += QString(" in %1 s").arg(started.secsTo(QDateTime::currentDateTime()));
+    return true;
+}
+
+// Copies one segment into a temporary table, then adds the rows not restored yet
+static bool replaySegment(QSqlDatabase db, const QString& chain, const QJsonObject& segment,
+                          ReportJobContext& context, QString& error) {
+    const QString table = segment.value("table").toString();
+    QStringList columns;
+    QStringList values;
+    for (const QJsonValue& value : segment.value("columns").toArray()) {
+        const QString column = value.toString();
+        columns << identifier(db, column);
+        values << replayOverrides.value(table + "." + column, "s." + identifier(db, column));
+    }
+    QFile file(QDir(chain).filePath(segment.value("file").toString()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.fileName() + ": " + file.errorString();
+        return false;
+    }
+
+    if (!db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+    auto fail = [&](const QString& reason) {
+        db.rollback();
+        error = table + ": " + reason;
+        return false;
+    };
+    QSqlQuery query(db);
+    if (!query.exec(QString("CREATE TEMP TABLE restore_segment (LIKE %1) ON COMMIT DROP").arg(table))) {
+        return fail(query.lastError().text());
+    }
+    PgCopy copy(db);
+    if (!copy.beginIn(QString("COPY restore_segment (%1) FROM STDIN").arg(columns.join(", ")))) return fail(copy.lastError());
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        copy.endIn("zlib initialisation failed");
+        return fail("zlib initialisation failed");
+    }
+    QByteArray input;
+    QByteArray output(chunkSize, Qt::Uninitialized);
+    int result = Z_OK;
+    QString problem;
+    while (problem.isEmpty() && result != Z_STREAM_END) {
+        if (stream.avail_in == 0) {
+            input = file.read(chunkSize);
+            if (input.isEmpty()) {
+                problem = "truncated file";
+                break;
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(input.data());
+            stream.avail_in = uInt(input.size());
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = uInt(output.size());
+        result = inflate(&stream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            problem = stream.msg ? QString::fromLatin1(stream.msg) : QString("corrupt file");
+        } else if (!copy.putData(output.left(output.size() - int(stream.avail_out)))) {
+            problem = copy.lastError();
+        } else if (context.isCancelled()) {
+            problem = "Cancelled";
+        }
+    }
+    inflateEnd(&stream);
+    if (!problem.isEmpty()) {
+        copy.endIn(problem);
+        return fail(problem);
+    }
+    if (!copy.endIn()) return fail(copy.lastError());
+    if (!query.exec(QString("INSERT INTO %1 (%2) SELECT %3 FROM restore_segment s "
+                            "WHERE NOT EXISTS (SELECT 1 FROM %1 t WHERE t.id = s.id)")
+                        .arg(table, columns.join(", "), values.join(", ")))) {
+        return fail(query.lastError().text());
+    }
+    if (!db.commit()) return fail(db.lastError().text());
+    return true;
+}
+
+// Loads the last increment's copy of a reference table and upserts it by id.
+// The copy stays in restore_<table> for the rest of the session.
+static bool loadReference(const QSqlDatabase& db, const QString& chain, const QJsonObject& segment, QString& error) {
+    const QString table = segment.value("table").toString();
+    QStringList columns;
+    QStringList updates;
+    for (const QJsonValue& value : segment.value("columns").toArray()) {
+        const QString column = identifier(db, value.toString());
+        columns << column;
+        if (value.toString() != "id") updates << column + " = EXCLUDED." + column;
+    }
+    QFile file(QDir(chain).filePath(segment.value("file").toString()));
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.fileName() + ": " + file.errorString();
+        return false;
+    }
+    // Reference tables are small; read the whole file
+    QByteArray data;
+    z_stream stream = {};
+    inflateInit2(&stream, 16 + MAX_WBITS);
+    const QByteArray compressed = file.readAll();
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.constData()));
+    stream.avail_in = uInt(compressed.size());
+    QByteArray output(chunkSize, Qt::Uninitialized);
+    int result;
+    do {
+        stream.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream.avail_out = uInt(output.size());
+        result = inflate(&stream, Z_NO_FLUSH);
+        data += output.left(output.size() - int(stream.avail_out));
+    } while (result == Z_OK);
+    inflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        error = table + ": corrupt file";
+        return false;
+    }
+
+    QSqlQuery query(db);
+    PgCopy copy(db);
+    const QString staging = "restore_" + table;
+    if (!query.exec(QString("CREATE TEMP TABLE %1 (LIKE %2)").arg(staging, table))
+        || !copy.beginIn(QString("COPY %1 (%2) FROM STDIN").arg(staging, columns.join(", ")))) {
+        error = table + ": " + (copy.lastError().isEmpty() ? query.lastError().text() : copy.lastError());
+        return false;
+    }
+    if (!copy.putData(data) || !copy.endIn()) {
+        error = table + ": " + copy.lastError();
+        return false;
+    }
+    if (!query.exec(QString("INSERT INTO %1 (%2) SELECT %2 FROM %3 ON CONFLICT (id) DO UPDATE SET %4")
+                        .arg(table, columns.join(", "), staging, updates.join(", ")))) {
+        error = table + ": " + query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Replays the increments into database, which holds the restored baseline.
+// Its connections are closed again on return, so the caller can drop it.
+static bool replay(ReportJobContext& context, const QString& database, const QString& chain,
+                   const QHash<QString, QList<QJsonObject>>& segments, QString& error) {
+    const QSqlDatabase server = context.database();
+    auto fail = [&](const QString& reason) {
+        error = reason;
+        return false;
+    };
+    TargetConnection target(server, database);
+    QSqlDatabase db = target.database();
+    if (!db.isOpen()) return fail("Could not connect to " + database + ": " + db.lastError().text());
+    // Increments can reach months the baseline has no partitions for yet
+    QSqlQuery query(db);
+    if (!query.exec("SELECT ensure_monthly_partitions(c.relname::text, 3) FROM pg_partitioned_table p "
+                    "JOIN pg_class c ON c.oid = p.partrelid JOIN pg_namespace n ON n.oid = c.relnamespace "
+                    "WHERE n.nspname = current_schema()")) {
+        return fail("Restore failed: " + query.lastError().text());
+    }
+    // Sales and stock movements refer to users and products added since the baseline
+    for (const QString& table : referenceTables) {
+        if (segments.value(table).isEmpty()) continue;
+        if (!loadReference(db, chain, segments.value(table).last(), error)) return fail("Restore failed: " + error);
+    }
+
+    // The table groups replay side by side, each on its own connection
+    std::atomic<int> replayed{0};
+    QMutex errorMutex;
+    QStringList errors;
+    int appendSegments = 0;
+    for (const QStringList& group : replayGroups) {
+        for (const QString& table : group) appendSegments += segments.value(table).size();
+    }
+    context.setProgress(0, appendSegments);
+    QList<QStringList> groups = replayGroups;
+    QtConcurrent::blockingMap(groups, [&](const QStringList& group) {
+        TargetConnection worker(server, database);
+        QSqlDatabase workerDb = worker.database();
+        QString workerError;
+        bool ok = workerDb.isOpen();
+        if (!ok) workerError = workerDb.lastError().text();
+        for (const QString& table : group) {
+            for (const QJsonObject& segment : segments.value(table)) {
+                if (!ok || context.isCancelled()) break;
+                ok = replaySegment(workerDb, chain, segment, context, workerError);
+                context.setProgress(++replayed, appendSegments);
+            }
+        }
+        if (!ok) {
+            QMutexLocker locker(&errorMutex);
+            errors << workerError;
+        }
+    });
+    if (context.isCancelled()) return false;
+    if (!errors.isEmpty()) return fail("Restore failed: " + errors.join('\n'));
+
+    // Replaying stock movements moved products.quantity again; the last
+    // copy of products already had those movements in it
+    if (!segments.value("products").isEmpty()
+        && !query.exec("UPDATE products p SET quantity = r.quantity FROM restore_products r WHERE p.id = r.id")) {
+        return fail("Restore failed: " + query.lastError().text());
+    }
+    // Sequences continue after the restored rows, and terminals reserve
+    // fresh sale ID blocks rather than reusing ones recorded at the baseline
+    if (!query.exec("SELECT table_name::text, column_name::text FROM information_schema.columns "
+                    "WHERE table_schema = current_schema() AND column_default LIKE 'nextval(%'")) {
+        return fail("Restore failed: " + query.lastError().text());
+    }
+    QList<QPair<QString, QString>> sequences;
+    while (query.next()) sequences << qMakePair(query.value(0).toString(), query.value(1).toString());
+    for (const auto& sequence : sequences) {
+        if (!query.exec(QString("SELECT setval(pg_get_serial_sequence('%1', '%2'), m) FROM (SELECT MAX(%3) AS m FROM %4) x "
+                                "WHERE m IS NOT NULL")
+                            .arg(sequence.first, sequence.second, identifier(db, sequence.second), identifier(db, sequence.first)))) {
+            return fail("Restore failed: " + query.lastError().text());
+        }
+    }
+    if (!query.exec("UPDATE sale_id_blocks SET next_unused = block_start + block_size, released_at = COALESCE(released_at, NOW())")
+        || !query.exec("ANALYZE")) {
+        return fail("Restore failed: " + query.lastError().text());
+    }
+    return true;
+}
+
+bool IncrementalBackup::restore(ReportJobContext& context, const BackupManager::Options& options, const QString& chain,
+                                const QString& database, QString& message) {
+    QJsonObject manifest;
+    QString error;
+    if (!readManifest(chain, manifest, error)) {
+        message = "Could not read the backup manifest: " + error;
+        return false;
+    }
+    const QJsonArray increments = manifest.value("increments").toArray();
+
+    // Every file must match its checksum before anything is restored
+    context.setStatus("Checking");
+    QHash<QString, QList<QJsonObject>> segments; // Table -> its segments, oldest first
+    int segmentCount = 0;
+    for (const QJsonValue& increment : increments) {
+        for (const QJsonValue& value : increment.toObject().value("segments").toArray()) {
+            const QJsonObject segment = value.toObject();
+            const QString path = QDir(chain).filePath(segment.value("file").toString());
+            if (fileSha256(path, error) != segment.value("sha256").toString().toLatin1()) {
+                message = QString("Backup file %1 is missing or corrupt%2.")
+                              .arg(QDir::toNativeSeparators(path), error.isEmpty() ? QString() : " (" + error + ")");
+                return false;
+            }
+            segments[segment.value("table").toString()] << segment;
+            ++segmentCount;
+            if (context.isCancelled()) return false;
+        }
+    }
+    if (!BackupManager::isVerified(QDir(chain).filePath("baseline"))) {
+        message = "The chain's baseline is missing or was never verified.";
+        return false;
+    }
+
+    if (!BackupManager::restore(context, options, QDir(chain).filePath("baseline"), database, message)) return false;
+    QSqlDatabase server = context.database();
+    auto fail = [&](const QString& reason) {
+        QSqlQuery(server).exec("DROP DATABASE IF EXISTS " + server.driver()->escapeIdentifier(database, QSqlDriver::TableName));
+        message = reason;
+        return false;
+    };
+    if (increments.isEmpty()) return true;
+
+    context.setStatus("Replaying");
+    if (!replay(context, database, chain, segments, error)) return fail(error);
+
+    const QJsonObject last = increments.last().toObject();
+    message = QString("Restored %1 into %2: baseline of %3 and %4 increments through %5 (%6 files)")
+                  .arg(QDir::toNativeSeparators(chain), database,
+                       manifest.value("baseline").toObject().value("time").toString())
+                  .arg(increments.size())
+                  .arg(last.value("time").toString())
+                  .arg(segmentCount);
+    return true;
+}
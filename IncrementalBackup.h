@@ -0,0 +1,37 @@
+#pragma once
+#include "BackupManager.h"
+#include <QString>
+#include <QStringList>
+
+class ReportJobContext;
+
+// Incremental backups of the append-only tables, so a nightly backup costs
+// about as much as the day's sales rather than the whole history.
+//
+// A chain starts with a full baseline (BackupManager::dump, reading an
+// exported snapshot) and records the watermarks that snapshot reached:
+// sales.ingest_seq and the ids of activity_log and stock_movements. Each
+// later run exports the rows past the watermarks, plus the sales_items of
+// those sales, as gzipped COPY files in a numbered increment folder. users
+// and products change in place but are small, so every increment carries a
+// full copy of them. The chain's manifest.json lists each file with its row
+// count and SHA-256, and is only rewritten once an increment is complete.
+//
+// Increments start watermarkMargin below the previous watermark, since a sale
+// can commit after one with a higher ingest_seq; restore drops the repeats by id.
+//
+// Restore checks every checksum, restores the baseline into a new database
+// with parallel pg_restore, then replays the increments on one connection per
+// table group (sales with their items, activity_log, stock_movements).
+class IncrementalBackup {
+public:
+    static QStringList chains(const QString& directory); // Newest first
+    static bool isChain(const QString& path);
+
+    // Adds an increment to the newest chain, or starts a new chain when there
+    // is none or its baseline is older than options.baselineDays.
+    static bool run(ReportJobContext& context, const BackupManager::Options& options, QString& message);
+    // database must not exist yet; it is dropped again on failure
+    static bool restore(ReportJobContext& context, const BackupManager::Options& options, const QString& chain,
+                        const QString& database, QString& message);
+};
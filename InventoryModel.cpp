@@ -0,0 +1,193 @@
+#include "InventoryModel.h"
+#include "ProductSearch.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QColor>
+#include <QDebug>
+
+InventoryModel::InventoryModel(QObject *parent) : QAbstractTableModel(parent) {
+}
+
+int InventoryModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : products.size();
+}
+
+int InventoryModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+InventoryModel::StockStatus InventoryModel::statusOf(const Product &product) {
+    if (product.quantity == 0) return OutOfStock;
+    if (product.quantity <= product.minStock) return LowStock;
+    return InStock;
+}
+
+QVariant InventoryModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= products.size()) return QVariant();
+    const Product &product = products[index.row()];
+    if (role == StatusRole) return statusOf(product);
+    if (role != Qt::DisplayRole) return QVariant();
+    switch (index.column()) {
+    case NameColumn: return product.name;
+    case CategoryColumn: return product.category;
+    case PriceColumn: return QString("$%1").arg(product.price, 0, 'f', 2);
+    case QuantityColumn: return product.quantity;
+    case MinStockColumn: return product.minStock;
+    case StockoutColumn: return product.stockoutDate.isValid() ? product.stockoutDate.toString("yyyy-MM-dd") : QString();
+    case ReorderColumn: return product.suggestedOrder > 0 ? QVariant(product.suggestedOrder) : QVariant();
+    case StatusColumn: {
+        switch (statusOf(product)) {
+        case OutOfStock: return QString("Out of Stock");
+        case LowStock: return QString("Low Stock");
+        case InStock: return QString("In Stock");
+        }
+    }
+    }
+    return QVariant();
+}
+
+QVariant InventoryModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const QStringList headers = {"Name", "Category", "Price", "Quantity", "Min Stock", "Stock-out", "Reorder", "Status"};
+    return headers.value(section);
+}
+
+bool InventoryModel::canFetchMore(const QModelIndex &parent) const {
+    return !parent.isValid() && !atEnd;
+}
+
+void InventoryModel::fetchMore(const QModelIndex &parent) {
+    if (parent.isValid() || atEnd) return;
+    QList<Product> page = fetchPage();
+    if (page.isEmpty()) return;
+    beginInsertRows(QModelIndex(), products.size(), products.size() + page.size() - 1);
+    products.append(page);
+    endInsertRows();
+}
+
+void InventoryModel::reload() {
+    beginResetModel();
+    products.clear();
+    lastSortKey = QVariant();
+    lastId = 0;
+    atEnd = false;
+    endResetModel();
+    fetchMore(QModelIndex());
+}
+
+void InventoryModel::sortBy(int column, Qt::SortOrder order) {
+    if (column < 0 || column >= ColumnCount) column = NameColumn;
+    sortColumn = column;
+    sortOrder = order;
+    rankOrder = false;
+    reload();
+}
+
+void InventoryModel::setSearchText(const QString &text) {
+    if (text == searchText) return;
+    searchText = text;
+    rankOrder = !searchText.isEmpty(); // New searches list best matches first
+    reload();
+}
+
+Product InventoryModel::productAt(int row) const {
+    return products.value(row);
+}
+
+QString InventoryModel::sortExpression() const {
+    if (rankOrder) return ProductSearch::rankExpression();
+    switch (sortColumn) {
+    case CategoryColumn: return "COALESCE(category, '')";
+    case PriceColumn: return "price";
+    case QuantityColumn: return "quantity";
+    case MinStockColumn: return "min_stock";
+    case StockoutColumn: return "COALESCE(f.stockout_date, DATE '9999-12-31')"; // Never runs out: last
+    case ReorderColumn: return "COALESCE(f.suggested_order, 0)";
+    case StatusColumn: return "(CASE WHEN quantity = 0 THEN 0 WHEN quantity <= min_stock THEN 1 ELSE 2 END)";
+    default: return "name";
+    }
+}
+
+QList<Product> InventoryModel::fetchPage() {
+    const QString key = sortExpression();
+    const QVariantList keyBinds = rankOrder ? ProductSearch::rankBindValues(searchText) : QVariantList();
+    const bool ascending = !rankOrder && sortOrder == Qt::AscendingOrder;
+    QVariantList binds = keyBinds;
+    QStringList conditions;
+    if (!searchText.isEmpty()) {
+        conditions << ProductSearch::matchCondition();
+        binds += ProductSearch::matchBindValues(searchText);
+    }
+    if (lastSortKey.isValid()) {
+        conditions << QString("(%1, id) %2 (?, ?)").arg(key, ascending ? ">" : "<");
+        binds += keyBinds;
+        binds << lastSortKey << lastId;
+    }
+    QString sql = QString("SELECT id, name, category, price, quantity, min_stock, description, f.stockout_date, "
+                          "f.suggested_order, %1 AS sort_key FROM products "
+                          "LEFT JOIN product_forecasts f ON f.product_id = products.id").arg(key);
+    if (!conditions.isEmpty()) sql += " WHERE " + conditions.join(" AND ");
+    const QString direction = ascending ? "ASC" : "DESC";
+    sql += QString(" ORDER BY sort_key %1, id %1 LIMIT %2").arg(direction).arg(pageSize);
+
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (const QVariant &value : binds) query.addBindValue(value);
+    QList<Product> page;
+    if (!query.exec()) {
+        qDebug() << "Failed to load products:" << query.lastError().text();
+        atEnd = true;
+        return page;
+    }
+    while (query.next()) {
+        Product p;
+        p.id = query.value(0).toInt();
+        p.name = query.value(1).toString();
+        p.category = query.value(2).toString();
+        p.price = query.value(3).toDouble();
+        p.quantity = query.value(4).toInt();
+        p.minStock = query.value(5).toInt();
+        p.description = query.value(6).toString();
+        p.stockoutDate = query.value(7).toDate();
+        p.suggestedOrder = query.value(8).toInt();
+        lastSortKey = query.value(9);
+        lastId = p.id;
+        page.append(p);
+    }
+    atEnd = page.size() < pageSize;
+    return page;
+}
+
+InventoryProxyModel::InventoryProxyModel(QObject *parent) : QSortFilterProxyModel(parent) {
+}
+
+InventoryModel *InventoryProxyModel::inventoryModel() const {
+    return qobject_cast<InventoryModel *>(sourceModel());
+}
+
+void InventoryProxyModel::sort(int column, Qt::SortOrder order) {
+    // Deliberately not calling the base class: the database does the ordering
+    if (InventoryModel *model = inventoryModel()) model->sortBy(column, order);
+}
+
+void InventoryProxyModel::setSearchText(const QString &text) {
+    if (InventoryModel *model = inventoryModel()) model->setSearchText(text);
+}
+
+void InventoryStatusDelegate::initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const {
+    QStyledItemDelegate::initStyleOption(option, index);
+    switch (index.data(InventoryModel::StatusRole).toInt()) {
+    case InventoryModel::OutOfStock:
+        option->backgroundBrush = QColor("#FFCDD2"); // light red
+        if (index.column() == InventoryModel::StatusColumn) option->palette.setColor(QPalette::Text, QColor("#F44336"));
+        break;
+    case InventoryModel::LowStock:
+        option->backgroundBrush = QColor("#FFF9C4"); // light yellow
+        if (index.column() == InventoryModel::StatusColumn) option->palette.setColor(QPalette::Text, QColor("#FF9800"));
+        break;
+    default:
+        if (index.column() == InventoryModel::StatusColumn) option->palette.setColor(QPalette::Text, QColor("#4CAF50"));
+        break;
+    }
+}
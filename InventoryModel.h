@@ -0,0 +1,72 @@
+#pragma once
+#include <QAbstractTableModel>
+#include <QSortFilterProxyModel>
+#include <QStyledItemDelegate>
+#include <QList>
+#include <QVariant>
+#include "Product.h"
+
+// Pages products in from PostgreSQL as the view scrolls. Sorting and search
+// are pushed into the query (keyset paging on the sort key + id), so opening
+// the tab costs one page no matter how large the catalog is. Searches use
+// ProductSearch and come back best match first until a column is sorted.
+class InventoryModel : public QAbstractTableModel {
+    Q_OBJECT
+public:
+    enum Column { NameColumn, CategoryColumn, PriceColumn, QuantityColumn, MinStockColumn, StockoutColumn, ReorderColumn, StatusColumn, ColumnCount };
+    enum StockStatus { OutOfStock, LowStock, InStock };
+    static constexpr int StatusRole = Qt::UserRole + 1;
+    static constexpr int pageSize = 200;
+
+    explicit InventoryModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    void reload();
+    void sortBy(int column, Qt::SortOrder order);
+    void setSearchText(const QString &text);
+    Product productAt(int row) const;
+    QList<Product> loadedProducts() const { return products; }
+    static StockStatus statusOf(const Product &product);
+
+private:
+    QString sortExpression() const;
+    QList<Product> fetchPage();
+
+    QList<Product> products;
+    QVariant lastSortKey; // Keyset position of the last loaded row
+    int lastId = 0;
+    bool atEnd = false;
+    int sortColumn = NameColumn;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+    QString searchText;
+    bool rankOrder = false; // Ordered by search relevance rather than a column
+};
+
+// Hands sort and filter requests to InventoryModel instead of sorting the
+// loaded rows locally, which would only ever see the pages fetched so far.
+class InventoryProxyModel : public QSortFilterProxyModel {
+    Q_OBJECT
+public:
+    explicit InventoryProxyModel(QObject *parent = nullptr);
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+    void setSearchText(const QString &text);
+
+private:
+    InventoryModel *inventoryModel() const;
+};
+
+// Colours rows and the status column from the model's stock status
+class InventoryStatusDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+protected:
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
+};
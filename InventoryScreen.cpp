@@ -1,10 +1,15 @@
 #include "InventoryScreen.h"
 #include "ReportsScreen.h"
+#include "InventoryModel.h"
+#include "ProductCsvImporter.h"
+#include "StockLedger.h"
+#include "ReorderForecaster.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
 #include <QLabel>
 #include <QPushButton>
+#include <QTableView>
 #include <QTableWidget>
 #include <QLineEdit>
 #include <QSpinBox>
@@ -12,14 +17,21 @@
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QFont>
+#include <QColor>
 #include <QFrame>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QInputDialog>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QVariant>
 #include <QDebug>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QProgressDialog>
+#include <QApplication>
+#include <QDateTime>
 
 // AddProductDialog Implementation
 AddProductDialog::AddProductDialog(QWidget *parent) : QDialog(parent) {
@@ -99,29 +111,132 @@ Product AddProductDialog::getProduct() const {
     return product;
 }
 
+// StockCountDialog Implementation
+StockCountDialog::StockCountDialog(const QList<Product>& selected, QWidget *parent) : QDialog(parent) {
+    setWindowTitle("Stock Count");
+    setModal(true);
+    resize(560, 480);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    scanEdit = new QLineEdit;
+    scanEdit->setPlaceholderText("Scan or type a product name and press Enter to count one");
+    scanEdit->setStyleSheet("QLineEdit { padding: 8px; border: 2px solid #444; border-radius: 6px; background: #2d313a; color: white; }");
+    connect(scanEdit, &QLineEdit::returnPressed, this, &StockCountDialog::scanEntered);
+    layout->addWidget(scanEdit);
+
+    countTable = new QTableWidget(0, 4);
+    countTable->setHorizontalHeaderLabels({"Product", "System Qty", "Counted", "Difference"});
+    countTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    countTable->verticalHeader()->setVisible(false);
+    countTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    countTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    layout->addWidget(countTable);
+    for (const Product &product : selected) addRow(product, product.quantity);
+
+    statusLabel = new QLabel("Selected products start at their system quantity; the first scan of a product starts it at 1.");
+    statusLabel->setWordWrap(true);
+    layout->addWidget(statusLabel);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    buttonBox->button(QDialogButtonBox::Ok)->setText("Apply Counts");
+    for (QAbstractButton *button : buttonBox->buttons()) {
+        if (QPushButton *pushButton = qobject_cast<QPushButton *>(button)) pushButton->setAutoDefault(false); // Enter belongs to the scanner
+    }
+    buttonBox->setStyleSheet("QPushButton { padding: 8px 16px; border: none; border-radius: 6px; background: #2196F3; color: white; } QPushButton:hover { background: #1976D2; } QPushButton[text='Cancel'] { background: #666; } QPushButton[text='Cancel']:hover { background: #555; }");
+    connect(buttonBox, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttonBox);
+
+    scanEdit->setFocus();
+}
+
+int StockCountDialog::addRow(const Product& product, int counted) {
+    const int row = countTable->rowCount();
+    countTable->insertRow(row);
+    products.append(product);
+    countTable->setItem(row, 0, new QTableWidgetItem(product.name));
+    countTable->setItem(row, 1, new QTableWidgetItem(QString::number(product.quantity)));
+    countTable->setItem(row, 3, new QTableWidgetItem);
+    QSpinBox *countSpinBox = new QSpinBox;
+    countSpinBox->setRange(0, 99999);
+    countTable->setCellWidget(row, 2, countSpinBox);
+    // Rows are only ever appended, so the captured row stays valid
+    connect(countSpinBox, qOverload<int>(&QSpinBox::valueChanged), this, [this, row]() { updateDifference(row); });
+    setCounted(row, counted);
+    return row;
+}
+
+void StockCountDialog::setCounted(int row, int counted) {
+    qobject_cast<QSpinBox *>(countTable->cellWidget(row, 2))->setValue(counted);
+    updateDifference(row);
+}
+
+void StockCountDialog::updateDifference(int row) {
+    const int counted = qobject_cast<QSpinBox *>(countTable->cellWidget(row, 2))->value();
+    const int difference = counted - products[row].quantity;
+    QTableWidgetItem *item = countTable->item(row, 3);
+    item->setText(difference == 0 ? QString() : QString("%1%2").arg(difference > 0 ? "+" : "").arg(difference));
+    item->setForeground(difference < 0 ? QColor("#F44336") : QColor("#4CAF50"));
+}
+
+void StockCountDialog::scanEntered() {
+    const QString name = scanEdit->text().trimmed();
+    scanEdit->clear();
+    if (name.isEmpty()) return;
+    int row = -1;
+    for (int i = 0; i < products.size() && row < 0; ++i) {
+        if (products[i].name.compare(name, Qt::CaseInsensitive) == 0) row = i;
+    }
+    if (row < 0) {
+        QSqlQuery query;
+        query.prepare("SELECT id, name, category, price, quantity, min_stock, description FROM products WHERE lower(name) = lower(?) LIMIT 1");
+        query.addBindValue(name);
+        if (!query.exec() || !query.next()) {
+            statusLabel->setText(QString("No product named \"%1\".").arg(name));
+            QApplication::beep();
+            return;
+        }
+        Product product;
+        product.id = query.value(0).toInt();
+        product.name = query.value(1).toString();
+        product.category = query.value(2).toString();
+        product.price = query.value(3).toDouble();
+        product.quantity = query.value(4).toInt();
+        product.minStock = query.value(5).toInt();
+        product.description = query.value(6).toString();
+        row = addRow(product, 0);
+    }
+    const int id = products[row].id;
+    QSpinBox *countSpinBox = qobject_cast<QSpinBox *>(countTable->cellWidget(row, 2));
+    const int counted = scannedIds.contains(id) ? countSpinBox->value() + 1 : 1;
+    scannedIds.insert(id);
+    setCounted(row, counted);
+    countTable->selectRow(row);
+    statusLabel->setText(QString("%1: %2 counted").arg(products[row].name).arg(counted));
+}
+
+QMap<int, int> StockCountDialog::changedCounts() const {
+    QMap<int, int> counts;
+    for (int row = 0; row < products.size(); ++row) {
+        const int counted = qobject_cast<QSpinBox *>(countTable->cellWidget(row, 2))->value();
+        if (counted != products[row].quantity) counts.insert(products[row].id, counted);
+    }
+    return counts;
+}
+
 // InventoryScreen Implementation
 QList<Product> InventoryScreen::getProducts() const {
-    return products;
+    return inventoryModel->loadedProducts();
 }
 
 void InventoryScreen::loadProductsFromDatabase() {
-    products.clear();
-    QSqlQuery query("SELECT id, name, category, price, quantity, min_stock, description FROM products");
-    while (query.next()) {
-        Product p;
-        p.id = query.value(0).toInt();
-        p.name = query.value(1).toString();
-        p.category = query.value(2).toString();
-        p.price = query.value(3).toDouble();
-        p.quantity = query.value(4).toInt();
-        p.minStock = query.value(5).toInt();
-        p.description = query.value(6).toString();
-        products.append(p);
-    }
-    refreshInventory();
+    inventoryModel->reload();
+    updateLowStockIndicator();
 }
 
-InventoryScreen::InventoryScreen(QWidget *parent) : QWidget(parent) {
+InventoryScreen::InventoryScreen(QWidget *parent)
+    : QWidget(parent), csvImporter(new ProductCsvImporter(this)), forecaster(new ReorderForecaster(this)) {
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
     mainLayout->setSpacing(20);
     mainLayout->setContentsMargins(20, 20, 20, 20);
@@ -143,7 +258,11 @@ InventoryScreen::InventoryScreen(QWidget *parent) : QWidget(parent) {
     searchBox = new QLineEdit;
     searchBox->setPlaceholderText("Search products...");
     searchBox->setStyleSheet("QLineEdit { padding: 10px; border: 2px solid #444; border-radius: 8px; background: #2d313a; color: white; font-size: 14px; } QLineEdit:focus { border-color: #2196F3; }");
-    connect(searchBox, &QLineEdit::textChanged, this, &InventoryScreen::searchProducts);
+    searchTimer = new QTimer(this);
+    searchTimer->setSingleShot(true);
+    searchTimer->setInterval(250);
+    connect(searchTimer, &QTimer::timeout, this, &InventoryScreen::searchProducts);
+    connect(searchBox, &QLineEdit::textChanged, searchTimer, qOverload<>(&QTimer::start));
     
     addButton = new QPushButton("Add Product");
     addButton->setStyleSheet("QPushButton { background: #4CAF50; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #45a049; }");
@@ -153,6 +272,10 @@ InventoryScreen::InventoryScreen(QWidget *parent) : QWidget(parent) {
     editButton->setStyleSheet("QPushButton { background: #2196F3; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #1976D2; }");
     connect(editButton, &QPushButton::clicked, this, &InventoryScreen::editProduct);
     
+    countButton = new QPushButton("Stock Count");
+    countButton->setStyleSheet("QPushButton { background: #009688; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #00796B; }");
+    connect(countButton, &QPushButton::clicked, this, &InventoryScreen::countStock);
+    
     deleteButton = new QPushButton("Delete Product");
     deleteButton->setStyleSheet("QPushButton { background: #F44336; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #d32f2f; }");
     connect(deleteButton, &QPushButton::clicked, this, &InventoryScreen::deleteProduct);
@@ -161,13 +284,24 @@ InventoryScreen::InventoryScreen(QWidget *parent) : QWidget(parent) {
     refreshButton->setStyleSheet("QPushButton { background: #FF9800; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #F57C00; }");
     connect(refreshButton, &QPushButton::clicked, this, &InventoryScreen::refreshInventory);
     
+    importButton = new QPushButton("Import CSV");
+    importButton->setStyleSheet("QPushButton { background: #9C27B0; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #7B1FA2; }");
+    connect(importButton, &QPushButton::clicked, this, &InventoryScreen::importProducts);
+    
+    forecastButton = new QPushButton("Forecast");
+    forecastButton->setStyleSheet("QPushButton { background: #3F51B5; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #303F9F; }");
+    connect(forecastButton, &QPushButton::clicked, this, &InventoryScreen::runForecast);
+    
     searchLayout->addWidget(searchLabel);
     searchLayout->addWidget(searchBox);
     searchLayout->addStretch();
     searchLayout->addWidget(addButton);
     searchLayout->addWidget(editButton);
+    searchLayout->addWidget(countButton);
     searchLayout->addWidget(deleteButton);
     searchLayout->addWidget(refreshButton);
+    searchLayout->addWidget(importButton);
+    searchLayout->addWidget(forecastButton);
     
     mainLayout->addLayout(searchLayout);
 
@@ -186,20 +320,27 @@ InventoryScreen::InventoryScreen(QWidget *parent) : QWidget(parent) {
     
     mainLayout->addLayout(statsLayout);
 
-    // Inventory Table
-    inventoryTable = new QTableWidget;
-    inventoryTable->setColumnCount(6);
-    inventoryTable->setHorizontalHeaderLabels({"Name", "Category", "Price", "Quantity", "Min Stock", "Status"});
-    inventoryTable->setStyleSheet("QTableWidget { background: #2d313a; border: 2px solid #444; border-radius: 8px; color: white; gridline-color: #444; } QHeaderView::section { background: #3a3f4b; color: white; padding: 8px; border: none; } QTableWidget::item { padding: 8px; }");
+    // Inventory Table (rows are paged in from the database as the view scrolls)
+    inventoryModel = new InventoryModel(this);
+    proxyModel = new InventoryProxyModel(this);
+    proxyModel->setSourceModel(inventoryModel);
+    inventoryTable = new QTableView;
+    inventoryTable->setModel(proxyModel);
+    inventoryTable->setItemDelegate(new InventoryStatusDelegate(inventoryTable));
+    inventoryTable->setStyleSheet("QTableView { background: #2d313a; border: 2px solid #444; border-radius: 8px; color: white; gridline-color: #444; } QHeaderView::section { background: #3a3f4b; color: white; padding: 8px; border: none; } QTableView::item { padding: 8px; }");
     inventoryTable->horizontalHeader()->setStretchLastSection(true);
+    inventoryTable->verticalHeader()->setVisible(false);
     inventoryTable->setAlternatingRowColors(true);
     inventoryTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    inventoryTable->setSelectionMode(QAbstractItemView::ExtendedSelection); // Multi-select for stock counts
+    inventoryTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    inventoryTable->horizontalHeader()->setSortIndicator(InventoryModel::NameColumn, Qt::AscendingOrder);
+    inventoryTable->setSortingEnabled(true); // Loads the first page through the proxy
     
     mainLayout->addWidget(inventoryTable);
 
     setupInventoryTable();
     updateLowStockIndicator();
-    loadProductsFromDatabase();
 }
 
 void InventoryScreen::setupInventoryTable() {
@@ -209,15 +350,23 @@ void InventoryScreen::setupInventoryTable() {
     inventoryTable->setColumnWidth(2, 100); // Price
     inventoryTable->setColumnWidth(3, 100); // Quantity
     inventoryTable->setColumnWidth(4, 100); // Min Stock
-    inventoryTable->setColumnWidth(5, 120); // Status
+    inventoryTable->setColumnWidth(5, 110); // Stock-out
+    inventoryTable->setColumnWidth(6, 80);  // Reorder
+    inventoryTable->setColumnWidth(7, 120); // Status
 }
 
 void InventoryScreen::loadSampleData() {
     // This method is no longer used - all data comes from user input
-    products.clear();
     refreshInventory();
 }
 
+bool InventoryScreen::currentProduct(Product &product) const {
+    QModelIndex index = inventoryTable->currentIndex();
+    if (!index.isValid()) return false;
+    product = inventoryModel->productAt(proxyModel->mapToSource(index).row());
+    return product.id != -1;
+}
+
 void InventoryScreen::setUsername(const QString& uname) {
     username = uname;
 }
@@ -238,59 +387,100 @@ void InventoryScreen::addProduct() {
             QMessageBox::warning(this, "Warning", "A product with this name already exists!");
             return;
         }
+        // The product starts at zero; its opening stock is a receipt on the ledger
+        QSqlDatabase db = QSqlDatabase::database();
+        if (!db.transaction()) {
+            QMessageBox::critical(this, "Error", "Failed to add product: " + db.lastError().text());
+            return;
+        }
         QSqlQuery insertQuery;
-        insertQuery.prepare("INSERT INTO products (name, category, price, quantity, min_stock, description) VALUES (?, ?, ?, ?, ?, ?)");
+        insertQuery.prepare("INSERT INTO products (name, category, price, quantity, min_stock, description) VALUES (?, ?, ?, 0, ?, ?) RETURNING id");
         insertQuery.addBindValue(newProduct.name);
         insertQuery.addBindValue(newProduct.category);
         insertQuery.addBindValue(newProduct.price);
-        insertQuery.addBindValue(newProduct.quantity);
         insertQuery.addBindValue(newProduct.minStock);
         insertQuery.addBindValue(newProduct.description);
-        if (!insertQuery.exec()) {
-            QMessageBox::critical(this, "Error", "Failed to add product: " + insertQuery.lastError().text());
+        QString error;
+        int productId = 0;
+        if (!insertQuery.exec() || !insertQuery.next()) {
+            error = insertQuery.lastError().text();
+        } else {
+            productId = insertQuery.value(0).toInt();
+            if (StockLedger::record(productId, newProduct.quantity, StockLedger::Receipt, "Opening stock", username, &error)
+                && !db.commit()) {
+                error = db.lastError().text();
+            }
+        }
+        if (!error.isEmpty()) {
+            db.rollback();
+            QMessageBox::critical(this, "Error", "Failed to add product: " + error);
             return;
         }
         loadProductsFromDatabase();
         emit inventoryChanged();
         QMessageBox::information(this, "Success", "Product added successfully!");
         // Log add
-        ReportsScreen::logActivity(username, "Add Product", newProduct.name);
+        ReportsScreen::logActivity(username, "Add Product", newProduct.name,
+                                   {{"product_id", productId}, {"product", newProduct.name}, {"quantity", newProduct.quantity}});
     }
 }
 
 void InventoryScreen::editProduct() {
-    int currentRow = inventoryTable->currentRow();
-    if (currentRow < 0 || currentRow >= products.size()) {
+    Product prod;
+    if (!currentProduct(prod)) {
         QMessageBox::warning(this, "Warning", "Please select a product to edit!");
         return;
     }
-    Product &prod = products[currentRow];
     bool ok;
     int newQuantity = QInputDialog::getInt(this, "Edit Quantity", "Enter new quantity:", prod.quantity, 0, 9999, 1, &ok);
     if (ok) {
-        QSqlQuery updateQuery;
-        updateQuery.prepare("UPDATE products SET quantity = ? WHERE id = ?");
-        updateQuery.addBindValue(newQuantity);
-        updateQuery.addBindValue(prod.id);
-        if (!updateQuery.exec()) {
-            QMessageBox::critical(this, "Error", "Failed to update product: " + updateQuery.lastError().text());
+        QString error;
+        if (!StockLedger::adjustTo(prod.id, newQuantity, username, &error)) {
+            QMessageBox::critical(this, "Error", "Failed to update product: " + error);
             return;
         }
         loadProductsFromDatabase();
         emit inventoryChanged();
         QMessageBox::information(this, "Success", "Product updated successfully!");
         // Log edit
-        ReportsScreen::logActivity(username, "Edit Product", prod.name + ", Qty: " + QString::number(newQuantity));
+        ReportsScreen::logActivity(username, "Edit Product", prod.name + ", Qty: " + QString::number(newQuantity),
+                                   {{"product_id", prod.id}, {"product", prod.name}, {"quantity", newQuantity}});
     }
 }
 
+void InventoryScreen::countStock() {
+    QList<Product> selected;
+    for (const QModelIndex &index : inventoryTable->selectionModel()->selectedRows()) {
+        selected << inventoryModel->productAt(proxyModel->mapToSource(index).row());
+    }
+    StockCountDialog dialog(selected, this);
+    if (dialog.exec() != QDialog::Accepted) return;
+    const QMap<int, int> counts = dialog.changedCounts();
+    if (counts.isEmpty()) {
+        QMessageBox::information(this, "Stock Count", "No quantities changed.");
+        return;
+    }
+    const QString reference = "Stock count " + QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm");
+    QString error;
+    const int adjusted = StockLedger::applyCounts(counts, reference, username, &error);
+    if (adjusted < 0) {
+        QMessageBox::critical(this, "Error", "Failed to apply stock count: " + error);
+        return;
+    }
+    loadProductsFromDatabase();
+    emit inventoryChanged();
+    // One audit entry for the batch; the per-product detail is on the stock ledger
+    ReportsScreen::logActivity(username, "Stock Count", QString("%1: %2 products adjusted").arg(reference).arg(adjusted),
+                               {{"reference", reference}, {"adjusted", adjusted}});
+    QMessageBox::information(this, "Stock Count", QString("Adjusted %1 products.").arg(adjusted));
+}
+
 void InventoryScreen::deleteProduct() {
-    int currentRow = inventoryTable->currentRow();
-    if (currentRow < 0 || currentRow >= products.size()) {
+    Product prod;
+    if (!currentProduct(prod)) {
         QMessageBox::warning(this, "Warning", "Please select a product to delete!");
         return;
     }
-    Product prod = products[currentRow];
     QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirm Delete", QString("Are you sure you want to delete '%1'?").arg(prod.name), QMessageBox::Yes | QMessageBox::No);
     if (reply == QMessageBox::Yes) {
         QSqlQuery delQuery;
@@ -304,72 +494,80 @@ void InventoryScreen::deleteProduct() {
         emit inventoryChanged();
         QMessageBox::information(this, "Success", "Product deleted successfully!");
         // Log delete
-        ReportsScreen::logActivity(username, "Delete Product", prod.name);
+        ReportsScreen::logActivity(username, "Delete Product", prod.name, {{"product_id", prod.id}, {"product", prod.name}});
     }
 }
 
-void InventoryScreen::refreshInventory() {
-    inventoryTable->setRowCount(products.size());
-    for (int i = 0; i < products.size(); ++i) {
-        const Product &product = products[i];
-        inventoryTable->setItem(i, 0, new QTableWidgetItem(product.name));
-        inventoryTable->setItem(i, 1, new QTableWidgetItem(product.category));
-        inventoryTable->setItem(i, 2, new QTableWidgetItem(QString("$%1").arg(product.price, 0, 'f', 2)));
-        inventoryTable->setItem(i, 3, new QTableWidgetItem(QString::number(product.quantity)));
-        inventoryTable->setItem(i, 4, new QTableWidgetItem(QString::number(product.minStock)));
-        QString status;
-        QString statusColor;
-        QColor rowColor;
-        if (product.quantity == 0) {
-            status = "Out of Stock";
-            statusColor = "#F44336";
-            rowColor = QColor("#FFCDD2"); // light red
-        } else if (product.quantity <= product.minStock) {
-            status = "Low Stock";
-            statusColor = "#FF9800";
-            rowColor = QColor("#FFF9C4"); // light yellow
+void InventoryScreen::importProducts() {
+    if (csvImporter->isRunning()) {
+        QMessageBox::information(this, "Import CSV", "An import is already running.");
+        return;
+    }
+    QString fileName = QFileDialog::getOpenFileName(this, "Import Products", QString(), "CSV Files (*.csv)");
+    if (fileName.isEmpty()) return;
+    QFileInfo info(fileName);
+    QString errorFile = info.absolutePath() + "/" + info.completeBaseName() + "_errors.csv";
+
+    QProgressDialog *progressDlg = new QProgressDialog("Importing products...", "Cancel", 0, 100, this);
+    progressDlg->setWindowTitle("Import CSV");
+    progressDlg->setAttribute(Qt::WA_DeleteOnClose);
+    progressDlg->setMinimumDuration(0);
+    connect(progressDlg, &QProgressDialog::canceled, csvImporter, &ProductCsvImporter::cancel);
+    connect(csvImporter, &ProductCsvImporter::progress, progressDlg, [progressDlg](qint64 bytesRead, qint64 totalBytes) {
+        progressDlg->setValue(totalBytes > 0 ? int(bytesRead * 100 / totalBytes) : 0);
+    });
+    connect(csvImporter, &ProductCsvImporter::finished, progressDlg, [this, progressDlg, fileName](bool success, const QString& message) {
+        progressDlg->close();
+        if (success) {
+            loadProductsFromDatabase();
+            emit inventoryChanged();
+            QMessageBox::information(this, "Import CSV", message);
+            ReportsScreen::logActivity(username, "Import Products", QFileInfo(fileName).fileName() + ": " + message);
         } else {
-            status = "In Stock";
-            statusColor = "#4CAF50";
-            rowColor = QColor(); // default
-        }
-        QTableWidgetItem *statusItem = new QTableWidgetItem(status);
-        statusItem->setForeground(QColor(statusColor));
-        inventoryTable->setItem(i, 5, statusItem);
-        // Highlight the row if low/out of stock
-        if (rowColor.isValid()) {
-            for (int col = 0; col < inventoryTable->columnCount(); ++col) {
-                QTableWidgetItem *item = inventoryTable->item(i, col);
-                if (item) item->setBackground(rowColor);
-            }
+            QMessageBox::warning(this, "Import CSV", message);
         }
+    });
+    csvImporter->start(fileName, errorFile);
+}
+
+void InventoryScreen::runForecast() {
+    if (forecaster->isRunning()) {
+        QMessageBox::information(this, "Forecast", "A forecast is already running.");
+        return;
     }
-    totalProductsLabel->setText(QString("Total Products: %1").arg(products.size()));
-    updateLowStockIndicator();
+    QProgressDialog *progressDlg = new QProgressDialog("Reading sales history...", "Cancel", 0, 0, this);
+    progressDlg->setWindowTitle("Forecast");
+    progressDlg->setAttribute(Qt::WA_DeleteOnClose);
+    progressDlg->setMinimumDuration(0);
+    connect(progressDlg, &QProgressDialog::canceled, forecaster, &ReorderForecaster::cancel);
+    connect(forecaster, &ReorderForecaster::progress, progressDlg, [progressDlg](qint64 linesRead) {
+        progressDlg->setLabelText(QString("Reading sales history... %L1 lines").arg(linesRead));
+    });
+    connect(forecaster, &ReorderForecaster::finished, progressDlg, [this, progressDlg](bool success, const QString& message) {
+        progressDlg->close();
+        if (success) {
+            loadProductsFromDatabase();
+            QMessageBox::information(this, "Forecast", message);
+        } else {
+            QMessageBox::warning(this, "Forecast", message);
+        }
+    });
+    forecaster->start();
+}
+
+void InventoryScreen::refreshInventory() {
+    loadProductsFromDatabase();
 }
 
 void InventoryScreen::updateLowStockIndicator() {
-    int lowStockCount = 0;
-    for (const Product &product : products) {
-        if (product.quantity <= product.minStock) {
-            lowStockCount++;
-        }
+    // Counted in the database; the model only holds the pages scrolled into view
+    QSqlQuery query("SELECT COUNT(*), COUNT(*) FILTER (WHERE quantity <= min_stock) FROM products");
+    if (query.next()) {
+        totalProductsLabel->setText(QString("Total Products: %1").arg(query.value(0).toInt()));
+        lowStockLabel->setText(QString("Low Stock Items: %1").arg(query.value(1).toInt()));
     }
-    lowStockLabel->setText(QString("Low Stock Items: %1").arg(lowStockCount));
 }
 
 void InventoryScreen::searchProducts() {
-    QString searchText = searchBox->text().toLower();
-    
-    for (int i = 0; i < inventoryTable->rowCount(); ++i) {
-        bool visible = false;
-        for (int j = 0; j < inventoryTable->columnCount(); ++j) {
-            QTableWidgetItem *item = inventoryTable->item(i, j);
-            if (item && item->text().toLower().contains(searchText)) {
-                visible = true;
-                break;
-            }
-        }
-        inventoryTable->setRowHidden(i, !visible);
-    }
-} 
\ No newline at end of file
+    proxyModel->setSearchText(searchBox->text().trimmed());
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <QWidget>
-#include <QTableWidget>
+#include <QTableView>
+#include <QTimer>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QLabel>
@@ -14,18 +15,17 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QList>
+#include <QMap>
+#include <QSet>
 #include <QVariant>
 #include <QDebug>
+#include "Product.h"
 
-struct Product {
-    int id = -1; // Add id for DB mapping
-    QString name;
-    QString category;
-    double price;
-    int quantity;
-    int minStock;
-    QString description;
-};
+class InventoryModel;
+class InventoryProxyModel;
+class ProductCsvImporter;
+class ReorderForecaster;
+class QTableWidget;
 
 class AddProductDialog : public QDialog {
     Q_OBJECT
@@ -42,6 +42,29 @@ private:
     QLineEdit *descriptionEdit;
 };
 
+// Stocktake: counts are collected here, from the selected rows or a barcode
+// scanner typing product names, and applied together when accepted.
+class StockCountDialog : public QDialog {
+    Q_OBJECT
+public:
+    StockCountDialog(const QList<Product>& selected, QWidget *parent = nullptr);
+    QMap<int, int> changedCounts() const; // Product id -> counted quantity, differences only
+
+private slots:
+    void scanEntered();
+
+private:
+    int addRow(const Product& product, int counted);
+    void setCounted(int row, int counted);
+    void updateDifference(int row);
+
+    QLineEdit *scanEdit;
+    QTableWidget *countTable;
+    QLabel *statusLabel;
+    QList<Product> products; // One per table row
+    QSet<int> scannedIds;    // Rows whose count comes from the scanner
+};
+
 class InventoryScreen : public QWidget {
     Q_OBJECT
 public:
@@ -56,24 +79,35 @@ signals:
 private slots:
     void addProduct();
     void editProduct();
+    void countStock(); // Batch stock adjustment
     void deleteProduct();
     void searchProducts();
     void refreshInventory();
+    void importProducts(); // Bulk load products from a CSV file
+    void runForecast();    // Recompute stock-out dates and reorder quantities
 
 private:
     void setupInventoryTable();
     void loadSampleData();
     void updateLowStockIndicator();
+    bool currentProduct(Product &product) const;
     
-    QTableWidget *inventoryTable;
+    QTableView *inventoryTable;
+    InventoryModel *inventoryModel;
+    InventoryProxyModel *proxyModel;
+    QTimer *searchTimer; // Debounces server-side search while typing
     QLineEdit *searchBox;
     QPushButton *addButton;
     QPushButton *editButton;
+    QPushButton *countButton;
     QPushButton *deleteButton;
     QPushButton *refreshButton;
+    QPushButton *importButton;
+    QPushButton *forecastButton;
+    ProductCsvImporter *csvImporter;
+    ReorderForecaster *forecaster;
     QLabel *totalProductsLabel;
     QLabel *lowStockLabel;
     
-    QList<Product> products;
     QString username; // Current user
 }; 
\ No newline at end of file
@@ -69,7 +69,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     stack->addWidget(inventoryScreen);
     stack->addWidget(reportsScreen);
 
-    QObject::connect(d->dashboardBtn, &QPushButton::clicked, [stack](){ stack->setCurrentIndex(0); });
+    QObject::connect(d->dashboardBtn, &QPushButton::clicked, [this, stack](){ dashboardScreen->updateMetrics(); stack->setCurrentIndex(0); });
     QObject::connect(d->salesBtn, &QPushButton::clicked, [stack](){ stack->setCurrentIndex(1); });
     QObject::connect(d->inventoryBtn, &QPushButton::clicked, [stack](){ stack->setCurrentIndex(2); });
     QObject::connect(d->reportsBtn, &QPushButton::clicked, [stack](){ stack->setCurrentIndex(3); });
@@ -0,0 +1,261 @@
+#include "OrderQuantiles.h"
+#include "DbConnection.h"
+#include "TDigest.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QList>
+#include <QDebug>
+#include <map>
+#include <tuple>
+
+namespace {
+struct Sketch {
+    qint64 orders = 0;
+    TDigest values;
+    TDigest items;
+
+    void add(double total, int itemCount) {
+        ++orders;
+        values.add(total);
+        items.add(itemCount);
+    }
+    void merge(const Sketch& other) {
+        orders += other.orders;
+        values.merge(other.values);
+        items.merge(other.items);
+    }
+};
+}
+
+// Merges sketch into the (bucket, cashier, terminal) row of table, locking the
+// row so concurrent writers can't lose each other's orders
+static bool mergeInto(const QSqlDatabase& db, const QString& table, const QVariant& bucket, const QString& cashier,
+                      const QString& terminal, const Sketch& sketch, QString* error) {
+    QSqlQuery query(db);
+    query.prepare(QString("INSERT INTO %1 (bucket, cashier, terminal_id, orders, value_digest, items_digest) "
+                          "VALUES (?, ?, ?, 0, ''::bytea, ''::bytea) ON CONFLICT DO NOTHING").arg(table));
+    query.addBindValue(bucket);
+    query.addBindValue(cashier);
+    query.addBindValue(terminal);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    query.prepare(QString("SELECT orders, value_digest, items_digest FROM %1 "
+                          "WHERE bucket = ? AND cashier = ? AND terminal_id = ? FOR UPDATE").arg(table));
+    query.addBindValue(bucket);
+    query.addBindValue(cashier);
+    query.addBindValue(terminal);
+    if (!query.exec() || !query.next()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    Sketch stored;
+    stored.orders = query.value(0).toLongLong();
+    if (!TDigest::deserialize(query.value(1).toByteArray(), stored.values)
+        || !TDigest::deserialize(query.value(2).toByteArray(), stored.items)) {
+        if (error) *error = QString("Unreadable order sketch in %1").arg(table);
+        return false;
+    }
+    stored.merge(sketch);
+    query.prepare(QString("UPDATE %1 SET orders = ?, value_digest = ?, items_digest = ? "
+                          "WHERE bucket = ? AND cashier = ? AND terminal_id = ?").arg(table));
+    query.addBindValue(stored.orders);
+    query.addBindValue(stored.values.serialize());
+    query.addBindValue(stored.items.serialize());
+    query.addBindValue(bucket);
+    query.addBindValue(cashier);
+    query.addBindValue(terminal);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+static QDateTime hourOf(const QDateTime& time) {
+    return QDateTime(time.date(), QTime(time.time().hour(), 0));
+}
+
+QString OrderQuantiles::groupName(GroupBy groupBy) {
+    switch (groupBy) {
+    case GroupBy::Total: return "Whole Period";
+    case GroupBy::Hour: return "Hour";
+    case GroupBy::Day: return "Day";
+    case GroupBy::Cashier: return "Cashier";
+    case GroupBy::Terminal: return "Terminal";
+    }
+    return QString();
+}
+
+bool OrderQuantiles::parseGroupBy(const QString& text, GroupBy& groupBy) {
+    if (text == "total") groupBy = GroupBy::Total;
+    else if (text == "hour") groupBy = GroupBy::Hour;
+    else if (text == "day") groupBy = GroupBy::Day;
+    else if (text == "cashier") groupBy = GroupBy::Cashier;
+    else if (text == "terminal") groupBy = GroupBy::Terminal;
+    else return false;
+    return true;
+}
+
+bool OrderQuantiles::recordSale(const QDateTime& saleTime, const QString& cashier, const QString& terminal,
+                                double total, int itemCount, QString* error) {
+    Sketch sketch;
+    sketch.add(total, itemCount);
+    const QSqlDatabase db = QSqlDatabase::database();
+    return mergeInto(db, "order_sketches_hourly", hourOf(saleTime), cashier, terminal, sketch, error)
+        && mergeInto(db, "order_sketches_daily", saleTime.date(), cashier, terminal, sketch, error);
+}
+
+void OrderQuantiles::backfill() {
+    ScopedDbConnection connection("order-quantiles");
+    if (!connection.isOpen()) {
+        qDebug() << "Order quantile backfill: no connection:" << connection.lastError();
+        return;
+    }
+    QSqlDatabase db = connection.database();
+    QSqlQuery query(db);
+    // One terminal at a time, or two backfills would both count the same hours
+    if (!query.exec("SELECT pg_try_advisory_lock(hashtext('order_quantiles_backfill'))") || !query.next()) {
+        qDebug() << "Order quantile backfill failed:" << query.lastError().text();
+        return;
+    }
+    if (!query.value(0).toBool()) return;
+    struct Unlock {
+        QSqlDatabase db;
+        ~Unlock() { QSqlQuery(db).exec("SELECT pg_advisory_unlock(hashtext('order_quantiles_backfill'))"); }
+    } unlock{db};
+    // Sales from live_from_seq on were sketched at checkout; older ones are done a day at a time
+    if (!query.exec("SELECT live_from_seq, done_through FROM order_quantiles_backfill") || !query.next()) {
+        if (query.lastError().isValid()) qDebug() << "Order quantile backfill failed:" << query.lastError().text();
+        return;
+    }
+    const qint64 liveFromSeq = query.value(0).toLongLong();
+    const QDate doneThrough = query.value(1).toDate();
+    query.prepare("SELECT DISTINCT sale_time::date FROM sales WHERE ingest_seq < ? AND sale_time >= ? ORDER BY 1");
+    query.addBindValue(liveFromSeq);
+    query.addBindValue(doneThrough.isValid() ? doneThrough.addDays(1).startOfDay() : QDateTime(QDate(1970, 1, 1), QTime(0, 0)));
+    if (!query.exec()) {
+        qDebug() << "Order quantile backfill failed:" << query.lastError().text();
+        return;
+    }
+    QList<QDate> days;
+    while (query.next()) days << query.value(0).toDate();
+
+    // One transaction per day, moving done_through with it, so an interrupted backfill resumes where it stopped
+    qint64 sketched = 0;
+    QSqlQuery done(db);
+    query.prepare("SELECT date_trunc('hour', s.sale_time), COALESCE(s.cashier, ''), COALESCE(b.terminal_id, ''), "
+                  "s.total::float8, COALESCE(i.items, 0) "
+                  "FROM sales s "
+                  "LEFT JOIN LATERAL (SELECT terminal_id, block_start, block_size FROM sale_id_blocks "
+                  "                   WHERE block_start <= s.id ORDER BY block_start DESC LIMIT 1) b "
+                  "  ON s.id < b.block_start + b.block_size "
+                  "LEFT JOIN LATERAL (SELECT SUM(quantity) AS items FROM sales_items WHERE sale_id = s.id) i ON true "
+                  "WHERE s.sale_time >= ? AND s.sale_time < ? AND s.ingest_seq < ?");
+    for (const QDate& day : days) {
+        using Key = std::tuple<QDateTime, QString, QString>;
+        std::map<Key, Sketch> hourly;
+        std::map<Key, Sketch> daily;
+        if (!db.transaction()) {
+            qDebug() << "Order quantile backfill failed:" << db.lastError().text();
+            return;
+        }
+        query.addBindValue(day.startOfDay());
+        query.addBindValue(day.addDays(1).startOfDay());
+        query.addBindValue(liveFromSeq);
+        if (!query.exec()) {
+            qDebug() << "Order quantile backfill failed:" << query.lastError().text();
+            db.rollback();
+            return;
+        }
+        while (query.next()) {
+            const QDateTime hour = query.value(0).toDateTime();
+            const QString cashier = query.value(1).toString();
+            const QString terminal = query.value(2).toString();
+            hourly[{hour, cashier, terminal}].add(query.value(3).toDouble(), query.value(4).toInt());
+            daily[{day.startOfDay(), cashier, terminal}].add(query.value(3).toDouble(), query.value(4).toInt());
+        }
+        QString error;
+        bool ok = true;
+        for (auto it = hourly.cbegin(); ok && it != hourly.cend(); ++it) {
+            ok = mergeInto(db, "order_sketches_hourly", std::get<0>(it->first), std::get<1>(it->first), std::get<2>(it->first), it->second, &error);
+            sketched += it->second.orders;
+        }
+        for (auto it = daily.cbegin(); ok && it != daily.cend(); ++it) {
+            ok = mergeInto(db, "order_sketches_daily", day, std::get<1>(it->first), std::get<2>(it->first), it->second, &error);
+        }
+        if (ok) {
+            done.prepare("UPDATE order_quantiles_backfill SET done_through = ?");
+            done.addBindValue(day);
+            if (!done.exec()) {
+                ok = false;
+                error = done.lastError().text();
+            }
+        }
+        if (!ok || !db.commit()) {
+            qDebug() << "Order quantile backfill failed:" << (error.isEmpty() ? db.lastError().text() : error);
+            db.rollback();
+            return;
+        }
+    }
+    if (sketched > 0) qDebug() << "Sketched order quantiles for" << sketched << "past sales";
+}
+
+bool OrderQuantiles::query(const QSqlDatabase& db, const QDate& from, const QDate& to, GroupBy groupBy, const QString& cashier,
+                           const QList<double>& quantiles, QList<Row>& rows, QString* error) {
+    QString key;
+    switch (groupBy) {
+    case GroupBy::Total: key = "''"; break;
+    case GroupBy::Hour: key = "to_char(bucket, 'YYYY-MM-DD HH24:00')"; break;
+    case GroupBy::Day: key = "to_char(bucket, 'YYYY-MM-DD')"; break;
+    case GroupBy::Cashier: key = "cashier"; break;
+    case GroupBy::Terminal: key = "terminal_id"; break;
+    }
+    const bool hourly = groupBy == GroupBy::Hour;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT %1, orders, value_digest, items_digest FROM %2 "
+                          "WHERE bucket >= ? AND bucket < ? AND (? = '' OR cashier = ?)")
+                      .arg(key, hourly ? "order_sketches_hourly" : "order_sketches_daily"));
+    if (hourly) {
+        query.addBindValue(from.startOfDay());
+        query.addBindValue(to.addDays(1).startOfDay());
+    } else {
+        query.addBindValue(from);
+        query.addBindValue(to.addDays(1));
+    }
+    query.addBindValue(cashier);
+    query.addBindValue(cashier);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    QMap<QString, Sketch> groups;
+    while (query.next()) {
+        Sketch sketch;
+        sketch.orders = query.value(1).toLongLong();
+        if (!TDigest::deserialize(query.value(2).toByteArray(), sketch.values)
+            || !TDigest::deserialize(query.value(3).toByteArray(), sketch.items)) {
+            if (error) *error = "Unreadable order sketch";
+            return false;
+        }
+        groups[query.value(0).toString()].merge(sketch);
+    }
+
+    rows.clear();
+    for (auto it = groups.constBegin(); it != groups.constEnd(); ++it) {
+        Row row;
+        row.label = it.key();
+        if (groupBy == GroupBy::Total) row.label = "All orders";
+        else if (row.label.isEmpty()) row.label = groupBy == GroupBy::Terminal ? "(unknown)" : "(none)";
+        row.orders = it->orders;
+        for (double q : quantiles) {
+            row.values << it->values.quantile(q);
+            row.items << it->items.quantile(q);
+        }
+        rows << row;
+    }
+    return true;
+}
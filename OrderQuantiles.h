@@ -0,0 +1,41 @@
+#pragma once
+#include <QString>
+#include <QDate>
+#include <QDateTime>
+#include <QList>
+#include <QSqlDatabase>
+
+// Order value and basket size distributions per hour, cashier and terminal.
+// Each sale adds its total and item count to t-digests (see TDigest) stored
+// in order_sketches_hourly and order_sketches_daily, inside the checkout
+// transaction. Percentiles over a range are answered by merging the stored
+// digests: hourly rows when grouping by hour, daily rows otherwise.
+//
+// Terminals come from the sale's ID block (sale_id_blocks), or are empty for
+// sales numbered before blocks were introduced.
+class OrderQuantiles {
+public:
+    enum class GroupBy { Total, Hour, Day, Cashier, Terminal };
+    struct Row {
+        QString label;
+        qint64 orders = 0;
+        QList<double> values; // Order value at each requested quantile
+        QList<double> items;  // Items per order at each requested quantile
+    };
+
+    static QString groupName(GroupBy groupBy);
+    static bool parseGroupBy(const QString& text, GroupBy& groupBy); // "total", "hour", "day", "cashier", "terminal"
+
+    // Default connection; joins the caller's transaction
+    static bool recordSale(const QDateTime& saleTime, const QString& cashier, const QString& terminal,
+                           double total, int itemCount, QString* error = nullptr);
+    // Sketches the sales from before this feature (those below
+    // order_quantiles_backfill.live_from_seq), a day at a time. Opens its own
+    // connection, so it can run on a worker thread.
+    static void backfill();
+
+    // from and to are inclusive; an empty cashier means all cashiers. Rows are
+    // sorted by label. Returns false on a database error.
+    static bool query(const QSqlDatabase& db, const QDate& from, const QDate& to, GroupBy groupBy, const QString& cashier,
+                      const QList<double>& quantiles, QList<Row>& rows, QString* error = nullptr);
+};
@@ -0,0 +1,121 @@
+#include "PgCopy.h"
+#include <QSqlDriver>
+#include <QVariant>
+#include <libpq-fe.h>
+
+PgCopy::PgCopy(const QSqlDatabase& db) {
+    QVariant handle = db.driver() ? db.driver()->handle() : QVariant();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0) {
+        conn = *static_cast<PGconn**>(handle.data());
+    }
+    if (!conn) error = "Not a PostgreSQL connection";
+}
+
+bool PgCopy::beginIn(const QString& copySql) {
+    if (!conn) return false;
+    PGresult* result = PQexec(conn, copySql.toUtf8().constData());
+    bool ok = PQresultStatus(result) == PGRES_COPY_IN;
+    if (!ok) error = QString::fromUtf8(PQerrorMessage(conn));
+    PQclear(result);
+    return ok;
+}
+
+bool PgCopy::putData(const QByteArray& data) {
+    if (!conn) return false;
+    if (PQputCopyData(conn, data.constData(), int(data.size())) != 1) {
+        error = QString::fromUtf8(PQerrorMessage(conn));
+        return false;
+    }
+    return true;
+}
+
+bool PgCopy::endIn(const QString& abortReason) {
+    if (!conn) return false;
+    QByteArray reason = abortReason.toUtf8();
+    if (PQputCopyEnd(conn, abortReason.isEmpty() ? nullptr : reason.constData()) != 1) {
+        error = QString::fromUtf8(PQerrorMessage(conn));
+        return false;
+    }
+    bool ok = true;
+    while (PGresult* result = PQgetResult(conn)) {
+        if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+            ok = false;
+            error = QString::fromUtf8(PQresultErrorMessage(result));
+        }
+        PQclear(result);
+    }
+    return ok && abortReason.isEmpty();
+}
+
+bool PgCopy::copyOut(const QString& copySql, const std::function<bool(const char*, int)>& onRow) {
+    if (!conn) return false;
+    PGresult* result = PQexec(conn, copySql.toUtf8().constData());
+    bool ok = PQresultStatus(result) == PGRES_COPY_OUT;
+    PQclear(result);
+    if (!ok) {
+        error = QString::fromUtf8(PQerrorMessage(conn));
+        return false;
+    }
+    bool stopped = false;
+    char* buffer = nullptr;
+    int size;
+    while ((size = PQgetCopyData(conn, &buffer, 0)) > 0) {
+        if (!stopped && !onRow(buffer, size)) {
+            // COPY OUT can't be abandoned mid-stream; ask the server to cancel and drain what's in flight
+            stopped = true;
+            if (PGcancel* cancel = PQgetCancel(conn)) {
+                char errbuf[256];
+                PQcancel(cancel, errbuf, sizeof(errbuf));
+                PQfreeCancel(cancel);
+            }
+        }
+        PQfreemem(buffer);
+    }
+    if (size == -2 && !stopped) {
+        error = QString::fromUtf8(PQerrorMessage(conn));
+        ok = false;
+    }
+    while (PGresult* last = PQgetResult(conn)) {
+        if (PQresultStatus(last) != PGRES_COMMAND_OK && !stopped) {
+            ok = false;
+            error = QString::fromUtf8(PQresultErrorMessage(last));
+        }
+        PQclear(last);
+    }
+    if (stopped) error = "Cancelled";
+    return ok && !stopped;
+}
+
+// Parses one tab- or newline-terminated integer field of a COPY text row
+bool PgCopy::readIntField(const char*& p, const char* end, int& value) {
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    if (p >= end || *p < '0' || *p > '9') return false;
+    long long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    if (p < end) ++p; // Separator
+    value = int(negative ? -v : v);
+    return true;
+}
+
+// Reads one text field of a COPY text row, undoing COPY's backslash escapes
+void PgCopy::readTextField(const char*& p, const char* end, QByteArray& value) {
+    value.clear();
+    while (p < end && *p != '\t' && *p != '\n') {
+        char c = *p++;
+        if (c == '\\' && p < end) {
+            c = *p++;
+            switch (c) {
+            case 't': c = '\t'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            default: break; // \\ and anything rarer come through as the character itself
+            }
+        }
+        value.append(c);
+    }
+    if (p < end) ++p;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include <QSqlDatabase>
+#include <functional>
+
+struct pg_conn;
+typedef struct pg_conn PGconn;
+
+// Thin wrapper over libpq's COPY protocol on a QPSQL connection. Qt's SQL API
+// has no COPY support, so this borrows the driver's PGconn handle. It runs
+// inside whatever transaction the QSqlDatabase has open.
+class PgCopy {
+public:
+    explicit PgCopy(const QSqlDatabase& db);
+
+    bool isValid() const { return conn != nullptr; }
+    QString lastError() const { return error; }
+
+    // COPY ... FROM STDIN
+    bool beginIn(const QString& copySql);
+    bool putData(const QByteArray& data);
+    bool endIn(const QString& abortReason = QString()); // Non-empty reason aborts the COPY
+
+    // COPY ... TO STDOUT. onRow gets one data row at a time (text/CSV formats)
+    // and can return false to stop early.
+    bool copyOut(const QString& copySql, const std::function<bool(const char* data, int size)>& onRow);
+
+    // Field parsers for copyOut() rows in text format; each advances p past
+    // the field and its tab or newline
+    static bool readIntField(const char*& p, const char* end, int& value);
+    static void readTextField(const char*& p, const char* end, QByteArray& value); // Undoes backslash escapes
+
+private:
+    PGconn* conn = nullptr;
+    QString error;
+};
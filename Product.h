@@ -0,0 +1,20 @@
+#ifndef PRODUCT_H
+#define PRODUCT_H
+
+#include <QString>
+#include <QDate>
+
+struct Product {
+    int id = -1; // Add id for DB mapping
+    QString name;
+    QString category;
+    double price;
+    int quantity;
+    int minStock;
+    QString description;
+    // From product_forecasts; invalid date / 0 until the forecast has run
+    QDate stockoutDate;
+    int suggestedOrder = 0;
+};
+
+#endif // PRODUCT_H
@@ -0,0 +1,256 @@
+#include "ProductCsvImporter.h"
+#include "DbConnection.h"
+#include "PgCopy.h"
+#include <QtConcurrent>
+#include <QFile>
+#include <QHash>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+
+// Rows are handed to COPY in chunks of about this many bytes
+static const int copyChunkBytes = 64 * 1024;
+
+static void appendCsvText(QByteArray& out, const QString& value) {
+    // Unquoted empty is NULL in COPY's CSV format; anything else is quoted
+    if (value.isEmpty()) return;
+    out.append('"');
+    out.append(QString(value).replace('"', "\"\"").toUtf8());
+    out.append('"');
+}
+
+ProductCsvImporter::ProductCsvImporter(QObject *parent) : QObject(parent) {
+}
+
+ProductCsvImporter::~ProductCsvImporter() {
+    cancel();
+    future.waitForFinished();
+}
+
+void ProductCsvImporter::start(const QString& csvFile, const QString& errorFile) {
+    if (isRunning()) return;
+    cancelled = false;
+    future = QtConcurrent::run([this, csvFile, errorFile]() { run(csvFile, errorFile); });
+}
+
+void ProductCsvImporter::cancel() {
+    cancelled = true;
+}
+
+bool ProductCsvImporter::isRunning() const {
+    return future.isRunning();
+}
+
+bool ProductCsvImporter::readRecord(QIODevice& in, QStringList& fields, qint64& lineNo) {
+    fields.clear();
+    if (in.atEnd()) return false;
+    QString field;
+    bool quoted = false;
+    while (!in.atEnd()) {
+        QByteArray raw = in.readLine();
+        ++lineNo;
+        while (raw.endsWith('\n') || raw.endsWith('\r')) raw.chop(1);
+        const QString line = QString::fromUtf8(raw);
+        for (int i = 0; i < line.size(); ++i) {
+            const QChar c = line[i];
+            if (quoted) {
+                if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                    field += '"';
+                    ++i;
+                } else if (c == '"') {
+                    quoted = false;
+                } else {
+                    field += c;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == ',') {
+                fields << field;
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        if (!quoted) break;
+        field += '\n'; // Line break inside a quoted field
+    }
+    fields << field;
+    return true;
+}
+
+void ProductCsvImporter::run(QString csvFile, QString errorFile) {
+    QFile in(csvFile);
+    if (!in.open(QIODevice::ReadOnly)) {
+        emit finished(false, "Could not open " + csvFile + ": " + in.errorString());
+        return;
+    }
+
+    qint64 lineNo = 0;
+    QStringList fields;
+    if (!readRecord(in, fields, lineNo)) {
+        emit finished(false, "The CSV file is empty.");
+        return;
+    }
+    QHash<QString, int> columns;
+    for (int i = 0; i < fields.size(); ++i) {
+        columns.insert(fields[i].remove(QChar(0xFEFF)).trimmed().toLower(), i);
+    }
+    if (!columns.contains("name") || !columns.contains("price")) {
+        emit finished(false, "The CSV header must include name and price columns.");
+        return;
+    }
+
+    QFile errors(errorFile);
+    int rejected = 0;
+    auto reject = [&](qint64 line, const QString& reason, const QStringList& record) {
+        if (!errors.isOpen()) {
+            if (!errors.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+            errors.write("line,reason,record\n");
+        }
+        QByteArray out = QByteArray::number(line) + ",";
+        appendCsvText(out, reason);
+        out.append(',');
+        appendCsvText(out, record.join(','));
+        out.append('\n');
+        errors.write(out);
+        ++rejected;
+    };
+
+    ScopedDbConnection connection("csv-import");
+    if (!connection.isOpen()) {
+        emit finished(false, "Database error: " + connection.lastError());
+        return;
+    }
+    QSqlDatabase db = connection.database();
+    PgCopy copy(db);
+    if (!copy.isValid() || !db.transaction()) {
+        emit finished(false, "Database error: " + (copy.isValid() ? db.lastError().text() : copy.lastError()));
+        return;
+    }
+
+    QString error;
+    {
+        QSqlQuery staging(db);
+        if (!staging.exec("CREATE TEMP TABLE product_import_staging (line_no BIGINT, name TEXT NOT NULL, category TEXT, "
+                          "price NUMERIC(10, 2) NOT NULL, quantity INTEGER NOT NULL, min_stock INTEGER NOT NULL, "
+                          "description TEXT) ON COMMIT DROP")) {
+            error = staging.lastError().text();
+        }
+    }
+    if (error.isEmpty() && !copy.beginIn("COPY product_import_staging (line_no, name, category, price, quantity, min_stock, "
+                                         "description) FROM STDIN (FORMAT csv)")) {
+        error = copy.lastError();
+    }
+
+    const qint64 totalBytes = in.size();
+    int lastPercent = -1;
+    QByteArray buffer;
+    buffer.reserve(copyChunkBytes + 4096);
+    while (error.isEmpty() && !cancelled) {
+        const qint64 recordLine = lineNo + 1;
+        if (!readRecord(in, fields, lineNo)) break;
+        if (fields.size() == 1 && fields[0].trimmed().isEmpty()) continue;
+        auto value = [&](const char* column) {
+            int i = columns.value(QString::fromLatin1(column), -1);
+            return i >= 0 ? fields.value(i).trimmed() : QString();
+        };
+
+        const QString name = value("name");
+        if (name.isEmpty()) {
+            reject(recordLine, "Missing name", fields);
+            continue;
+        }
+        bool ok;
+        const double price = value("price").remove('$').toDouble(&ok);
+        if (!ok || price <= 0 || price >= 1e8) {
+            reject(recordLine, "Invalid price", fields);
+            continue;
+        }
+        int quantity = 0;
+        if (!value("quantity").isEmpty()) {
+            quantity = value("quantity").toInt(&ok);
+            if (!ok || quantity < 0) {
+                reject(recordLine, "Invalid quantity", fields);
+                continue;
+            }
+        }
+        int minStock = 5; // Same default as AddProductDialog
+        if (!value("min_stock").isEmpty()) {
+            minStock = value("min_stock").toInt(&ok);
+            if (!ok || minStock < 0) {
+                reject(recordLine, "Invalid min_stock", fields);
+                continue;
+            }
+        }
+
+        buffer.append(QByteArray::number(recordLine)).append(',');
+        appendCsvText(buffer, name);
+        buffer.append(',');
+        appendCsvText(buffer, value("category"));
+        buffer.append(',').append(QByteArray::number(price, 'f', 2));
+        buffer.append(',').append(QByteArray::number(quantity));
+        buffer.append(',').append(QByteArray::number(minStock)).append(',');
+        appendCsvText(buffer, value("description"));
+        buffer.append('\n');
+
+        if (buffer.size() >= copyChunkBytes) {
+            if (!copy.putData(buffer)) error = copy.lastError();
+            buffer.clear();
+            int percent = totalBytes > 0 ? int(in.pos() * 100 / totalBytes) : 0;
+            if (percent != lastPercent) {
+                lastPercent = percent;
+                emit progress(in.pos(), totalBytes);
+            }
+        }
+    }
+    if (error.isEmpty() && !buffer.isEmpty() && !copy.putData(buffer)) error = copy.lastError();
+
+    if (!error.isEmpty() || cancelled) {
+        copy.endIn(cancelled ? "Import cancelled" : error);
+        db.rollback();
+        emit finished(false, cancelled ? QString("Import cancelled; no products were changed.") : "Import failed: " + error);
+        return;
+    }
+    if (!copy.endIn()) {
+        db.rollback();
+        emit finished(false, "Import failed: " + copy.lastError());
+        return;
+    }
+    emit progress(totalBytes, totalBytes);
+
+    int inserted = 0, updated = 0;
+    {
+        // Later rows win when the file names a product twice. Quantities are not
+        // written directly: each product's difference goes on the stock ledger.
+        QSqlQuery upsert(db);
+        if (!upsert.exec("WITH latest AS ("
+                         "SELECT DISTINCT ON (name) name, category, price, quantity, min_stock, description "
+                         "FROM product_import_staging ORDER BY name, line_no DESC), "
+                         "upserted AS ("
+                         "INSERT INTO products (name, category, price, quantity, min_stock, description) "
+                         "SELECT name, category, price, 0, min_stock, description FROM latest "
+                         "ON CONFLICT (name) DO UPDATE SET category = EXCLUDED.category, price = EXCLUDED.price, "
+                         "min_stock = EXCLUDED.min_stock, description = EXCLUDED.description "
+                         "RETURNING id, name, quantity, (xmax = 0) AS inserted), "
+                         "moved AS ("
+                         "INSERT INTO stock_movements (product_id, quantity_delta, reason, reference) "
+                         "SELECT u.id, l.quantity - u.quantity, CASE WHEN u.inserted THEN 'receipt' ELSE 'adjustment' END, "
+                         "'CSV import' FROM upserted u JOIN latest l ON l.name = u.name WHERE l.quantity <> u.quantity) "
+                         "SELECT COUNT(*) FILTER (WHERE inserted), COUNT(*) FILTER (WHERE NOT inserted) FROM upserted")
+            || !upsert.next()) {
+            error = upsert.lastError().text();
+        } else {
+            inserted = upsert.value(0).toInt();
+            updated = upsert.value(1).toInt();
+        }
+    }
+    if (!error.isEmpty() || !db.commit()) {
+        db.rollback();
+        emit finished(false, "Import failed: " + (error.isEmpty() ? db.lastError().text() : error));
+        return;
+    }
+
+    QString message = QString("Imported %1 new and updated %2 existing products.").arg(inserted).arg(updated);
+    if (rejected > 0) message += QString("\n%1 rows were rejected; see %2").arg(rejected).arg(errorFile);
+    emit finished(true, message);
+}
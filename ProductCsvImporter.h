@@ -0,0 +1,39 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QFuture>
+#include <atomic>
+
+class QIODevice;
+
+// Bulk product import from CSV. The file is streamed a line at a time, valid
+// rows are loaded into a staging table with COPY and then upserted into
+// products by name in a single transaction. Rejected rows go to an error file
+// with the line number and reason, so memory stays flat for any file size.
+//
+// Expected header (case-insensitive, any order): name, price, and optionally
+// category, quantity, min_stock, description.
+class ProductCsvImporter : public QObject {
+    Q_OBJECT
+public:
+    explicit ProductCsvImporter(QObject *parent = nullptr);
+    ~ProductCsvImporter();
+
+    void start(const QString& csvFile, const QString& errorFile);
+    void cancel();
+    bool isRunning() const;
+
+    // Reads one CSV record, following quoted fields across line breaks
+    static bool readRecord(QIODevice& in, QStringList& fields, qint64& lineNo);
+
+signals:
+    void progress(qint64 bytesRead, qint64 totalBytes);
+    void finished(bool ok, const QString& message);
+
+private:
+    void run(QString csvFile, QString errorFile);
+
+    std::atomic_bool cancelled{false};
+    QFuture<void> future;
+};
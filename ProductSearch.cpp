@@ -0,0 +1,59 @@
+#include "ProductSearch.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonObject>
+#include <QVariant>
+
+QString ProductSearch::normalize(const QString& text) {
+    return text.simplified().toLower();
+}
+
+QString ProductSearch::rankExpression() {
+    // Rounded to numeric so the value survives the round trip as a keyset position
+    return "round(word_similarity(?, search_text)::numeric, 4)";
+}
+
+QString ProductSearch::matchCondition() {
+    // LIKE catches short and exact fragments; <% tolerates typos. Both use the GIN index.
+    return "(search_text LIKE ? OR ? <% search_text)";
+}
+
+QVariantList ProductSearch::rankBindValues(const QString& text) {
+    return {normalize(text)};
+}
+
+QVariantList ProductSearch::matchBindValues(const QString& text) {
+    QString term = normalize(text);
+    QString pattern = term;
+    pattern.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+    return {"%" + pattern + "%", term};
+}
+
+QJsonArray ProductSearch::search(const QString& text, int limit, int offset, QString* error) {
+    QJsonArray results;
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT id, name, category, price, quantity, min_stock, description, %1 AS rank "
+                          "FROM products WHERE %2 ORDER BY rank DESC, id LIMIT ? OFFSET ?")
+                      .arg(rankExpression(), matchCondition()));
+    for (const QVariant& value : rankBindValues(text) + matchBindValues(text)) query.addBindValue(value);
+    query.addBindValue(limit);
+    query.addBindValue(offset);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return results;
+    }
+    while (query.next()) {
+        QJsonObject product;
+        product["id"] = query.value(0).toInt();
+        product["name"] = query.value(1).toString();
+        product["category"] = query.value(2).toString();
+        product["price"] = query.value(3).toDouble();
+        product["quantity"] = query.value(4).toInt();
+        product["min_stock"] = query.value(5).toInt();
+        product["description"] = query.value(6).toString();
+        product["rank"] = query.value(7).toDouble();
+        results.append(product);
+    }
+    return results;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <QString>
+#include <QVariantList>
+#include <QJsonArray>
+
+// Typo-tolerant, ranked product search on products.search_text (name, category
+// and description, lower-cased) backed by a pg_trgm GIN index. Shared by the
+// inventory model and /api/products/search so both rank results the same way.
+class ProductSearch {
+public:
+    // SQL fragments; each '?' is matched by the corresponding bind values below
+    static QString rankExpression();   // numeric rank, higher is better
+    static QString matchCondition();   // substring or trigram word match
+    static QVariantList rankBindValues(const QString& text);
+    static QVariantList matchBindValues(const QString& text);
+
+    static QJsonArray search(const QString& text, int limit, int offset, QString* error = nullptr);
+
+private:
+    static QString normalize(const QString& text);
+};
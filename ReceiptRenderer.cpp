@@ -0,0 +1,211 @@
+#include "ReceiptRenderer.h"
+#include <QPainter>
+#include <QPagedPaintDevice>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QtConcurrent>
+
+// Receipt template. Line prefixes:
+//   ^  centered text          -  rule across the full width
+//   #  table row (| separates columns)     *  table row repeated for each item
+//   =  label on the left, value right-aligned
+//   ?field|  print the line only when {field} is non-empty
+static const char* receiptTemplate =
+    "^Monster POS Receipt\n"
+    "-\n"
+    "?saleId|Sale ID: {saleId}\n"
+    "Date: {date}  Time: {time}\n"
+    "Cashier: {cashier}\n"
+    "-\n"
+    "#Name|Qty|Price|Total\n"
+    "*{name}|{qty}|{price}|{total}\n"
+    "-\n"
+    "=Subtotal:|{subtotal}\n"
+    "=Tax ({taxPercent}%):|{tax}\n"
+    "=Total:|{grandTotal}\n"
+    "=Paid:|{paid}\n"
+    "=Change:|{change}\n"
+    "-\n"
+    "^Thank you for your purchase!\n";
+
+const QList<ReceiptRenderer::LineSpec>& ReceiptRenderer::cachedTemplate() {
+    static const QList<LineSpec> parsed = parseTemplate(QString::fromLatin1(receiptTemplate));
+    return parsed;
+}
+
+QList<ReceiptRenderer::LineSpec> ReceiptRenderer::parseTemplate(const QString& source) {
+    QList<LineSpec> specs;
+    const QStringList lines = source.split('\n', Qt::SkipEmptyParts);
+    for (QString line : lines) {
+        LineSpec spec;
+        spec.kind = LineKind::Text;
+        if (line.startsWith('?')) {
+            int bar = line.indexOf('|');
+            spec.condition = line.mid(1, bar - 1);
+            line = line.mid(bar + 1);
+        }
+        if (line.startsWith('-')) {
+            spec.kind = LineKind::Rule;
+        } else if (line.startsWith('^')) {
+            spec.kind = LineKind::Center;
+            spec.cells.append(parseSegments(line.mid(1)));
+        } else if (line.startsWith('#') || line.startsWith('*') || line.startsWith('=')) {
+            spec.kind = line.startsWith('#') ? LineKind::Row
+                      : line.startsWith('*') ? LineKind::ItemRow
+                      : LineKind::Total;
+            for (const QString& cell : line.mid(1).split('|')) {
+                spec.cells.append(parseSegments(cell));
+            }
+        } else {
+            spec.cells.append(parseSegments(line));
+        }
+        specs.append(spec);
+    }
+    return specs;
+}
+
+QList<ReceiptRenderer::Segment> ReceiptRenderer::parseSegments(const QString& text) {
+    QList<Segment> segments;
+    int pos = 0;
+    while (pos < text.size()) {
+        int open = text.indexOf('{', pos);
+        int close = open < 0 ? -1 : text.indexOf('}', open);
+        if (open < 0 || close < 0) {
+            segments.append({false, text.mid(pos)});
+            break;
+        }
+        if (open > pos) segments.append({false, text.mid(pos, open - pos)});
+        segments.append({true, text.mid(open + 1, close - open - 1)});
+        pos = close + 1;
+    }
+    return segments;
+}
+
+QString ReceiptRenderer::fieldValue(const QString& field, const Bill& bill, const BillItem* item) {
+    if (item) {
+        if (field == "name") return item->name;
+        if (field == "qty") return QString::number(item->quantity);
+        if (field == "price") return QString::number(item->price, 'f', 2);
+        if (field == "total") return QString::number(item->total(), 'f', 2);
+    }
+    if (field == "saleId") return bill.saleId != -1 ? QString::number(bill.saleId) : QString();
+    if (field == "date") return bill.dateTime.date().toString("yyyy-MM-dd");
+    if (field == "time") return bill.dateTime.time().toString("hh:mm:ss");
+    if (field == "cashier") return bill.cashier;
+    if (field == "subtotal") return QString::number(bill.subtotal(), 'f', 2);
+    if (field == "taxPercent") return QString::number(bill.taxRate * 100, 'g', 4);
+    if (field == "tax") return QString::number(bill.tax(), 'f', 2);
+    if (field == "grandTotal") return QString::number(bill.total(), 'f', 2);
+    if (field == "paid") return QString::number(bill.paid, 'f', 2);
+    if (field == "change") return QString::number(bill.change, 'f', 2);
+    return QString();
+}
+
+QString ReceiptRenderer::expand(const QList<Segment>& segments, const Bill& bill, const BillItem* item) {
+    QString out;
+    for (const Segment& segment : segments) {
+        out += segment.isField ? fieldValue(segment.text, bill, item) : segment.text;
+    }
+    return out;
+}
+
+QString ReceiptRenderer::formatRow(const QStringList& cells, int columns) {
+    // Name column takes whatever the fixed-width numeric columns leave over
+    const int qtyWidth = 4, priceWidth = 9, totalWidth = 10;
+    const int nameWidth = qMax(4, columns - qtyWidth - priceWidth - totalWidth);
+    QString name = cells.value(0);
+    if (name.size() > nameWidth) name = name.left(nameWidth - 1) + '~';
+    return name.leftJustified(nameWidth)
+        + cells.value(1).rightJustified(qtyWidth)
+        + cells.value(2).rightJustified(priceWidth)
+        + cells.value(3).rightJustified(totalWidth);
+}
+
+QStringList ReceiptRenderer::layoutLines(const Bill& bill, int columns) {
+    QStringList out;
+    for (const LineSpec& spec : cachedTemplate()) {
+        if (!spec.condition.isEmpty() && fieldValue(spec.condition, bill, nullptr).isEmpty()) {
+            continue;
+        }
+        switch (spec.kind) {
+        case LineKind::Rule:
+            out << QString(columns, '-');
+            break;
+        case LineKind::Center: {
+            QString text = expand(spec.cells.first(), bill, nullptr).left(columns);
+            out << QString((columns - text.size()) / 2, ' ') + text;
+            break;
+        }
+        case LineKind::Text:
+            out << expand(spec.cells.first(), bill, nullptr).left(columns);
+            break;
+        case LineKind::Row: {
+            QStringList cells;
+            for (const auto& cell : spec.cells) cells << expand(cell, bill, nullptr);
+            out << formatRow(cells, columns);
+            break;
+        }
+        case LineKind::ItemRow:
+            for (const BillItem& item : bill.items) {
+                QStringList cells;
+                for (const auto& cell : spec.cells) cells << expand(cell, bill, &item);
+                out << formatRow(cells, columns);
+            }
+            break;
+        case LineKind::Total: {
+            QString label = expand(spec.cells.value(0), bill, nullptr);
+            QString value = expand(spec.cells.value(1), bill, nullptr);
+            out << label + value.rightJustified(qMax(0, columns - label.size()));
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+void ReceiptRenderer::paintLines(QPainter& painter, QPagedPaintDevice& device, const QStringList& lines) {
+    const int columns = lines.isEmpty() ? defaultColumns : qMax<int>(defaultColumns, lines.first().size());
+    QFont font("Courier New");
+    font.setStyleHint(QFont::Monospace);
+    font.setPointSizeF(10);
+    QFontMetricsF metrics(font, &device);
+    const double pageWidth = device.width();
+    const double lineWidth = metrics.horizontalAdvance(QString(columns, 'M'));
+    if (lineWidth > pageWidth) {
+        font.setPointSizeF(10 * pageWidth / lineWidth);
+        metrics = QFontMetricsF(font, &device);
+    }
+    painter.setFont(font);
+
+    const double lineHeight = metrics.lineSpacing();
+    double y = metrics.ascent();
+    for (const QString& line : lines) {
+        if (y > device.height()) {
+            device.newPage();
+            y = metrics.ascent();
+        }
+        painter.drawText(QPointF(0, y), line);
+        y += lineHeight;
+    }
+}
+
+bool ReceiptRenderer::print(QPagedPaintDevice& device, const Bill& bill) {
+    QPainter painter;
+    if (!painter.begin(&device)) return false;
+    paintLines(painter, device, layoutLines(bill));
+    return painter.end();
+}
+
+bool ReceiptRenderer::writePdf(const Bill& bill, const QString& fileName) {
+    QPdfWriter writer(fileName);
+    writer.setPageSize(QPageSize(QPageSize::A5));
+    writer.setResolution(300);
+    writer.setTitle(bill.saleId != -1 ? QString("Receipt %1").arg(bill.saleId) : QString("Receipt"));
+    return print(writer, bill);
+}
+
+QFuture<bool> ReceiptRenderer::writePdfAsync(const Bill& bill, const QString& fileName) {
+    return QtConcurrent::run([bill, fileName]() { return writePdf(bill, fileName); });
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFuture>
+#include "Bill.h"
+
+class QPainter;
+class QPagedPaintDevice;
+
+// Lays out a receipt straight from a Bill using a template that is parsed once
+// and cached. The same fixed-width lines feed the printer, PDF export and any
+// other receipt output, so every path shows identical columns.
+class ReceiptRenderer {
+public:
+    static constexpr int defaultColumns = 42;
+
+    static QStringList layoutLines(const Bill& bill, int columns = defaultColumns);
+
+    // Paints already laid-out lines, starting new pages as needed
+    static void paintLines(QPainter& painter, QPagedPaintDevice& device, const QStringList& lines);
+    static bool print(QPagedPaintDevice& device, const Bill& bill);
+    static bool writePdf(const Bill& bill, const QString& fileName);
+
+    // Renders on the global thread pool; the Bill is copied so the caller can go away
+    static QFuture<bool> writePdfAsync(const Bill& bill, const QString& fileName);
+
+private:
+    struct Segment {
+        bool isField;
+        QString text; // Literal text, or the field name
+    };
+    enum class LineKind { Text, Center, Rule, Row, ItemRow, Total };
+    struct LineSpec {
+        LineKind kind;
+        QString condition;              // Field that must be non-empty for the line to print
+        QList<QList<Segment>> cells;    // One entry for Text/Center, one per column otherwise
+    };
+
+    static const QList<LineSpec>& cachedTemplate();
+    static QList<LineSpec> parseTemplate(const QString& source);
+    static QList<Segment> parseSegments(const QString& text);
+    static QString expand(const QList<Segment>& segments, const Bill& bill, const BillItem* item);
+    static QString fieldValue(const QString& field, const Bill& bill, const BillItem* item);
+    static QString formatRow(const QStringList& cells, int columns);
+};
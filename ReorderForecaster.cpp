@@ -0,0 +1,264 @@
+#include "ReorderForecaster.h"
+#include "DbConnection.h"
+#include "PgCopy.h"
+#include <QtConcurrent>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+static const int historyWeeks = ReorderForecaster::historyDays / 7;
+// Stock-outs further out than this are not projected
+static const int projectionDays = 365;
+
+namespace {
+struct ProductTotals {
+    qint64 total = 0;
+    qint64 recent = 0;
+    qint64 weekday[7] = {}; // Monday first
+    int firstDay = INT_MAX;  // First day in the window with a sale
+};
+}
+
+ReorderForecaster::ReorderForecaster(QObject *parent) : QObject(parent) {
+}
+
+ReorderForecaster::~ReorderForecaster() {
+    cancel();
+    future.waitForFinished();
+}
+
+void ReorderForecaster::start() {
+    if (isRunning()) return;
+    QSettings settings;
+    Settings s;
+    s.leadTimeDays = qMax(1, settings.value("forecast/leadTimeDays", 7).toInt());
+    s.coverDays = qMax(1, settings.value("forecast/coverDays", 14).toInt());
+    s.serviceLevelZ = qMax(0.0, settings.value("forecast/serviceLevelZ", 1.65).toDouble());
+    cancelled = false;
+    future = QtConcurrent::run([this, s]() { run(s); });
+}
+
+void ReorderForecaster::cancel() {
+    cancelled = true;
+}
+
+bool ReorderForecaster::isRunning() const {
+    return future.isRunning();
+}
+
+void ReorderForecaster::run(Settings settings) {
+    QElapsedTimer timer;
+    timer.start();
+    ScopedDbConnection connection("forecast");
+    if (!connection.isOpen()) {
+        emit finished(false, "Database error: " + connection.lastError());
+        return;
+    }
+    QSqlDatabase db = connection.database();
+
+    // Products, indexed densely so the pass below can use plain arrays
+    std::vector<int> productIds, stock, minStock;
+    std::vector<int> indexOfId;
+    {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if (!query.exec("SELECT id, quantity, min_stock FROM products ORDER BY id")) {
+            emit finished(false, "Database error: " + query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            productIds.push_back(query.value(0).toInt());
+            stock.push_back(query.value(1).toInt());
+            minStock.push_back(query.value(2).toInt());
+        }
+        indexOfId.assign(productIds.empty() ? 1 : size_t(productIds.back()) + 1, -1);
+        for (size_t i = 0; i < productIds.size(); ++i) indexOfId[productIds[i]] = int(i);
+    }
+    if (productIds.empty()) {
+        emit finished(true, "There are no products to forecast.");
+        return;
+    }
+
+    // Whole days only: the window ends at midnight this morning
+    const QDate today = QDate::currentDate();
+    const QDate firstDay = today.addDays(-historyDays);
+    std::vector<int32_t> lineProduct;
+    std::vector<int16_t> lineDay;
+    std::vector<int32_t> lineQuantity;
+    PgCopy copy(db);
+    if (!copy.isValid()) {
+        emit finished(false, "Database error: " + copy.lastError());
+        return;
+    }
+    const QString copySql = QString("COPY (SELECT p.id, s.sale_time::date - DATE '%1', si.quantity "
+                                    "FROM sales_items si JOIN sales s ON s.id = si.sale_id "
+                                    "JOIN products p ON p.name = si.product_name "
+                                    "WHERE s.sale_time >= DATE '%1' AND s.sale_time < DATE '%2') TO STDOUT")
+                                .arg(firstDay.toString(Qt::ISODate), today.toString(Qt::ISODate));
+    bool copied = copy.copyOut(copySql, [&](const char* data, int size) {
+        const char* p = data;
+        const char* end = data + size;
+        int id, day, quantity;
+        if (PgCopy::readIntField(p, end, id) && PgCopy::readIntField(p, end, day) && PgCopy::readIntField(p, end, quantity)
+            && id >= 0 && size_t(id) < indexOfId.size() && indexOfId[id] >= 0 && day >= 0 && day < historyDays) {
+            lineProduct.push_back(indexOfId[id]);
+            lineDay.push_back(int16_t(day));
+            lineQuantity.push_back(quantity);
+            if ((lineProduct.size() & 0xFFFFF) == 0) emit progress(qint64(lineProduct.size()));
+        }
+        return !cancelled;
+    });
+    if (cancelled) {
+        emit finished(false, "Forecast cancelled.");
+        return;
+    }
+    if (!copied) {
+        emit finished(false, "Failed to read sales history: " + copy.lastError());
+        return;
+    }
+    const size_t lines = lineProduct.size();
+    emit progress(qint64(lines));
+
+    // The single pass over the history
+    const size_t productCount = productIds.size();
+    const int firstWeekday = firstDay.dayOfWeek() - 1;
+    std::vector<ProductTotals> totals(productCount);
+    std::vector<int32_t> weekly(productCount * historyWeeks, 0);
+    for (size_t i = 0; i < lines; ++i) {
+        const int product = lineProduct[i];
+        const int day = lineDay[i];
+        const int quantity = lineQuantity[i];
+        ProductTotals& t = totals[product];
+        t.total += quantity;
+        if (day >= historyDays - recentDays) t.recent += quantity;
+        t.weekday[(firstWeekday + day) % 7] += quantity;
+        t.firstDay = std::min(t.firstDay, day);
+        weekly[size_t(product) * historyWeeks + day / 7] += quantity;
+    }
+    std::vector<int32_t>().swap(lineProduct);
+    std::vector<int16_t>().swap(lineDay);
+    std::vector<int32_t>().swap(lineQuantity);
+
+    // Per-product projection, written straight into COPY text for product_forecasts
+    const int todayWeekday = today.dayOfWeek() - 1;
+    QByteArray rows;
+    rows.reserve(int(productCount) * 96);
+    int reorderCount = 0;
+    for (size_t i = 0; i < productCount; ++i) {
+        const ProductTotals& t = totals[i];
+        // Products first sold partway through the window are measured from then
+        const int activeDays = t.total > 0 ? historyDays - t.firstDay : 0;
+        double velocity = 0.0;
+        double factors[7] = {1, 1, 1, 1, 1, 1, 1};
+        double dailySigma = 0.0;
+        if (activeDays > 0 && t.total > 0) {
+            const double longRate = double(t.total) / activeDays;
+            const double recentRate = double(t.recent) / std::min(recentDays, activeDays);
+            velocity = 0.6 * recentRate + 0.4 * longRate;
+
+            // Weekday factors, shrunk toward 1 by two days' worth of average demand
+            const int startWeekday = (firstWeekday + t.firstDay) % 7;
+            double factorSum = 0.0;
+            for (int d = 0; d < 7; ++d) {
+                const int occurrences = activeDays / 7 + (((d - startWeekday + 7) % 7) < activeDays % 7 ? 1 : 0);
+                factors[d] = (t.weekday[d] + 2.0 * longRate) / ((occurrences + 2.0) * longRate);
+                factorSum += factors[d];
+            }
+            for (double& f : factors) f *= 7.0 / factorSum;
+
+            // Day-to-day spread, estimated from the whole weeks the product was on sale
+            const int firstWeek = (t.firstDay + 6) / 7;
+            const int weeks = historyWeeks - firstWeek;
+            if (weeks >= 2) {
+                double sum = 0.0, sumSquares = 0.0;
+                const int32_t* w = &weekly[i * historyWeeks];
+                for (int k = firstWeek; k < historyWeeks; ++k) {
+                    sum += w[k];
+                    sumSquares += double(w[k]) * w[k];
+                }
+                const double mean = sum / weeks;
+                const double variance = std::max(0.0, (sumSquares - weeks * mean * mean) / (weeks - 1));
+                dailySigma = std::sqrt(variance / 7.0);
+            } else {
+                dailySigma = std::sqrt(velocity); // Too little history: assume Poisson-like demand
+            }
+        }
+
+        auto demandOver = [&](int fromDay, int days) {
+            double demand = 0.0;
+            for (int k = fromDay; k < fromDay + days; ++k) demand += velocity * factors[(todayWeekday + k) % 7];
+            return demand;
+        };
+        const double leadDemand = demandOver(0, settings.leadTimeDays);
+        const double coverDemand = demandOver(settings.leadTimeDays, settings.coverDays);
+        const double safetyStock = settings.serviceLevelZ * dailySigma * std::sqrt(double(settings.leadTimeDays));
+        // min_stock stays the shelf minimum on top of the projected demand
+        const int reorderPoint = minStock[i] + int(std::ceil(leadDemand + safetyStock));
+        const int orderUpTo = minStock[i] + int(std::ceil(leadDemand + coverDemand + safetyStock));
+        const int suggestedOrder = stock[i] <= reorderPoint ? std::max(0, orderUpTo - stock[i]) : 0;
+        if (suggestedOrder > 0) ++reorderCount;
+
+        QByteArray stockout = "\\N";
+        if (stock[i] <= 0) {
+            stockout = today.toString(Qt::ISODate).toLatin1();
+        } else if (velocity > 0.0) {
+            double remaining = stock[i];
+            for (int k = 0; k < projectionDays; ++k) {
+                remaining -= velocity * factors[(todayWeekday + k) % 7];
+                if (remaining <= 0.0) {
+                    stockout = today.addDays(k).toString(Qt::ISODate).toLatin1();
+                    break;
+                }
+            }
+        }
+
+        rows.append(QByteArray::number(productIds[i])).append('\t');
+        rows.append(QByteArray::number(velocity, 'f', 3)).append("\t{");
+        for (int d = 0; d < 7; ++d) {
+            if (d > 0) rows.append(',');
+            rows.append(QByteArray::number(factors[d], 'f', 3));
+        }
+        rows.append("}\t").append(stockout).append('\t');
+        rows.append(QByteArray::number(reorderPoint)).append('\t');
+        rows.append(QByteArray::number(suggestedOrder)).append('\n');
+    }
+    if (cancelled) {
+        emit finished(false, "Forecast cancelled.");
+        return;
+    }
+
+    // Replace the previous run in one transaction so readers never see a partial set
+    QString error;
+    if (!db.transaction()) error = db.lastError().text();
+    QSqlQuery query(db);
+    if (error.isEmpty() && !query.exec("CREATE TEMP TABLE forecast_staging (product_id INTEGER, daily_velocity NUMERIC(12, 3), "
+                                       "weekday_factors REAL[], stockout_date DATE, reorder_point INTEGER, "
+                                       "suggested_order INTEGER) ON COMMIT DROP")) {
+        error = query.lastError().text();
+    }
+    if (error.isEmpty() && !(copy.beginIn("COPY forecast_staging FROM STDIN") && copy.putData(rows) && copy.endIn())) {
+        error = copy.lastError();
+    }
+    if (error.isEmpty() && !query.exec("DELETE FROM product_forecasts")) error = query.lastError().text();
+    if (error.isEmpty() && !query.exec("INSERT INTO product_forecasts (product_id, daily_velocity, weekday_factors, "
+                                       "stockout_date, reorder_point, suggested_order) "
+                                       "SELECT f.* FROM forecast_staging f JOIN products p ON p.id = f.product_id")) {
+        error = query.lastError().text();
+    }
+    if (error.isEmpty() && !db.commit()) error = db.lastError().text();
+    if (!error.isEmpty()) {
+        db.rollback();
+        emit finished(false, "Failed to save forecasts: " + error);
+        return;
+    }
+    emit finished(true, QString("Forecast %1 products from %2 sale lines in %3 s. %4 need reordering.")
+                            .arg(productCount).arg(lines).arg(timer.elapsed() / 1000.0, 0, 'f', 1).arg(reorderCount));
+}
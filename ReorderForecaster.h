@@ -0,0 +1,42 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QFuture>
+#include <atomic>
+
+// Projects stock-out dates and reorder quantities from recent sales. The sales
+// history is streamed out of sales_items with COPY into three compact columns
+// (product, day, quantity), then a single pass over them accumulates each
+// product's velocity, weekday seasonality and week-to-week variance. Results
+// replace the contents of product_forecasts.
+//
+// Settings (QSettings): forecast/leadTimeDays (7), forecast/coverDays (14),
+// forecast/serviceLevelZ (1.65, about 95% of lead times covered).
+class ReorderForecaster : public QObject {
+    Q_OBJECT
+public:
+    static constexpr int historyDays = 182; // 26 whole weeks
+    static constexpr int recentDays = 28;   // Window weighted more heavily for velocity
+
+    explicit ReorderForecaster(QObject *parent = nullptr);
+    ~ReorderForecaster();
+
+    void start();
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void progress(qint64 linesRead);
+    void finished(bool ok, const QString& message);
+
+private:
+    struct Settings {
+        int leadTimeDays;
+        int coverDays;
+        double serviceLevelZ;
+    };
+    void run(Settings settings);
+
+    std::atomic_bool cancelled{false};
+    QFuture<void> future;
+};
@@ -0,0 +1,274 @@
+#include "ReportExporter.h"
+#include "ReportJobRunner.h"
+#include "DbConnection.h"
+#include "XlsxWriter.h"
+#include "SalesSnapshot.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVariantList>
+#include <climits>
+#include <memory>
+
+// CSV output is flushed to the file in chunks of about this many bytes
+static const int csvChunkBytes = 256 * 1024;
+
+namespace {
+struct ExportColumn {
+    const char* header;
+    XlsxWriter::CellType type;
+};
+
+// The writer interface both formats share
+class RowSink {
+public:
+    virtual ~RowSink() = default;
+    virtual bool open(const QString& title, const QList<ExportColumn>& columns) = 0;
+    virtual bool writeRow(const QVariantList& values) = 0;
+    virtual bool close() = 0;
+    virtual QString errorString() const = 0;
+};
+
+class CsvSink : public RowSink {
+public:
+    explicit CsvSink(const QString& path) : file(path) {}
+
+    bool open(const QString&, const QList<ExportColumn>& columnList) override {
+        columns = columnList;
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        buffer = "\xEF\xBB\xBF"; // BOM, so Excel reads the file as UTF-8
+        for (int i = 0; i < columns.size(); ++i) {
+            if (i > 0) buffer.append(',');
+            buffer.append(columns[i].header);
+        }
+        buffer.append("\r\n");
+        return true;
+    }
+
+    bool writeRow(const QVariantList& values) override {
+        for (int i = 0; i < values.size() && i < columns.size(); ++i) {
+            if (i > 0) buffer.append(',');
+            const QVariant& value = values[i];
+            if (value.isNull()) continue;
+            switch (columns[i].type) {
+            case XlsxWriter::Number: buffer.append(QByteArray::number(value.toLongLong())); break;
+            case XlsxWriter::Money: buffer.append(QByteArray::number(value.toDouble(), 'f', 2)); break;
+            case XlsxWriter::DateTime: buffer.append(value.toDateTime().toString("yyyy-MM-dd HH:mm:ss").toLatin1()); break;
+            case XlsxWriter::Text: {
+                const QByteArray text = value.toString().toUtf8();
+                if (text.contains(',') || text.contains('"') || text.contains('\n') || text.contains('\r')) {
+                    buffer.append('"').append(QByteArray(text).replace("\"", "\"\"")).append('"');
+                } else {
+                    buffer.append(text);
+                }
+                break;
+            }
+            }
+        }
+        buffer.append("\r\n");
+        return buffer.size() < csvChunkBytes || flush();
+    }
+
+    bool close() override {
+        if (!flush()) return false;
+        file.close();
+        return true;
+    }
+
+    QString errorString() const override { return file.errorString(); }
+
+private:
+    bool flush() {
+        const bool ok = file.write(buffer) == buffer.size();
+        buffer.clear();
+        return ok;
+    }
+
+    QFile file;
+    QList<ExportColumn> columns;
+    QByteArray buffer;
+};
+
+class XlsxSink : public RowSink {
+public:
+    explicit XlsxSink(const QString& path) : writer(path) {}
+
+    bool open(const QString& title, const QList<ExportColumn>& columns) override {
+        QStringList headers;
+        QList<XlsxWriter::CellType> types;
+        for (const ExportColumn& column : columns) {
+            headers << QString::fromLatin1(column.header);
+            types << column.type;
+        }
+        return writer.open(title, headers, types);
+    }
+    bool writeRow(const QVariantList& values) override { return writer.writeRow(values); }
+    bool close() override { return writer.close(); }
+    QString errorString() const override { return writer.errorString(); }
+
+private:
+    XlsxWriter writer;
+};
+}
+
+QString ReportExporter::datasetName(Dataset dataset) {
+    switch (dataset) {
+    case Dataset::Sales: return "Sales";
+    case Dataset::SaleLines: return "Sale Lines";
+    case Dataset::Products: return "Products";
+    case Dataset::Snapshot: return "Sales Snapshot";
+    }
+    return QString();
+}
+
+ReportExporter::Format ReportExporter::formatFor(const QString& path) {
+    return QFileInfo(path).suffix().compare("csv", Qt::CaseInsensitive) == 0 ? Format::Csv : Format::Xlsx;
+}
+
+bool ReportExporter::run(ReportJobContext& context, Dataset dataset, const QDate& from, const QDate& to,
+                         const QString& cashier, const QString& path, QString& message) {
+    if (dataset == Dataset::Snapshot) return runSnapshot(context, path, message);
+    QString sql;
+    QList<ExportColumn> columns;
+    QVariantList binds;
+    // Sales filters, in the order the '?'s appear
+    QString where = "(? = '' OR s.cashier = ?)";
+    binds << cashier << cashier;
+    if (from.isValid() && to.isValid()) {
+        where += " AND s.sale_time >= ? AND s.sale_time < ?";
+        binds << from.startOfDay() << to.addDays(1).startOfDay();
+    }
+    switch (dataset) {
+    case Dataset::Sales:
+        sql = "SELECT s.id, s.sale_time, s.cashier, s.payment_method, s.total FROM sales s WHERE " + where
+              + " ORDER BY s.sale_time, s.id";
+        columns = {{"Sale ID", XlsxWriter::Number}, {"Time", XlsxWriter::DateTime}, {"Cashier", XlsxWriter::Text},
+                   {"Payment", XlsxWriter::Text}, {"Total", XlsxWriter::Money}};
+        break;
+    case Dataset::SaleLines:
+        sql = "SELECT si.sale_id, s.sale_time, s.cashier, s.payment_method, si.product_name, si.quantity, si.price, "
+              "si.quantity * si.price FROM sales s JOIN sales_items si ON si.sale_id = s.id WHERE " + where
+              + " ORDER BY s.sale_time, s.id, si.id";
+        columns = {{"Sale ID", XlsxWriter::Number}, {"Time", XlsxWriter::DateTime}, {"Cashier", XlsxWriter::Text},
+                   {"Payment", XlsxWriter::Text}, {"Product", XlsxWriter::Text}, {"Quantity", XlsxWriter::Number},
+                   {"Unit Price", XlsxWriter::Money}, {"Line Total", XlsxWriter::Money}};
+        break;
+    case Dataset::Products:
+        sql = "SELECT id, name, category, price, quantity, min_stock, description FROM products ORDER BY name";
+        binds.clear();
+        columns = {{"Product ID", XlsxWriter::Number}, {"Name", XlsxWriter::Text}, {"Category", XlsxWriter::Text},
+                   {"Price", XlsxWriter::Money}, {"Quantity", XlsxWriter::Number}, {"Min Stock", XlsxWriter::Number},
+                   {"Description", XlsxWriter::Text}};
+        break;
+    case Dataset::Snapshot:
+        break;
+    }
+
+    std::unique_ptr<RowSink> sink;
+    if (formatFor(path) == Format::Csv) sink.reset(new CsvSink(path));
+    else sink.reset(new XlsxSink(path));
+    if (!sink->open(datasetName(dataset), columns)) {
+        message = "Could not write " + path + ": " + sink->errorString();
+        return false;
+    }
+    auto fail = [&](const QString& reason) {
+        sink.reset(); // Closes the file before it is removed
+        QFile::remove(path);
+        message = reason;
+        return false;
+    };
+
+    SqlCursor cursor(context.database(), "report_export", fetchSize);
+    if (!cursor.open(sql, binds)) return fail("Export failed: " + cursor.lastError());
+    qint64 rows = 0;
+    QSqlQuery batch(context.database());
+    QVariantList values;
+    while (cursor.fetch(batch)) {
+        const int columnCount = batch.record().count();
+        do {
+            values.clear();
+            for (int i = 0; i < columnCount; ++i) values << batch.value(i);
+            if (!sink->writeRow(values)) return fail("Could not write " + path + ": " + sink->errorString());
+            ++rows;
+        } while (batch.next());
+        context.setProgress(int(qMin<qint64>(rows, INT_MAX)), 0);
+        if (context.isCancelled()) return fail(QString());
+    }
+    // Only a cursor read to its end is a complete export
+    if (!cursor.atEnd()) return fail("Export failed: " + cursor.lastError());
+    cursor.close();
+    if (!sink->close()) return fail("Could not write " + path + ": " + sink->errorString());
+    message = QString("Exported %1 rows to %2").arg(rows).arg(path);
+    return true;
+}
+
+bool ReportExporter::runSnapshot(ReportJobContext& context, const QString& path, QString& message) {
+    using SalesSnapshot::ColumnType;
+    // Times are stored as wall-clock epoch seconds, money as integer cents
+    struct Table {
+        const char* name;
+        QList<QPair<QString, ColumnType>> columns;
+        const char* sql;
+    };
+    const QList<Table> tables = {
+        {"sales",
+         {{"id", ColumnType::Integer}, {"sale_time", ColumnType::Integer}, {"cashier", ColumnType::String},
+          {"payment_method", ColumnType::String}, {"total_cents", ColumnType::Integer}},
+         "SELECT id, extract(epoch FROM sale_time::timestamp)::bigint, cashier, payment_method, round(total * 100)::bigint "
+         "FROM sales ORDER BY sale_time, id"},
+        {"sales_items",
+         {{"id", ColumnType::Integer}, {"sale_id", ColumnType::Integer}, {"sale_time", ColumnType::Integer},
+          {"product", ColumnType::String}, {"quantity", ColumnType::Integer}, {"price_cents", ColumnType::Integer}},
+         "SELECT si.id, si.sale_id, extract(epoch FROM s.sale_time::timestamp)::bigint, si.product_name, si.quantity, "
+         "round(si.price * 100)::bigint FROM sales_items si JOIN sales s ON s.id = si.sale_id ORDER BY s.sale_time, si.id"},
+    };
+
+    SalesSnapshot::Writer writer(path);
+    QSqlDatabase db = context.database();
+    auto fail = [&](const QString& reason) {
+        db.rollback();
+        writer.discard();
+        message = reason;
+        return false;
+    };
+    if (!writer.open()) {
+        message = "Could not write " + path + ": " + writer.errorString();
+        return false;
+    }
+    // Both tables are read from one snapshot so every line has its sale
+    if (!db.transaction()) return fail("Export failed: " + db.lastError().text());
+    QSqlQuery isolation(db);
+    if (!isolation.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ, READ ONLY")) {
+        return fail("Export failed: " + isolation.lastError().text());
+    }
+
+    qint64 rows = 0;
+    for (const Table& table : tables) {
+        if (!writer.beginTable(table.name, table.columns)) return fail("Could not write " + path + ": " + writer.errorString());
+        SqlCursor cursor(db, "snapshot_export", fetchSize);
+        cursor.joinTransaction();
+        if (!cursor.open(table.sql)) return fail("Export failed: " + cursor.lastError());
+        QSqlQuery batch(db);
+        while (cursor.fetch(batch)) {
+            do {
+                for (int i = 0; i < table.columns.size(); ++i) {
+                    if (table.columns[i].second == ColumnType::String) writer.setString(i, batch.value(i).toString());
+                    else writer.setInteger(i, batch.value(i).toLongLong());
+                }
+                if (!writer.commitRow()) return fail("Could not write " + path + ": " + writer.errorString());
+                ++rows;
+            } while (batch.next());
+            context.setProgress(int(qMin<qint64>(rows, INT_MAX)), 0);
+            if (context.isCancelled()) return fail(QString());
+        }
+        if (!cursor.atEnd()) return fail("Export failed: " + cursor.lastError());
+        cursor.close();
+        if (!writer.endTable()) return fail("Could not write " + path + ": " + writer.errorString());
+    }
+    if (!db.commit()) return fail("Export failed: " + db.lastError().text());
+    if (!writer.close()) return fail("Could not write " + path + ": " + writer.errorString());
+    message = QString("Wrote a snapshot of %1 rows to %2 (%3 KB)").arg(rows).arg(path).arg(QFileInfo(path).size() / 1024);
+    return true;
+}
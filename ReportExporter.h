@@ -0,0 +1,30 @@
+#pragma once
+#include <QString>
+#include <QDate>
+
+class ReportJobContext;
+
+// Exports sales, sale lines or products to CSV or XLSX for accounting. Rows
+// are read through a server-side cursor a batch at a time and written out as
+// they arrive, so memory stays flat however much history is exported. Runs
+// inside a ReportJobRunner job, which supplies the connection, progress and
+// cancellation; a cancelled or failed export deletes its partial file.
+// Dataset::Snapshot writes a columnar .possnap file instead (SalesSnapshot.h).
+class ReportExporter {
+public:
+    enum class Dataset { Sales, SaleLines, Products, Snapshot };
+    enum class Format { Csv, Xlsx };
+    static constexpr int fetchSize = 5000;
+
+    static QString datasetName(Dataset dataset);
+    static Format formatFor(const QString& path); // By file extension
+
+    // A null from/to exports the whole history. An empty cashier means all
+    // cashiers; both are ignored for products and snapshots, which always hold
+    // every sale. On success message holds a summary.
+    static bool run(ReportJobContext& context, Dataset dataset, const QDate& from, const QDate& to,
+                    const QString& cashier, const QString& path, QString& message);
+
+private:
+    static bool runSnapshot(ReportJobContext& context, const QString& path, QString& message);
+};
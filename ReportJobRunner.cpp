@@ -0,0 +1,149 @@
+#include "ReportJobRunner.h"
+#include "DbConnection.h"
+#include <QSettings>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+#include <libpq-fe.h>
+
+struct ReportJobState {
+    int id = 0;
+    QString title;
+    std::atomic_bool cancelled{false};
+    QMutex mutex;                  // Guards cancelHandle
+    PGcancel* cancelHandle = nullptr; // Set while the job holds a connection
+};
+
+static PGconn* pgConnection(const QSqlDatabase& db) {
+    QVariant handle = db.driver() ? db.driver()->handle() : QVariant();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0) return *static_cast<PGconn**>(handle.data());
+    return nullptr;
+}
+
+ReportJobContext::ReportJobContext(ReportJobRunner *runner, std::shared_ptr<ReportJobState> state, const QSqlDatabase& db)
+    : runner(runner), state(std::move(state)), db(db)
+{
+}
+
+bool ReportJobContext::isCancelled() const {
+    return state->cancelled;
+}
+
+void ReportJobContext::setProgress(int done, int total) {
+    emit runner->jobProgress(state->id, done, total);
+}
+
+void ReportJobContext::setStatus(const QString& status) {
+    emit runner->jobStatus(state->id, status);
+}
+
+ReportJobRunner::ReportJobRunner(QObject *parent) : QObject(parent) {
+    QSettings settings;
+    pool.setMaxThreadCount(qMax(1, settings.value("reports/maxConcurrentJobs", 3).toInt()));
+    statementTimeoutMs = qMax(0, settings.value("reports/statementTimeoutSeconds", 120).toInt()) * 1000;
+    // Emitted on the worker; queued back here so callbacks run on the GUI thread
+    connect(this, &ReportJobRunner::jobFinished, this, &ReportJobRunner::finish);
+}
+
+ReportJobRunner::~ReportJobRunner() {
+    cancelAll();
+    pool.waitForDone();
+}
+
+int ReportJobRunner::submit(const QString& title, const Job& job, const Done& done) {
+    auto state = std::make_shared<ReportJobState>();
+    state->id = nextId++;
+    state->title = title;
+    {
+        QMutexLocker locker(&mutex);
+        jobs.insert(state->id, state);
+    }
+    if (done) callbacks.insert(state->id, done);
+    emit jobQueued(state->id, title);
+    pool.start([this, state, job]() { run(state, job); });
+    return state->id;
+}
+
+void ReportJobRunner::cancel(int id) {
+    std::shared_ptr<ReportJobState> state;
+    {
+        QMutexLocker locker(&mutex);
+        state = jobs.value(id);
+    }
+    if (!state) return;
+    state->cancelled = true;
+    QMutexLocker locker(&state->mutex);
+    if (state->cancelHandle) {
+        // Aborts the statement in progress; the job sees it fail and returns
+        char errorBuffer[256];
+        if (!PQcancel(state->cancelHandle, errorBuffer, sizeof(errorBuffer))) {
+            qDebug() << "Could not cancel" << state->title << ":" << errorBuffer;
+        }
+    }
+}
+
+void ReportJobRunner::cancelAll() {
+    QList<int> ids;
+    {
+        QMutexLocker locker(&mutex);
+        ids = jobs.keys();
+    }
+    for (int id : ids) cancel(id);
+}
+
+int ReportJobRunner::runningCount() const {
+    QMutexLocker locker(&mutex);
+    return jobs.size();
+}
+
+void ReportJobRunner::run(std::shared_ptr<ReportJobState> state, Job job) {
+    if (state->cancelled) {
+        emit jobFinished(state->id, false, "Cancelled.");
+        return;
+    }
+    emit jobStarted(state->id);
+    ScopedDbConnection connection("report-job");
+    if (!connection.isOpen()) {
+        emit jobFinished(state->id, false, "Database error: " + connection.lastError());
+        return;
+    }
+    QSqlDatabase db = connection.database();
+    if (statementTimeoutMs > 0) {
+        QSqlQuery timeout(db);
+        if (!timeout.exec(QString("SET statement_timeout = %1").arg(statementTimeoutMs))) {
+            qDebug() << "Could not set statement_timeout:" << timeout.lastError().text();
+        }
+    }
+    if (PGconn* conn = pgConnection(db)) {
+        QMutexLocker locker(&state->mutex);
+        state->cancelHandle = PQgetCancel(conn);
+    }
+
+    ReportJobContext context(this, state, db);
+    QString message;
+    bool ok = job(context, message);
+
+    {
+        QMutexLocker locker(&state->mutex);
+        if (state->cancelHandle) PQfreeCancel(state->cancelHandle);
+        state->cancelHandle = nullptr;
+    }
+    if (state->cancelled) {
+        ok = false;
+        message = "Cancelled.";
+    }
+    emit jobFinished(state->id, ok, message);
+}
+
+void ReportJobRunner::finish(int id, bool ok, const QString& message) {
+    std::shared_ptr<ReportJobState> state;
+    {
+        QMutexLocker locker(&mutex);
+        state = jobs.take(id);
+    }
+    const Done done = callbacks.take(id);
+    // Nobody is waiting on a cancelled job's result
+    if (done && state && !state->cancelled) done(ok, message);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class ReportJobRunner;
+struct ReportJobState;
+
+// What a running job sees: its own connection, progress and cancellation
+class ReportJobContext {
+public:
+    QSqlDatabase database() const { return db; }
+    bool isCancelled() const;
+    void setProgress(int done, int total);
+    void setStatus(const QString& status); // Replaces "Running" in the Jobs tab
+
+private:
+    friend class ReportJobRunner;
+    ReportJobContext(ReportJobRunner *runner, std::shared_ptr<ReportJobState> state, const QSqlDatabase& db);
+
+    ReportJobRunner *runner;
+    std::shared_ptr<ReportJobState> state;
+    QSqlDatabase db;
+};
+
+// Runs Reports screen work off the GUI thread. Each job gets a pooled thread
+// and its own database connection with statement_timeout set, so several
+// reports can run at once. cancel() stops the job's loop and also asks the
+// server to abort whatever statement it is in the middle of.
+//
+// Settings (QSettings): reports/maxConcurrentJobs (3),
+// reports/statementTimeoutSeconds (120, 0 for none).
+class ReportJobRunner : public QObject {
+    Q_OBJECT
+public:
+    // Runs on the worker thread; returns false with a message on failure.
+    // Results are passed back through state the caller captures.
+    using Job = std::function<bool(ReportJobContext& context, QString& message)>;
+    // Runs on the GUI thread once the job is over, unless it was cancelled
+    using Done = std::function<void(bool ok, const QString& message)>;
+
+    explicit ReportJobRunner(QObject *parent = nullptr);
+    ~ReportJobRunner();
+
+    int submit(const QString& title, const Job& job, const Done& done = Done());
+    void cancel(int id);
+    void cancelAll();
+    int runningCount() const;
+
+signals:
+    void jobQueued(int id, const QString& title);
+    void jobStarted(int id);
+    void jobProgress(int id, int done, int total);
+    void jobStatus(int id, const QString& status);
+    void jobFinished(int id, bool ok, const QString& message);
+
+private:
+    friend class ReportJobContext;
+    void run(std::shared_ptr<ReportJobState> state, Job job);
+    void finish(int id, bool ok, const QString& message);
+
+    QThreadPool pool;
+    int statementTimeoutMs;
+    int nextId = 1;
+    mutable QMutex mutex;
+    QHash<int, std::shared_ptr<ReportJobState>> jobs;
+    QHash<int, Done> callbacks; // GUI thread only
+};
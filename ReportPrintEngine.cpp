@@ -0,0 +1,336 @@
+#include "ReportPrintEngine.h"
+#include "ReportJobRunner.h"
+#include "DbConnection.h"
+#include "SalesReportQuery.h"
+#include <QDateTime>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QPagedPaintDevice>
+#include <QPainter>
+#include <QPrinter>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariantList>
+#include <climits>
+#include <functional>
+
+namespace {
+struct PrintColumn {
+    enum Type { Text, Number, Money, DateTime };
+    QString heading;
+    Type type;
+    double width; // Share of the page width
+    bool summed;  // Added up in the totals row
+};
+
+QString formatCell(const QVariant& value, PrintColumn::Type type) {
+    if (value.isNull()) return QString();
+    switch (type) {
+    case PrintColumn::Number: return QString::number(value.toLongLong());
+    case PrintColumn::Money: return QString("$%1").arg(value.toDouble(), 0, 'f', 2);
+    case PrintColumn::DateTime: return value.toDateTime().toString("yyyy-MM-dd HH:mm");
+    case PrintColumn::Text: break;
+    }
+    return value.toString();
+}
+
+// Lays rows out on fixed-height lines and starts a new page whenever one is
+// full, so a page is painted and handed to the device before the next row is
+// read. The row count, known up front, gives the page count for the footer.
+class PageWriter {
+public:
+    PageWriter(QPagedPaintDevice& device, const QString& title, const QString& subtitle, const QList<PrintColumn>& columns)
+        : device(device), title(title), subtitle(subtitle), columns(columns), totals(columns.size(), 0.0)
+    {
+        bodyFont.setPointSizeF(9);
+        headingFont = bodyFont;
+        headingFont.setBold(true);
+        titleFont = headingFont;
+        titleFont.setPointSizeF(14);
+        footerFont = bodyFont;
+        footerFont.setPointSizeF(7.5);
+    }
+
+    bool begin(qint64 rowCount, int closingLines) {
+        if (!painter.begin(&device)) return false;
+        const QFontMetricsF body(bodyFont, &device);
+        const QFontMetricsF heading(headingFont, &device);
+        const QFontMetricsF titleMetrics(titleFont, &device);
+        const QFontMetricsF footer(footerFont, &device);
+        rowHeight = body.lineSpacing() * 1.35;
+        headerHeight = titleMetrics.lineSpacing() + body.lineSpacing() * 1.5 + heading.lineSpacing() * 1.5;
+        footerHeight = footer.lineSpacing() * 2;
+        rowsPerPage = qMax(1, int((device.height() - headerHeight - footerHeight) / rowHeight));
+        // The totals block goes after the last row, on the last page
+        pageCount = int(qMin<qint64>(INT_MAX, (rowCount + closingLines + rowsPerPage - 1) / rowsPerPage));
+        pageCount = qMax(1, pageCount);
+        double x = 0;
+        double shares = 0;
+        for (const PrintColumn& column : columns) shares += column.width;
+        for (const PrintColumn& column : columns) {
+            const double width = device.width() * column.width / shares;
+            cells << QRectF(x, 0, width, rowHeight);
+            x += width;
+        }
+        startPage();
+        return true;
+    }
+
+    void addRow(const QVariantList& values) {
+        if (rowOnPage == rowsPerPage) nextPage();
+        QStringList texts;
+        for (int i = 0; i < columns.size(); ++i) {
+            const QVariant value = values.value(i);
+            texts << formatCell(value, columns[i].type);
+            if (columns[i].summed) totals[i] += value.toDouble();
+        }
+        if (rowOnPage % 2 == 1) painter.fillRect(QRectF(0, rowTop(), device.width(), rowHeight), QColor(240, 240, 240));
+        paintCells(texts, bodyFont);
+        ++rowOnPage;
+        ++rows;
+    }
+
+    // Totals row, then the closing lines, then the last footer
+    bool finish(const QString& totalsLabel, const QStringList& closing) {
+        if (rowOnPage == rowsPerPage) nextPage();
+        QStringList texts;
+        for (int i = 0; i < columns.size(); ++i) {
+            if (columns[i].summed) texts << formatCell(columns[i].type == PrintColumn::Money ? QVariant(totals[i]) : QVariant(qint64(totals[i])), columns[i].type);
+            else texts << (i == 0 ? totalsLabel : QString());
+        }
+        painter.setPen(QPen(Qt::black, device.logicalDpiY() / 100.0));
+        painter.drawLine(QPointF(0, rowTop()), QPointF(device.width(), rowTop()));
+        paintCells(texts, headingFont);
+        ++rowOnPage;
+        painter.setFont(bodyFont);
+        for (const QString& line : closing) {
+            if (rowOnPage == rowsPerPage) nextPage();
+            painter.drawText(QRectF(0, rowTop(), device.width(), rowHeight), Qt::AlignLeft | Qt::AlignVCenter, line);
+            ++rowOnPage;
+        }
+        paintFooter();
+        return painter.end();
+    }
+
+    void abort() {
+        if (QPrinter *printer = dynamic_cast<QPrinter*>(&device)) printer->abort();
+        painter.end();
+    }
+
+    int pages() const { return page; }
+    qint64 rowCount() const { return rows; }
+
+private:
+    double rowTop() const { return headerHeight + rowOnPage * rowHeight; }
+
+    void paintCells(const QStringList& texts, const QFont& font) {
+        painter.setFont(font);
+        const QFontMetricsF metrics(font, &device);
+        const double padding = metrics.averageCharWidth() / 2;
+        for (int i = 0; i < columns.size(); ++i) {
+            const QRectF cell = cells[i].translated(0, rowTop()).adjusted(padding, 0, -padding, 0);
+            const Qt::Alignment alignment = columns[i].type == PrintColumn::Text || columns[i].type == PrintColumn::DateTime
+                ? Qt::AlignLeft : Qt::AlignRight;
+            painter.drawText(cell, alignment | Qt::AlignVCenter, metrics.elidedText(texts.value(i), Qt::ElideRight, cell.width()));
+        }
+    }
+
+    void startPage() {
+        ++page;
+        rowOnPage = 0;
+        painter.setPen(Qt::black);
+        const QFontMetricsF titleMetrics(titleFont, &device);
+        const QFontMetricsF body(bodyFont, &device);
+        double y = 0;
+        painter.setFont(titleFont);
+        painter.drawText(QRectF(0, y, device.width(), titleMetrics.lineSpacing()), Qt::AlignLeft | Qt::AlignVCenter, title);
+        y += titleMetrics.lineSpacing();
+        painter.setFont(bodyFont);
+        painter.drawText(QRectF(0, y, device.width(), body.lineSpacing()), Qt::AlignLeft | Qt::AlignVCenter, subtitle);
+        painter.drawText(QRectF(0, y, device.width(), body.lineSpacing()), Qt::AlignRight | Qt::AlignVCenter,
+                         "Printed " + printedAt.toString("yyyy-MM-dd HH:mm"));
+        // Column headings, underlined, at the bottom of the header band
+        const double headingTop = headerHeight - rowHeight * 1.1;
+        painter.setFont(headingFont);
+        const QFontMetricsF heading(headingFont, &device);
+        const double padding = heading.averageCharWidth() / 2;
+        for (int i = 0; i < columns.size(); ++i) {
+            const QRectF cell = cells[i].translated(0, headingTop).adjusted(padding, 0, -padding, 0);
+            const Qt::Alignment alignment = columns[i].type == PrintColumn::Text || columns[i].type == PrintColumn::DateTime
+                ? Qt::AlignLeft : Qt::AlignRight;
+            painter.drawText(cell, alignment | Qt::AlignVCenter, heading.elidedText(columns[i].heading, Qt::ElideRight, cell.width()));
+        }
+        painter.setPen(QPen(Qt::black, device.logicalDpiY() / 100.0));
+        painter.drawLine(QPointF(0, headingTop + rowHeight), QPointF(device.width(), headingTop + rowHeight));
+    }
+
+    void paintFooter() {
+        const QFontMetricsF footer(footerFont, &device);
+        const QRectF band(0, device.height() - footer.lineSpacing(), device.width(), footer.lineSpacing());
+        painter.setFont(footerFont);
+        painter.setPen(Qt::darkGray);
+        painter.drawText(band, Qt::AlignLeft | Qt::AlignVCenter, title);
+        painter.drawText(band, Qt::AlignRight | Qt::AlignVCenter, QString("Page %1 of %2").arg(page).arg(qMax(page, pageCount)));
+        painter.setPen(Qt::black);
+    }
+
+    void nextPage() {
+        paintFooter();
+        device.newPage();
+        startPage();
+    }
+
+    QPagedPaintDevice& device;
+    QPainter painter;
+    QString title;
+    QString subtitle;
+    QList<PrintColumn> columns;
+    QList<QRectF> cells; // Column rectangles on a row at y = 0
+    QList<double> totals;
+    QFont bodyFont;
+    QFont headingFont;
+    QFont titleFont;
+    QFont footerFont;
+    QDateTime printedAt = QDateTime::currentDateTime();
+    double rowHeight = 0;
+    double headerHeight = 0;
+    double footerHeight = 0;
+    int rowsPerPage = 1;
+    int rowOnPage = 0;
+    int page = 0;
+    int pageCount = 1;
+    qint64 rows = 0;
+};
+}
+
+QString ReportPrintEngine::reportName(Report report) {
+    switch (report) {
+    case Report::SalesSummary: return "Sales Report";
+    case Report::SalesDetail: return "Sales Listing";
+    case Report::Inventory: return "Inventory Report";
+    }
+    return QString();
+}
+
+bool ReportPrintEngine::run(ReportJobContext& context, Report report, const QDate& from, const QDate& to,
+                            const QString& cashier, QPagedPaintDevice& device, QString& message) {
+    const QSqlDatabase db = context.database();
+    QString subtitle;
+    if (report != Report::Inventory) {
+        subtitle = from == to ? from.toString("d MMMM yyyy")
+                              : QString("%1 to %2").arg(from.toString("d MMMM yyyy"), to.toString("d MMMM yyyy"));
+        subtitle += cashier.isEmpty() ? QString(", all cashiers") : ", cashier " + cashier;
+    }
+
+    QList<PrintColumn> columns;
+    QString totalsLabel = "Total";
+    QStringList closing;
+    qint64 rowCount = 0;
+    // Feeds every row to the writer; false on a database error or cancellation
+    std::function<bool(PageWriter&)> feed;
+
+    QList<SalesReport> summaryRows;
+    SalesReport period;
+    QString sql;
+    QVariantList binds;
+    switch (report) {
+    case Report::SalesSummary:
+        // One row per report bucket, the same rows the Sales Report tab shows
+        if (!SalesReportQuery::run(db, from, to, cashier, SalesReportQuery::bucketFor(from, to), summaryRows, period, &message)) {
+            message = "Print failed: " + message;
+            return false;
+        }
+        columns = {{"Period", PrintColumn::Text, 3, false}, {"Total Sales", PrintColumn::Money, 2, true},
+                   {"Orders", PrintColumn::Number, 1.5, true}, {"Average Order", PrintColumn::Money, 2, false},
+                   {"Top Product", PrintColumn::Text, 4, false}};
+        rowCount = summaryRows.size();
+        closing << QString("Average order: $%1").arg(period.averageOrderValue, 0, 'f', 2);
+        if (!period.topProduct.isEmpty()) closing << QString("Top product: %1 (%2 sold)").arg(period.topProduct).arg(period.topProductQuantity);
+        feed = [&](PageWriter& writer) {
+            for (const SalesReport& row : summaryRows) {
+                writer.addRow({row.date, row.totalSales, row.totalOrders, row.averageOrderValue,
+                               row.topProduct.isEmpty() ? QString() : QString("%1 (%2 sold)").arg(row.topProduct).arg(row.topProductQuantity)});
+            }
+            return true;
+        };
+        break;
+    case Report::SalesDetail: {
+        sql = "SELECT s.id, s.sale_time, s.cashier, s.payment_method, s.total FROM sales s "
+              "WHERE (? = '' OR s.cashier = ?) AND s.sale_time >= ? AND s.sale_time < ?";
+        binds << cashier << cashier << from.startOfDay() << to.addDays(1).startOfDay();
+        QSqlQuery count(db);
+        count.prepare("SELECT COUNT(*) FROM (" + sql + ") s");
+        for (const QVariant& value : binds) count.addBindValue(value);
+        if (!count.exec() || !count.next()) {
+            message = "Print failed: " + count.lastError().text();
+            return false;
+        }
+        rowCount = count.value(0).toLongLong();
+        sql += " ORDER BY s.sale_time, s.id";
+        columns = {{"Sale ID", PrintColumn::Number, 1.5, false}, {"Time", PrintColumn::DateTime, 2.5, false},
+                   {"Cashier", PrintColumn::Text, 2.5, false}, {"Payment", PrintColumn::Text, 2, false},
+                   {"Total", PrintColumn::Money, 2, true}};
+        totalsLabel = QString("%1 sales").arg(rowCount);
+        break;
+    }
+    case Report::Inventory:
+        sql = "SELECT COALESCE(NULLIF(category, ''), '(none)'), COUNT(*), COUNT(*) FILTER (WHERE quantity <= min_stock), "
+              "SUM(price * quantity)::float8, (array_agg(name ORDER BY price DESC, name))[1] "
+              "FROM products GROUP BY 1 ORDER BY 1";
+        columns = {{"Category", PrintColumn::Text, 3, false}, {"Total Items", PrintColumn::Number, 1.5, true},
+                   {"Low Stock", PrintColumn::Number, 1.5, true}, {"Total Value", PrintColumn::Money, 2, true},
+                   {"Most Expensive", PrintColumn::Text, 3, false}};
+        break;
+    }
+
+    // Cursor-backed reports stream their rows; categories are few, so their count comes from the same query
+    if (!sql.isEmpty()) {
+        if (report == Report::Inventory) {
+            QSqlQuery count(db);
+            if (!count.exec("SELECT COUNT(DISTINCT COALESCE(NULLIF(category, ''), '(none)')) FROM products") || !count.next()) {
+                message = "Print failed: " + count.lastError().text();
+                return false;
+            }
+            rowCount = count.value(0).toLongLong();
+        }
+        feed = [&](PageWriter& writer) {
+            SqlCursor cursor(db, "report_print", fetchSize);
+            if (!cursor.open(sql, binds)) {
+                message = "Print failed: " + cursor.lastError();
+                return false;
+            }
+            QSqlQuery batch(db);
+            QVariantList values;
+            while (cursor.fetch(batch)) {
+                do {
+                    values.clear();
+                    for (int i = 0; i < columns.size(); ++i) values << batch.value(i);
+                    writer.addRow(values);
+                } while (batch.next());
+                context.setProgress(int(qMin<qint64>(writer.rowCount(), INT_MAX)), int(qMin<qint64>(qMax(rowCount, writer.rowCount()), INT_MAX)));
+                if (context.isCancelled()) return false;
+            }
+            if (!cursor.atEnd()) {
+                message = "Print failed: " + cursor.lastError();
+                return false;
+            }
+            return true;
+        };
+    }
+
+    PageWriter writer(device, reportName(report), subtitle, columns);
+    if (!writer.begin(rowCount, 1 + closing.size())) {
+        message = "Could not start printing.";
+        return false;
+    }
+    if (!feed(writer)) {
+        writer.abort();
+        return false;
+    }
+    if (!writer.finish(totalsLabel, closing)) {
+        message = "Printing failed while finishing the document.";
+        return false;
+    }
+    message = QString("%1: %2 rows on %3 pages").arg(reportName(report)).arg(writer.rowCount()).arg(writer.pages());
+    return true;
+}
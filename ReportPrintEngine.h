@@ -0,0 +1,29 @@
+#pragma once
+#include <QString>
+#include <QDate>
+
+class ReportJobContext;
+class QPagedPaintDevice;
+
+// Prints the Reports screen's sales and inventory reports straight from the
+// database rather than from the on-screen tables. Rows are read a batch at a
+// time (a server-side cursor for the per-sale listing) and painted as they
+// arrive, a page at a time, with the title and column headings repeated on
+// every page, a "Page n of m" footer and a totals block at the end. Memory
+// stays flat however many pages the report runs to.
+//
+// Runs inside a ReportJobRunner job, so the painting happens on a worker
+// thread; QPrinter and QPdfWriter may be painted from any thread.
+class ReportPrintEngine {
+public:
+    enum class Report { SalesSummary, SalesDetail, Inventory };
+    static constexpr int fetchSize = 2000;
+
+    static QString reportName(Report report);
+
+    // from and to (inclusive) and cashier (empty for everyone) apply to the
+    // sales reports. device belongs to the job until it returns; a cancelled
+    // print is aborted on a printer and left incomplete in a PDF.
+    static bool run(ReportJobContext& context, Report report, const QDate& from, const QDate& to,
+                    const QString& cashier, QPagedPaintDevice& device, QString& message);
+};
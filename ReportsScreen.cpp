@@ -1,4 +1,15 @@
 #include "ReportsScreen.h"
+#include "BulkReceiptExporter.h"
+#include "ReportJobRunner.h"
+#include "ReportExporter.h"
+#include "TopSellers.h"
+#include "OrderQuantiles.h"
+#include "BackupManager.h"
+#include "IncrementalBackup.h"
+#include "ReportPrintEngine.h"
+#include "ActivityLogger.h"
+#include "ActivityLogQuery.h"
+#include "ActivityFeed.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
@@ -15,13 +26,27 @@
 #include <QCalendarWidget>
 #include <QSqlQuery>
 #include <QFileDialog>
-#include <QProcess>
 #include <QDir>
-#include <QProcessEnvironment>
 #include <QSqlError>
 #include <QDebug>
+#include <QInputDialog>
+#include <QLineEdit>
+#include <QMenu>
+#include <QPrinter>
+#include <QPrintDialog>
+#include <QPdfWriter>
+#include <QProgressDialog>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTimer>
+#include <QPointer>
+#include <QRegularExpressionValidator>
+#include <memory>
 
-ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
+ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent), receiptExporter(new BulkReceiptExporter(this)),
+    columnStore(SalesColumnStore::isEnabled() ? new SalesColumnStore(this) : nullptr), jobRunner(new ReportJobRunner(this)) {
     QVBoxLayout *mainLayout = new QVBoxLayout(this);
     mainLayout->setSpacing(20);
     mainLayout->setContentsMargins(20, 20, 20, 20);
@@ -80,8 +105,12 @@ ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
     topProductTitle->setStyleSheet("color: #888888; font-size: 14px;");
     topProductLabel = new QLabel("No data");
     topProductLabel->setStyleSheet("color: #9C27B0; font-size: 18px; font-weight: bold;");
+    trendingLabel = new QLabel;
+    trendingLabel->setStyleSheet("color: #888888; font-size: 12px;");
     topProductLayout->addWidget(topProductTitle);
     topProductLayout->addWidget(topProductLabel);
+    topProductLayout->addWidget(trendingLabel);
+    connect(&TopSellers::instance(), &TopSellers::updated, this, &ReportsScreen::updateTrending);
     
     summaryLayout->addWidget(revenueCard);
     summaryLayout->addWidget(ordersCard);
@@ -90,10 +119,15 @@ ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
     
     mainLayout->addLayout(summaryLayout);
 
-    // Backup Button
+    // Backup Button, with full and incremental backups and restore on its menu
     backupBtn = new QPushButton("Backup Data");
     backupBtn->setStyleSheet("QPushButton { background: #607D8B; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #455A64; }");
-    connect(backupBtn, &QPushButton::clicked, this, &ReportsScreen::backupDatabase);
+    QMenu *backupMenu = new QMenu(backupBtn);
+    backupMenu->addAction("Full Backup...", this, &ReportsScreen::backupDatabase);
+    backupMenu->addAction("Incremental Backup", this, &ReportsScreen::backupIncremental);
+    restoreAction = backupMenu->addAction("Restore Backup...", this, &ReportsScreen::restoreBackup);
+    restoreAction->setVisible(false); // Admins only
+    backupBtn->setMenu(backupMenu);
     mainLayout->addWidget(backupBtn, 0, Qt::AlignRight);
 
     // Tab Widget for different reports
@@ -144,6 +178,10 @@ ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
     printSalesBtn->setStyleSheet("QPushButton { background: #FF9800; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #F57C00; }");
     connect(printSalesBtn, &QPushButton::clicked, this, &ReportsScreen::printReport);
     
+    exportReceiptsBtn = new QPushButton("Export Receipts");
+    exportReceiptsBtn->setStyleSheet("QPushButton { background: #9C27B0; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #7B1FA2; }");
+    connect(exportReceiptsBtn, &QPushButton::clicked, this, &ReportsScreen::exportReceipts);
+    
     salesControlsLayout->addWidget(periodLabel);
     salesControlsLayout->addWidget(salesPeriodCombo);
     salesControlsLayout->addWidget(startLabel);
@@ -155,6 +193,7 @@ ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
     salesControlsLayout->addWidget(generateSalesBtn);
     salesControlsLayout->addWidget(exportSalesBtn);
     salesControlsLayout->addWidget(printSalesBtn);
+    salesControlsLayout->addWidget(exportReceiptsBtn);
     
     salesTabLayout->addLayout(salesControlsLayout);
     salesTabLayout->addWidget(salesTable);
@@ -195,14 +234,138 @@ ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
     inventoryTabLayout->addLayout(inventoryControlsLayout);
     inventoryTabLayout->addWidget(inventoryTable);
     
+    // Pivot Tab
+    QWidget *pivotTab = new QWidget;
+    QVBoxLayout *pivotTabLayout = new QVBoxLayout(pivotTab);
+    QHBoxLayout *pivotControlsLayout = new QHBoxLayout;
+    QLabel *groupByLabel = new QLabel("Group by:");
+    groupByLabel->setStyleSheet("color: #ffffff; font-size: 14px;");
+    pivotDimensionCombo = new QComboBox;
+    for (SalesColumnStore::Dimension dimension : {SalesColumnStore::Category, SalesColumnStore::Product, SalesColumnStore::HourOfDay,
+                                                  SalesColumnStore::Weekday, SalesColumnStore::Cashier, SalesColumnStore::PaymentMethod}) {
+        pivotDimensionCombo->addItem(SalesColumnStore::dimensionName(dimension), int(dimension));
+    }
+    pivotDimensionCombo->setStyleSheet("QComboBox { padding: 8px; border: 2px solid #444; border-radius: 6px; background: #2d313a; color: white; font-size: 14px; }");
+    runPivotBtn = new QPushButton("Run Pivot");
+    runPivotBtn->setStyleSheet("QPushButton { background: #4CAF50; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #45a049; }");
+    connect(runPivotBtn, &QPushButton::clicked, this, &ReportsScreen::runPivot);
+    connect(pivotDimensionCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &ReportsScreen::runPivot);
+    pivotStatusLabel = new QLabel("Uses the period and cashier chosen on the Sales Report tab.");
+    pivotStatusLabel->setStyleSheet("color: #888888; font-size: 13px;");
+    pivotControlsLayout->addWidget(groupByLabel);
+    pivotControlsLayout->addWidget(pivotDimensionCombo);
+    pivotControlsLayout->addWidget(pivotStatusLabel);
+    pivotControlsLayout->addStretch();
+    pivotControlsLayout->addWidget(runPivotBtn);
+    pivotTable = new QTableWidget;
+    pivotTable->setColumnCount(5);
+    pivotTable->setHorizontalHeaderLabels({"Group", "Revenue", "Quantity", "Lines", "Share"});
+    pivotTable->setStyleSheet("QTableWidget { background: #2d313a; border: 2px solid #444; border-radius: 8px; color: white; gridline-color: #444; } QHeaderView::section { background: #3a3f4b; color: white; padding: 8px; border: none; } QTableWidget::item { padding: 8px; }");
+    pivotTable->horizontalHeader()->setStretchLastSection(true);
+    pivotTable->setAlternatingRowColors(true);
+    pivotTable->setMinimumHeight(300);
+    pivotTabLayout->addLayout(pivotControlsLayout);
+    pivotTabLayout->addWidget(pivotTable);
+    if (columnStore) {
+        // Pivots read whatever is resident; sales added since come in on a timer
+        connect(columnStore, &SalesColumnStore::refreshed, this, [this](bool ok, const QString& message) {
+            runPivotBtn->setEnabled(true);
+            if (!ok) {
+                if (pivotCacheLoaded) {
+                    qDebug() << "Analytics cache refresh failed:" << message;
+                } else {
+                    pivotStatusLabel->clear();
+                    QMessageBox::warning(this, "Pivot", message);
+                }
+                return;
+            }
+            pivotCacheLoaded = true;
+            if (pivotShown) pivotFromCache(message);
+        });
+        QTimer *pivotRefreshTimer = new QTimer(this);
+        connect(pivotRefreshTimer, &QTimer::timeout, this, [this]() {
+            if (pivotCacheLoaded) columnStore->refresh();
+        });
+        pivotRefreshTimer->start(qMax(10, QSettings().value("analytics/refreshSeconds", 60).toInt()) * 1000);
+    }
+    
+    // Baskets Tab: order value and item count percentiles
+    QWidget *basketsTab = new QWidget;
+    QVBoxLayout *basketsTabLayout = new QVBoxLayout(basketsTab);
+    QHBoxLayout *basketsControlsLayout = new QHBoxLayout;
+    QLabel *basketGroupLabel = new QLabel("Group by:");
+    basketGroupLabel->setStyleSheet("color: #ffffff; font-size: 14px;");
+    basketGroupCombo = new QComboBox;
+    for (OrderQuantiles::GroupBy groupBy : {OrderQuantiles::GroupBy::Total, OrderQuantiles::GroupBy::Hour, OrderQuantiles::GroupBy::Day,
+                                            OrderQuantiles::GroupBy::Cashier, OrderQuantiles::GroupBy::Terminal}) {
+        basketGroupCombo->addItem(OrderQuantiles::groupName(groupBy), int(groupBy));
+    }
+    basketGroupCombo->setStyleSheet("QComboBox { padding: 8px; border: 2px solid #444; border-radius: 6px; background: #2d313a; color: white; font-size: 14px; }");
+    runBasketsBtn = new QPushButton("Run");
+    runBasketsBtn->setStyleSheet("QPushButton { background: #4CAF50; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #45a049; }");
+    connect(runBasketsBtn, &QPushButton::clicked, this, &ReportsScreen::runBasketQuantiles);
+    QLabel *basketsHint = new QLabel("Percentiles for the period and cashier chosen on the Sales Report tab.");
+    basketsHint->setStyleSheet("color: #888888; font-size: 13px;");
+    basketsControlsLayout->addWidget(basketGroupLabel);
+    basketsControlsLayout->addWidget(basketGroupCombo);
+    basketsControlsLayout->addWidget(basketsHint);
+    basketsControlsLayout->addStretch();
+    basketsControlsLayout->addWidget(runBasketsBtn);
+    basketsTable = new QTableWidget;
+    basketsTable->setColumnCount(8);
+    basketsTable->setHorizontalHeaderLabels({"Group", "Orders", "Value p50", "Value p90", "Value p99", "Items p50", "Items p90", "Items p99"});
+    basketsTable->setStyleSheet("QTableWidget { background: #2d313a; border: 2px solid #444; border-radius: 8px; color: white; gridline-color: #444; } QHeaderView::section { background: #3a3f4b; color: white; padding: 8px; border: none; } QTableWidget::item { padding: 8px; }");
+    basketsTable->horizontalHeader()->setStretchLastSection(true);
+    basketsTable->setAlternatingRowColors(true);
+    basketsTable->setMinimumHeight(300);
+    basketsTabLayout->addLayout(basketsControlsLayout);
+    basketsTabLayout->addWidget(basketsTable);
+
     tabWidget->addTab(salesTab, "Sales Report");
     tabWidget->addTab(inventoryTab, "Inventory Report");
+    tabWidget->addTab(pivotTab, "Pivot");
+    tabWidget->addTab(basketsTab, "Baskets");
     
     mainLayout->addWidget(tabWidget);
 
     // Activity Log Tab
     QWidget *activityTab = new QWidget;
     QVBoxLayout *activityLayout = new QVBoxLayout(activityTab);
+    QHBoxLayout *logFilterLayout = new QHBoxLayout;
+    const QString editStyle = "QLineEdit { padding: 8px; border: 2px solid #444; border-radius: 6px; background: #2d313a; color: white; font-size: 14px; }";
+    const QString comboStyle = "QComboBox { padding: 8px; border: 2px solid #444; border-radius: 6px; background: #2d313a; color: white; font-size: 14px; }";
+    logUserEdit = new QLineEdit;
+    logUserEdit->setPlaceholderText("User");
+    logUserEdit->setStyleSheet(editStyle);
+    logActionCombo = new QComboBox;
+    logActionCombo->setEditable(true);
+    logActionCombo->addItems({"All Actions", "Login", "Sale", "Add Product", "Edit Product", "Delete Product", "Stock Count",
+                              "Import Products", "Export Report", "Export Receipts", "Print Report", "Backup Database",
+                              "Incremental Backup", "Nightly Backup", "Backup Failed", "Restore Backup"});
+    logActionCombo->setStyleSheet(comboStyle);
+    logPeriodCombo = new QComboBox;
+    logPeriodCombo->addItems({"All Time", "Today", "Last 7 Days", "Last 30 Days"});
+    logPeriodCombo->setStyleSheet(comboStyle);
+    logSaleEdit = new QLineEdit;
+    logSaleEdit->setPlaceholderText("Sale #");
+    logSaleEdit->setValidator(new QRegularExpressionValidator(QRegularExpression("\\d{0,18}"), logSaleEdit));
+    logSaleEdit->setStyleSheet(editStyle);
+    logProductEdit = new QLineEdit;
+    logProductEdit->setPlaceholderText("Product");
+    logProductEdit->setStyleSheet(editStyle);
+    logFilterLayout->addWidget(logUserEdit);
+    logFilterLayout->addWidget(logActionCombo);
+    logFilterLayout->addWidget(logPeriodCombo);
+    logFilterLayout->addWidget(logSaleEdit);
+    logFilterLayout->addWidget(logProductEdit);
+    QPushButton *searchLogBtn = new QPushButton("Search");
+    searchLogBtn->setStyleSheet("QPushButton { background: #4CAF50; color: white; border: none; border-radius: 8px; padding: 10px; font-size: 14px; font-weight: bold; } QPushButton:hover { background: #45a049; }");
+    connect(searchLogBtn, &QPushButton::clicked, this, &ReportsScreen::refreshActivityLog);
+    connect(logUserEdit, &QLineEdit::returnPressed, this, &ReportsScreen::refreshActivityLog);
+    connect(logSaleEdit, &QLineEdit::returnPressed, this, &ReportsScreen::refreshActivityLog);
+    connect(logProductEdit, &QLineEdit::returnPressed, this, &ReportsScreen::refreshActivityLog);
+    logFilterLayout->addWidget(searchLogBtn);
+    activityLayout->addLayout(logFilterLayout);
     activityLogTable = new QTableWidget;
     activityLogTable->setColumnCount(4);
     activityLogTable->setHorizontalHeaderLabels({"User", "Action", "Details", "Timestamp"});
@@ -214,8 +377,66 @@ ReportsScreen::ReportsScreen(QWidget *parent) : QWidget(parent) {
     QPushButton *refreshLogBtn = new QPushButton("Refresh Log");
     refreshLogBtn->setStyleSheet("QPushButton { background: #607D8B; color: white; border: none; border-radius: 8px; padding: 8px; font-size: 13px; font-weight: bold; } QPushButton:hover { background: #455A64; }");
     connect(refreshLogBtn, &QPushButton::clicked, this, &ReportsScreen::refreshActivityLog);
-    activityLayout->addWidget(refreshLogBtn, 0, Qt::AlignRight);
+    loadMoreLogBtn = new QPushButton("Load More");
+    loadMoreLogBtn->setStyleSheet(refreshLogBtn->styleSheet());
+    loadMoreLogBtn->setEnabled(false);
+    connect(loadMoreLogBtn, &QPushButton::clicked, this, &ReportsScreen::loadMoreActivityLog);
+    QHBoxLayout *logButtonsLayout = new QHBoxLayout;
+    logButtonsLayout->addStretch();
+    logButtonsLayout->addWidget(loadMoreLogBtn);
+    logButtonsLayout->addWidget(refreshLogBtn);
+    activityLayout->addLayout(logButtonsLayout);
     tabWidget->addTab(activityTab, "Activity Log");
+
+    // Jobs Tab
+    QWidget *jobsTab = new QWidget;
+    QVBoxLayout *jobsLayout = new QVBoxLayout(jobsTab);
+    jobsTable = new QTableWidget;
+    jobsTable->setColumnCount(4);
+    jobsTable->setHorizontalHeaderLabels({"Job", "Status", "Progress", "Result"});
+    jobsTable->setStyleSheet("QTableWidget { background: #2d313a; border: 2px solid #444; border-radius: 8px; color: white; gridline-color: #444; } QHeaderView::section { background: #3a3f4b; color: white; padding: 8px; border: none; } QTableWidget::item { padding: 8px; }");
+    jobsTable->horizontalHeader()->setStretchLastSection(true);
+    jobsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    jobsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    jobsTable->setAlternatingRowColors(true);
+    jobsLayout->addWidget(jobsTable);
+    cancelJobBtn = new QPushButton("Cancel Job");
+    cancelJobBtn->setStyleSheet("QPushButton { background: #F44336; color: white; border: none; border-radius: 8px; padding: 8px; font-size: 13px; font-weight: bold; } QPushButton:hover { background: #D32F2F; }");
+    connect(cancelJobBtn, &QPushButton::clicked, this, &ReportsScreen::cancelSelectedJobs);
+    jobsLayout->addWidget(cancelJobBtn, 0, Qt::AlignRight);
+    tabWidget->addTab(jobsTab, "Jobs");
+    connect(jobRunner, &ReportJobRunner::jobQueued, this, [this](int id, const QString& title) {
+        const int row = jobsTable->rowCount();
+        jobsTable->insertRow(row);
+        QTableWidgetItem *titleItem = new QTableWidgetItem(title);
+        titleItem->setData(Qt::UserRole, id);
+        jobsTable->setItem(row, 0, titleItem);
+        jobsTable->setItem(row, 1, new QTableWidgetItem("Queued"));
+        jobsTable->setItem(row, 2, new QTableWidgetItem());
+        jobsTable->setItem(row, 3, new QTableWidgetItem());
+    });
+    connect(jobRunner, &ReportJobRunner::jobStarted, this, [this](int id) { setJobCell(id, 1, "Running"); });
+    connect(jobRunner, &ReportJobRunner::jobStatus, this, [this](int id, const QString& status) { setJobCell(id, 1, status); });
+    connect(jobRunner, &ReportJobRunner::jobProgress, this, [this](int id, int done, int total) {
+        setJobCell(id, 2, total > 0 ? QString("%1 / %2").arg(done).arg(total) : QString::number(done));
+    });
+    connect(jobRunner, &ReportJobRunner::jobFinished, this, [this](int id, bool ok, const QString& message) {
+        if (id == nightlyBackupJob) {
+            // Until one goes through, the nightly backup is retried every 15 minutes
+            nightlyBackupJob = 0;
+            nightlyRetryAt = ok ? QDateTime() : QDateTime::currentDateTime().addSecs(15 * 60);
+        }
+        setJobCell(id, 1, ok ? "Done" : message == "Cancelled." ? "Cancelled" : "Failed");
+        setJobCell(id, 3, message);
+        const int row = jobRow(id);
+        if (row >= 0) jobsTable->item(row, 1)->setData(Qt::UserRole, true); // Finished
+        pruneFinishedJobs();
+    });
+
+    QTimer *nightlyBackupTimer = new QTimer(this);
+    connect(nightlyBackupTimer, &QTimer::timeout, this, &ReportsScreen::runNightlyBackup);
+    nightlyBackupTimer->start(60 * 1000);
+
     refreshActivityLog();
 }
 
@@ -252,6 +473,7 @@ void ReportsScreen::loadSampleData() {
 
 void ReportsScreen::setUserRole(const QString& role) {
     userRole = role;
+    restoreAction->setVisible(userRole == "admin");
     updateCashierFilter();
 }
 
@@ -273,9 +495,63 @@ void ReportsScreen::updateCashierFilter() {
     }
 }
 
+bool ReportsScreen::salesReportRange(QDate& from, QDate& to) const {
+    const QDate today = QDate::currentDate();
+    to = today;
+    switch (salesPeriodCombo->currentIndex()) {
+    case 0: from = today; break;                                   // Today
+    case 1: from = today.addDays(1 - today.dayOfWeek()); break;    // This Week (from Monday)
+    case 2: from = QDate(today.year(), today.month(), 1); break;   // This Month
+    case 3: from = QDate(today.year(), 1, 1); break;               // This Year
+    default:
+        from = startDateEdit->date();
+        to = endDateEdit->date();
+        break;
+    }
+    return from <= to;
+}
+
+QString ReportsScreen::reportCashier() const {
+    // Cashiers only ever see their own sales
+    if (userRole != "admin") return username;
+    return cashierCombo->currentIndex() > 0 ? cashierCombo->currentText() : QString();
+}
+
 void ReportsScreen::generateSalesReport() {
+    QDate from, to;
+    if (!salesReportRange(from, to)) {
+        QMessageBox::warning(this, "Sales Report", "The start date must not be after the end date.");
+        return;
+    }
+    startDateEdit->setDate(from);
+    endDateEdit->setDate(to);
+
+    struct Result {
+        QList<SalesReport> rows;
+        SalesReport period;
+    };
+    auto result = std::make_shared<Result>();
+    const QString cashier = reportCashier();
+    jobRunner->submit(QString("Sales report %1 to %2").arg(from.toString(Qt::ISODate), to.toString(Qt::ISODate)),
+        [=](ReportJobContext& context, QString& message) {
+            return SalesReportQuery::run(context.database(), from, to, cashier, SalesReportQuery::bucketFor(from, to),
+                                         result->rows, result->period, &message);
+        },
+        [this, result](bool ok, const QString& message) {
+            if (!ok) {
+                QMessageBox::critical(this, "Error", "Failed to generate sales report: " + message);
+                return;
+            }
+            salesData = result->rows;
+            showSalesReport(result->period);
+        });
+}
+
+void ReportsScreen::showSalesReport(const SalesReport& period) {
+    updateSummaryCards(period);
     if (salesData.isEmpty()) {
-        QMessageBox::information(this, "No Data", "No sales data available. Make some sales first!");
+        salesTable->setRowCount(0);
+        QMessageBox::information(this, "No Data", "No sales in the selected period.");
         return;
     }
     
@@ -288,12 +564,128 @@ void ReportsScreen::generateSalesReport() {
         salesTable->setItem(i, 1, new QTableWidgetItem(QString("$%1").arg(report.totalSales, 0, 'f', 2)));
         salesTable->setItem(i, 2, new QTableWidgetItem(QString::number(report.totalOrders)));
         salesTable->setItem(i, 3, new QTableWidgetItem(QString("$%1").arg(report.averageOrderValue, 0, 'f', 2)));
-        salesTable->setItem(i, 4, new QTableWidgetItem(QString("%1 (%2 sold)").arg(report.topProduct).arg(report.topProductQuantity)));
+        salesTable->setItem(i, 4, new QTableWidgetItem(report.topProduct.isEmpty() ? QString()
+                                                       : QString("%1 (%2 sold)").arg(report.topProduct).arg(report.topProductQuantity)));
     }
     
     QMessageBox::information(this, "Success", "Sales report generated successfully!");
 }
 
+void ReportsScreen::runPivot() {
+    QDate from, to;
+    if (!salesReportRange(from, to)) {
+        QMessageBox::warning(this, "Pivot", "The start date must not be after the end date.");
+        return;
+    }
+    if (columnStore) {
+        pivotShown = true;
+        if (pivotCacheLoaded) {
+            pivotFromCache(QString());
+        } else if (!columnStore->isRunning()) {
+            // The pivot runs when the first load finishes
+            runPivotBtn->setEnabled(false);
+            pivotStatusLabel->setText("Loading sales into the analytics cache...");
+            columnStore->refresh();
+        }
+        return;
+    }
+    const auto dimension = SalesColumnStore::Dimension(pivotDimensionCombo->currentData().toInt());
+    const QString cashier = reportCashier();
+    auto rows = std::make_shared<QList<SalesColumnStore::PivotRow>>();
+    auto timer = std::make_shared<QElapsedTimer>();
+    timer->start();
+    pivotStatusLabel->setText("Querying...");
+    jobRunner->submit("Pivot by " + SalesColumnStore::dimensionName(dimension),
+        [=](ReportJobContext& context, QString& message) {
+            return SalesColumnStore::pivotFromDatabase(context.database(), dimension, from, to, cashier, *rows, &message);
+        },
+        [this, rows, timer](bool ok, const QString& message) {
+            if (!ok) {
+                pivotStatusLabel->clear();
+                QMessageBox::critical(this, "Error", "Failed to run pivot: " + message);
+                return;
+            }
+            showPivot(*rows, QString("Queried in %1 ms").arg(timer->elapsed()));
+        });
+}
+
+void ReportsScreen::runBasketQuantiles() {
+    QDate from, to;
+    if (!salesReportRange(from, to)) {
+        QMessageBox::warning(this, "Baskets", "The start date must not be after the end date.");
+        return;
+    }
+    const auto groupBy = OrderQuantiles::GroupBy(basketGroupCombo->currentData().toInt());
+    const QString cashier = reportCashier();
+    auto rows = std::make_shared<QList<OrderQuantiles::Row>>();
+    jobRunner->submit("Basket percentiles by " + OrderQuantiles::groupName(groupBy),
+        [=](ReportJobContext& context, QString& message) {
+            return OrderQuantiles::query(context.database(), from, to, groupBy, cashier, {0.5, 0.9, 0.99}, *rows, &message);
+        },
+        [this, rows](bool ok, const QString& message) {
+            if (!ok) {
+                QMessageBox::critical(this, "Error", "Failed to compute basket percentiles: " + message);
+                return;
+            }
+            basketsTable->setRowCount(rows->size());
+            for (int i = 0; i < rows->size(); ++i) {
+                const OrderQuantiles::Row& row = rows->at(i);
+                basketsTable->setItem(i, 0, new QTableWidgetItem(row.label));
+                basketsTable->setItem(i, 1, new QTableWidgetItem(QString::number(row.orders)));
+                for (int q = 0; q < 3; ++q) {
+                    basketsTable->setItem(i, 2 + q, new QTableWidgetItem(QString("$%1").arg(row.values[q], 0, 'f', 2)));
+                    basketsTable->setItem(i, 5 + q, new QTableWidgetItem(QString::number(row.items[q], 'f', 1)));
+                }
+            }
+        });
+}
+
+// In memory, on the GUI thread; note says what the last refresh brought in
+void ReportsScreen::pivotFromCache(const QString& note) {
+    QDate from, to;
+    if (!salesReportRange(from, to)) return;
+    const auto dimension = SalesColumnStore::Dimension(pivotDimensionCombo->currentData().toInt());
+    QElapsedTimer timer;
+    timer.start();
+    const QList<SalesColumnStore::PivotRow> rows = columnStore->pivot(dimension, from, to, reportCashier());
+    const QString pivoted = QString("Pivoted %1 cached sale lines in %2 ms").arg(columnStore->lineCount()).arg(timer.elapsed());
+    showPivot(rows, note.isEmpty() ? pivoted : note + "; " + pivoted);
+}
+
+void ReportsScreen::showPivot(const QList<SalesColumnStore::PivotRow>& rows, const QString& status) {
+    qint64 totalCents = 0;
+    for (const SalesColumnStore::PivotRow& row : rows) totalCents += row.revenueCents;
+    pivotTable->setRowCount(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        const SalesColumnStore::PivotRow& row = rows[i];
+        pivotTable->setItem(i, 0, new QTableWidgetItem(row.label));
+        pivotTable->setItem(i, 1, new QTableWidgetItem(QString("$%1").arg(row.revenueCents / 100.0, 0, 'f', 2)));
+        pivotTable->setItem(i, 2, new QTableWidgetItem(QString::number(row.quantity)));
+        pivotTable->setItem(i, 3, new QTableWidgetItem(QString::number(row.lines)));
+        const double share = totalCents > 0 ? 100.0 * row.revenueCents / totalCents : 0.0;
+        pivotTable->setItem(i, 4, new QTableWidgetItem(QString("%1%").arg(share, 0, 'f', 1)));
+    }
+    pivotStatusLabel->setText(status);
+}
+
+void ReportsScreen::updateSummaryCards(const SalesReport& period) {
+    totalRevenueLabel->setText(QString("$%1").arg(period.totalSales, 0, 'f', 2));
+    totalOrdersLabel->setText(QString::number(period.totalOrders));
+    averageOrderLabel->setText(QString("$%1").arg(period.averageOrderValue, 0, 'f', 2));
+    topProductLabel->setText(period.topProduct.isEmpty() ? QString("No data") : period.topProduct);
+}
+
+// What's selling right now, from the live top-sellers sketch rather than the report
+void ReportsScreen::updateTrending() {
+    const TopSellers::Result lastHour = TopSellers::instance().top(TopSellers::Window::LastHour, 1);
+    if (lastHour.entries.isEmpty()) {
+        trendingLabel->clear();
+        return;
+    }
+    const TopSellers::Entry &entry = lastHour.entries.first();
+    trendingLabel->setText(QString("Last hour: %1 (%2%3 sold)").arg(entry.product).arg(entry.error > 0 ? "~" : "").arg(entry.quantity));
+}
+
 void ReportsScreen::generateInventoryReport() {
     if (inventoryData.isEmpty()) {
         QMessageBox::information(this, "No Data", "No inventory data available. Add some products first!");
@@ -322,15 +714,150 @@ void ReportsScreen::generateInventoryReport() {
 }
 
 void ReportsScreen::exportReport() {
-    QString currentTab = tabWidget->tabText(tabWidget->currentIndex());
-    QMessageBox::information(this, "Export", QString("Exporting %1 report...\n\nThis would save the report to a file in a real application.").arg(currentTab));
-    // Log export
-    logActivity(username, "Export Report", "Report exported by user");
+    using Dataset = ReportExporter::Dataset;
+    QList<Dataset> datasets = {Dataset::Sales, Dataset::SaleLines, Dataset::Products};
+    if (userRole == "admin") datasets << Dataset::Snapshot;
+    QStringList names;
+    for (Dataset dataset : datasets) names << ReportExporter::datasetName(dataset);
+    const bool inventoryTab = tabWidget->tabText(tabWidget->currentIndex()) == "Inventory Report";
+    bool ok;
+    const QString name = QInputDialog::getItem(this, "Export", "Data:", names, inventoryTab ? 2 : 0, false, &ok);
+    if (!ok) return;
+    const Dataset dataset = datasets[names.indexOf(name)];
+
+    // Sales exports cover the report period or everything
+    QDate from, to;
+    if (dataset == Dataset::Sales || dataset == Dataset::SaleLines) {
+        const QString scope = QInputDialog::getItem(this, "Export", "Rows:", {"Selected period", "All history"}, 0, false, &ok);
+        if (!ok) return;
+        if (scope == "Selected period" && !salesReportRange(from, to)) {
+            QMessageBox::warning(this, "Export", "The start date must not be after the end date.");
+            return;
+        }
+    }
+    QString selectedFilter;
+    QString path;
+    if (dataset == Dataset::Snapshot) {
+        path = QFileDialog::getSaveFileName(this, "Export " + name, QDir::homePath() + "/sales-" + QDate::currentDate().toString("yyyyMMdd") + ".possnap",
+                                            "Sales Snapshot (*.possnap)");
+        if (path.isEmpty()) return;
+        if (QFileInfo(path).suffix().toLower() != "possnap") path += ".possnap";
+    } else {
+        path = QFileDialog::getSaveFileName(this, "Export " + name, QDir::homePath() + "/" + QString(name).remove(' ') + ".xlsx",
+                                            "Excel Workbook (*.xlsx);;CSV Files (*.csv)", &selectedFilter);
+        if (path.isEmpty()) return;
+        const QString suffix = QFileInfo(path).suffix().toLower();
+        if (suffix != "csv" && suffix != "xlsx") path += selectedFilter.startsWith("CSV") ? ".csv" : ".xlsx";
+    }
+
+    const QString cashier = reportCashier();
+    jobRunner->submit(QString("Export %1 to %2").arg(name, QFileInfo(path).fileName()),
+        [=](ReportJobContext& context, QString& message) {
+            return ReportExporter::run(context, dataset, from, to, cashier, path, message);
+        },
+        [this](bool ok, const QString& message) {
+            if (!ok) {
+                QMessageBox::critical(this, "Export", message);
+                return;
+            }
+            QMessageBox::information(this, "Export", message);
+            // Log export
+            logActivity(username, "Export Report", message);
+        });
+}
+
+void ReportsScreen::exportReceipts() {
+    if (receiptExporter->isRunning()) {
+        QMessageBox::information(this, "Export Receipts", "A receipt export is already running.");
+        return;
+    }
+    bool ok;
+    QString format = QInputDialog::getItem(this, "Export Receipts", "Output:", {"Single PDF", "One PDF per sale"}, 0, false, &ok);
+    if (!ok) return;
+    BulkReceiptExporter::Mode mode = format == "Single PDF" ? BulkReceiptExporter::Mode::SinglePdf : BulkReceiptExporter::Mode::DirectoryOfPdfs;
+    QString target = mode == BulkReceiptExporter::Mode::SinglePdf
+        ? QFileDialog::getSaveFileName(this, "Save Receipts", QDir::homePath() + "/receipts.pdf", "PDF Files (*.pdf)")
+        : QFileDialog::getExistingDirectory(this, "Receipts Folder", QDir::homePath());
+    if (target.isEmpty()) return;
+
+    QProgressDialog *progressDlg = new QProgressDialog("Exporting receipts...", "Cancel", 0, 0, this);
+    progressDlg->setWindowTitle("Export Receipts");
+    progressDlg->setAttribute(Qt::WA_DeleteOnClose);
+    progressDlg->setMinimumDuration(0);
+    connect(progressDlg, &QProgressDialog::canceled, receiptExporter, &BulkReceiptExporter::cancel);
+    connect(receiptExporter, &BulkReceiptExporter::progress, progressDlg, [progressDlg](int done, int total) {
+        progressDlg->setMaximum(total);
+        progressDlg->setValue(done);
+    });
+    connect(receiptExporter, &BulkReceiptExporter::finished, progressDlg, [this, progressDlg](bool success, const QString& message) {
+        progressDlg->close();
+        if (success) {
+            QMessageBox::information(this, "Export Receipts", message);
+            logActivity(username, "Export Receipts", message);
+        } else {
+            QMessageBox::warning(this, "Export Receipts", message);
+        }
+    });
+    // End date is inclusive in the UI
+    receiptExporter->start(startDateEdit->date().startOfDay(), endDateEdit->date().addDays(1).startOfDay(), mode, target);
 }
 
 void ReportsScreen::printReport() {
-    QString currentTab = tabWidget->tabText(tabWidget->currentIndex());
-    QMessageBox::information(this, "Print", QString("Printing %1 report...\n\nThis would open the print dialog in a real application.").arg(currentTab));
+    using Report = ReportPrintEngine::Report;
+    const bool inventoryTab = tabWidget->tabText(tabWidget->currentIndex()) == "Inventory Report";
+    Report report = Report::Inventory;
+    QDate from, to;
+    bool ok;
+    if (!inventoryTab) {
+        const QString rows = QInputDialog::getItem(this, "Print", "Rows:", {"One per period", "Every sale"}, 0, false, &ok);
+        if (!ok) return;
+        report = rows == "Every sale" ? Report::SalesDetail : Report::SalesSummary;
+        if (!salesReportRange(from, to)) {
+            QMessageBox::warning(this, "Print", "The start date must not be after the end date.");
+            return;
+        }
+    }
+    const QString output = QInputDialog::getItem(this, "Print", "Output:", {"Printer", "PDF file"}, 0, false, &ok);
+    if (!ok) return;
+
+    // The device is handed to the job, which paints it on a worker thread
+    const QString name = ReportPrintEngine::reportName(report);
+    std::shared_ptr<QPagedPaintDevice> device;
+    QString pdfPath;
+    if (output == "PDF file") {
+        pdfPath = QFileDialog::getSaveFileName(this, "Save " + name, QDir::homePath() + "/" + QString(name).remove(' ') + ".pdf",
+                                               "PDF Files (*.pdf)");
+        if (pdfPath.isEmpty()) return;
+        if (QFileInfo(pdfPath).suffix().toLower() != "pdf") pdfPath += ".pdf";
+        auto writer = std::make_shared<QPdfWriter>(pdfPath);
+        writer->setPageSize(QPageSize(QPageSize::A4));
+        writer->setResolution(300);
+        writer->setTitle(name);
+        device = writer;
+    } else {
+        auto printer = std::make_shared<QPrinter>(QPrinter::HighResolution);
+        printer->setDocName(name);
+        QPrintDialog dialog(printer.get(), this);
+        dialog.setWindowTitle("Print " + name);
+        if (dialog.exec() != QDialog::Accepted) return;
+        device = printer;
+    }
+
+    const QString cashier = reportCashier();
+    jobRunner->submit("Print " + name,
+        [=](ReportJobContext& context, QString& message) {
+            const bool printed = ReportPrintEngine::run(context, report, from, to, cashier, *device, message);
+            if (!printed && !pdfPath.isEmpty()) QFile::remove(pdfPath);
+            return printed;
+        },
+        [this, pdfPath](bool ok, const QString& message) {
+            if (!ok) {
+                QMessageBox::critical(this, "Print", message);
+                return;
+            }
+            if (!pdfPath.isEmpty()) QMessageBox::information(this, "Print", message + "\n\nSaved to " + QDir::toNativeSeparators(pdfPath));
+            logActivity(username, "Print Report", message);
+        });
 }
 
 void ReportsScreen::refreshReports() {
@@ -343,62 +870,176 @@ void ReportsScreen::refreshReports() {
 } 
 
 void ReportsScreen::backupDatabase() {
-    QString fileName = QFileDialog::getSaveFileName(this, "Save Database Backup", QDir::homePath() + "/MonsterDB_backup.sql", "SQL Files (*.sql)");
-    if (fileName.isEmpty()) return;
-
-    // Adjust these as needed for your environment
-    QString pgDumpPath = "pg_dump"; // Assumes pg_dump is in PATH
-    QString dbName = "MonsterDB";
-    QString user = "postgres";
-    QString host = "localhost";
-    QString port = "5432";
-    QString password = "Monsterxd2005@#@#";
-
-    // Set PGPASSWORD env variable for non-interactive password passing
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
-    env.insert("PGPASSWORD", password);
-
-    QStringList args;
-    args << "-h" << host << "-p" << port << "-U" << user << "-F" << "p" << "-f" << fileName << dbName;
-
-    QProcess process;
-    process.setProcessEnvironment(env);
-    process.start(pgDumpPath, args);
-    if (!process.waitForStarted()) {
-        QMessageBox::critical(this, "Backup Failed", "Could not start pg_dump. Make sure PostgreSQL tools are installed and in your PATH.");
+    BackupManager::Options options = BackupManager::options();
+    const QString directory = QFileDialog::getExistingDirectory(this, "Backup Folder", options.directory);
+    if (directory.isEmpty()) return;
+    options.directory = directory;
+    QSettings().setValue("backup/directory", directory);
+    startBackup(options, false, false);
+}
+
+void ReportsScreen::backupIncremental() {
+    startBackup(BackupManager::options(), false, true);
+}
+
+// Runs once a day from backup/nightlyTime onwards, on machines where it is set
+void ReportsScreen::runNightlyBackup() {
+    QSettings settings;
+    const QTime at = QTime::fromString(settings.value("backup/nightlyTime").toString(), "HH:mm");
+    if (!at.isValid() || QTime::currentTime() < at) return;
+    const QDate today = QDate::currentDate();
+    if (nightlyBackupJob != 0 || settings.value("backup/lastNightly").toDate() == today) return;
+    if (nightlyRetryAt.isValid() && QDateTime::currentDateTime() < nightlyRetryAt) return;
+    // backup/lastNightly is only set once the backup succeeds, see startBackup()
+    nightlyBackupJob = startBackup(BackupManager::options(), true, settings.value("backup/nightlyMode", "incremental").toString() != "full");
+}
+
+int ReportsScreen::startBackup(const BackupManager::Options& options, bool nightly, bool incremental) {
+    // pg_dump runs on a job thread; cancelling kills it and removes the partial backup
+    const QString title = nightly ? "Nightly backup" : incremental ? "Incremental backup" : "Backup";
+    return jobRunner->submit(title + " to " + QDir::toNativeSeparators(options.directory),
+        [options, incremental](ReportJobContext& context, QString& message) {
+            return incremental ? IncrementalBackup::run(context, options, message) : BackupManager::run(context, options, message);
+        },
+        [this, nightly, incremental, started = QDate::currentDate()](bool ok, const QString& message) {
+            if (ok && nightly) QSettings().setValue("backup/lastNightly", started);
+            if (ok) {
+                if (!nightly) {
+                    QMessageBox::information(this, "Backup Complete", (incremental ? QString("Incremental backup was written.\n\n")
+                                                                                   : QString("Database backup was created and verified.\n\n")) + message);
+                }
+                // Log backup action
+                logActivity(username, nightly ? "Nightly Backup" : incremental ? "Incremental Backup" : "Backup Database", message);
+            } else {
+                logActivity(username, "Backup Failed", message);
+                if (!nightly) QMessageBox::critical(this, "Backup Failed", message);
+            }
+        });
+}
+
+// Restores a full backup or an incremental chain into a new database, leaving the live one alone
+void ReportsScreen::restoreBackup() {
+    const BackupManager::Options options = BackupManager::options();
+    const QString backup = QFileDialog::getExistingDirectory(this, "Backup to Restore", options.directory);
+    if (backup.isEmpty()) return;
+    const bool chain = IncrementalBackup::isChain(backup);
+    if (!chain && !BackupManager::isVerified(backup)) {
+        QMessageBox::warning(this, "Restore Backup", "That folder is not a verified backup or an incremental backup chain.");
         return;
     }
-    process.waitForFinished(-1);
-    if (process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0) {
-        QMessageBox::information(this, "Backup Complete", "Database backup was created successfully!\n\n" + fileName);
-        // Log backup action
-        logActivity(userRole, "Backup Database", fileName);
-    } else {
-        QString err = process.readAllStandardError();
-        QMessageBox::critical(this, "Backup Failed", "pg_dump failed.\n\n" + err);
-    }
+    bool ok = false;
+    const QString database = QInputDialog::getText(this, "Restore Backup", "Restore into a new database named:", QLineEdit::Normal,
+                                                   "MonsterDB_restored_" + QDate::currentDate().toString("yyyyMMdd"), &ok).trimmed();
+    if (!ok || database.isEmpty()) return;
+    jobRunner->submit("Restore into " + database,
+        [options, backup, database, chain](ReportJobContext& context, QString& message) {
+            return chain ? IncrementalBackup::restore(context, options, backup, database, message)
+                         : BackupManager::restore(context, options, backup, database, message);
+        },
+        [this, database](bool ok, const QString& message) {
+            if (ok) {
+                QMessageBox::information(this, "Restore Complete", message + "\n\nPoint the application at " + database + " to use it.");
+                logActivity(username, "Restore Backup", message);
+            } else {
+                QMessageBox::critical(this, "Restore Failed", message);
+            }
+        });
 }
 
-void ReportsScreen::logActivity(const QString& username, const QString& action, const QString& details) {
-    QSqlQuery q;
-    q.prepare("INSERT INTO activity_log (username, action, details) VALUES (?, ?, ?)");
-    q.addBindValue(username);
-    q.addBindValue(action);
-    q.addBindValue(details);
-    if (!q.exec()) {
-        qDebug() << "Failed to log activity:" << q.lastError().text();
-    }
+void ReportsScreen::logActivity(const QString& username, const QString& action, const QString& details,
+                                const QJsonObject& fields) {
+    ActivityLogger::instance().log(username, action, details, fields);
 }
 
 void ReportsScreen::refreshActivityLog() {
-    activityLogTable->setRowCount(0);
-    QSqlQuery q("SELECT username, action, details, timestamp FROM activity_log ORDER BY timestamp DESC LIMIT 100");
-    int row = 0;
-    while (q.next()) {
-        activityLogTable->insertRow(row);
-        for (int col = 0; col < 4; ++col) {
-            activityLogTable->setItem(row, col, new QTableWidgetItem(q.value(col).toString()));
-        }
+    // The feed only holds what has been written; wait out this terminal's queued entries first
+    QPointer<ReportsScreen> self(this);
+    ActivityLogger::instance().flushThen([self]() {
+        if (self) self->loadActivityLog(false);
+    });
+}
+
+void ReportsScreen::loadMoreActivityLog() {
+    loadActivityLog(true);
+}
+
+// First page for the current filters, or the page after the rows shown
+void ReportsScreen::loadActivityLog(bool more) {
+    if (more && activityLogCursor.isEmpty()) return;
+    ActivityLogQuery::Filter filter;
+    filter.username = logUserEdit->text().trimmed();
+    if (logActionCombo->currentText() != "All Actions") filter.action = logActionCombo->currentText().trimmed();
+    const int days = QList<int>{0, 1, 7, 30}.value(logPeriodCombo->currentIndex());
+    if (days > 0) filter.from = QDate::currentDate().addDays(1 - days).startOfDay();
+    filter.saleId = logSaleEdit->text().toLongLong();
+    filter.product = logProductEdit->text().trimmed();
+    if (more) filter.cursor = activityLogCursor;
+    loadMoreLogBtn->setEnabled(false);
+
+    // Recent entries come from memory; only deeper history needs a job
+    QList<ActivityLogQuery::Row> recent;
+    QString recentCursor;
+    if (ActivityFeed::instance().query(filter, recent, recentCursor)) {
+        showActivityLog(recent, recentCursor, more);
+        return;
+    }
+    auto rows = std::make_shared<QList<ActivityLogQuery::Row>>();
+    auto nextCursor = std::make_shared<QString>();
+    jobRunner->submit("Activity log",
+        [filter, rows, nextCursor](ReportJobContext& context, QString& message) {
+            return ActivityLogQuery::query(context.database(), filter, *rows, *nextCursor, &message);
+        },
+        [this, rows, nextCursor, more](bool ok, const QString& message) {
+            if (!ok) {
+                qDebug() << "Failed to load activity log:" << message;
+                loadMoreLogBtn->setEnabled(more && !activityLogCursor.isEmpty());
+                return;
+            }
+            showActivityLog(*rows, *nextCursor, more);
+        });
+}
+
+void ReportsScreen::showActivityLog(const QList<ActivityLogQuery::Row>& rows, const QString& nextCursor, bool more) {
+    int row = more ? activityLogTable->rowCount() : 0;
+    activityLogTable->setRowCount(row + rows.size());
+    for (const ActivityLogQuery::Row& entry : rows) {
+        const QStringList cells = {entry.username, entry.action, entry.details, entry.timestamp.toString("yyyy-MM-dd hh:mm:ss")};
+        for (int col = 0; col < cells.size(); ++col) activityLogTable->setItem(row, col, new QTableWidgetItem(cells[col]));
         ++row;
     }
-} 
\ No newline at end of file
+    activityLogCursor = nextCursor;
+    loadMoreLogBtn->setEnabled(!activityLogCursor.isEmpty());
+}
+
+int ReportsScreen::jobRow(int id) const {
+    for (int row = 0; row < jobsTable->rowCount(); ++row) {
+        if (jobsTable->item(row, 0)->data(Qt::UserRole).toInt() == id) return row;
+    }
+    return -1;
+}
+
+void ReportsScreen::setJobCell(int id, int column, const QString& text) {
+    const int row = jobRow(id);
+    if (row >= 0) jobsTable->item(row, column)->setText(text);
+}
+
+// Rows are in submission order, so the oldest finished ones go first
+void ReportsScreen::pruneFinishedJobs() {
+    const int keep = qMax(0, QSettings().value("reports/jobHistory", 50).toInt());
+    QList<int> finished;
+    for (int row = 0; row < jobsTable->rowCount(); ++row) {
+        if (jobsTable->item(row, 1)->data(Qt::UserRole).toBool()) finished.append(row);
+    }
+    for (int i = finished.size() - keep - 1; i >= 0; --i) jobsTable->removeRow(finished[i]);
+}
+
+void ReportsScreen::cancelSelectedJobs() {
+    const QModelIndexList rows = jobsTable->selectionModel()->selectedRows();
+    if (rows.isEmpty()) {
+        QMessageBox::information(this, "Jobs", "Select the jobs to cancel first.");
+        return;
+    }
+    for (const QModelIndex& index : rows) {
+        jobRunner->cancel(jobsTable->item(index.row(), 0)->data(Qt::UserRole).toInt());
+    }
+}
@@ -9,15 +9,17 @@
 #include <QDateEdit>
 #include <QFrame>
 #include <QTabWidget>
+#include <QJsonObject>
+#include <QDateTime>
+#include "SalesReportQuery.h"
+#include "SalesColumnStore.h"
+#include "BackupManager.h"
+#include "ActivityLogQuery.h"
 
-struct SalesReport {
-    QString date;
-    double totalSales;
-    int totalOrders;
-    double averageOrderValue;
-    QString topProduct;
-    int topProductQuantity;
-};
+class BulkReceiptExporter;
+class QAction;
+class QLineEdit;
+class ReportJobRunner;
 
 struct InventoryReport {
     QString category;
@@ -33,7 +35,9 @@ public:
     explicit ReportsScreen(QWidget *parent = nullptr);
     void setUserRole(const QString& role);
     void setUsername(const QString& username); // Set current user
-    static void logActivity(const QString& username, const QString& action, const QString& details);
+    // fields go to activity_log.details_json (sale_id, product_id, product, ...)
+    static void logActivity(const QString& username, const QString& action, const QString& details,
+                            const QJsonObject& fields = QJsonObject());
 
 private slots:
     void generateSalesReport();
@@ -42,7 +46,15 @@ private slots:
     void printReport();
     void refreshReports();
     void backupDatabase(); // Slot for backup button
-    void refreshActivityLog(); // Slot for activity log tab
+    void backupIncremental();
+    void runNightlyBackup();
+    void restoreBackup();
+    void refreshActivityLog(); // First page for the activity log filters
+    void loadMoreActivityLog();
+    void exportReceipts(); // Regenerate receipt PDFs for the selected date range
+    void runPivot();
+    void runBasketQuantiles();
+    void cancelSelectedJobs();
 
 private:
     void setupSalesReport();
@@ -50,6 +62,19 @@ private:
     void setupSummaryCards();
     void loadSampleData();
     void updateCashierFilter();
+    void updateSummaryCards(const SalesReport& period);
+    void updateTrending();
+    void showSalesReport(const SalesReport& period);
+    int jobRow(int id) const;
+    void setJobCell(int id, int column, const QString& text);
+    void pruneFinishedJobs(); // Keeps the newest reports/jobHistory finished rows
+    bool salesReportRange(QDate& from, QDate& to) const; // From the period combo or the date edits
+    QString reportCashier() const; // Whose sales the reports cover; empty for everyone
+    void showPivot(const QList<SalesColumnStore::PivotRow>& rows, const QString& status);
+    void pivotFromCache(const QString& note);
+    int startBackup(const BackupManager::Options& options, bool nightly, bool incremental); // Returns the job id
+    void loadActivityLog(bool more);
+    void showActivityLog(const QList<ActivityLogQuery::Row>& rows, const QString& nextCursor, bool more);
     
     QTabWidget *tabWidget;
     
@@ -62,6 +87,8 @@ private:
     QPushButton *generateSalesBtn;
     QPushButton *exportSalesBtn;
     QPushButton *printSalesBtn;
+    QPushButton *exportReceiptsBtn;
+    BulkReceiptExporter *receiptExporter;
     
     // Inventory Report Components
     QTableWidget *inventoryTable;
@@ -70,11 +97,31 @@ private:
     QPushButton *exportInventoryBtn;
     QPushButton *printInventoryBtn;
     
+    // Pivot Components (same period and cashier as the sales report)
+    QComboBox *pivotDimensionCombo;
+    QPushButton *runPivotBtn;
+    QLabel *pivotStatusLabel;
+    QTableWidget *pivotTable;
+
+    // Basket Components
+    QComboBox *basketGroupCombo;
+    QPushButton *runBasketsBtn;
+    QTableWidget *basketsTable;
+    SalesColumnStore *columnStore; // Null unless analytics/columnCache is on
+    bool pivotCacheLoaded = false; // columnStore's first load has finished
+    bool pivotShown = false;       // Re-pivot after each background refresh
+    
+    // Background jobs: reports, the activity log and backups run here
+    ReportJobRunner *jobRunner;
+    QTableWidget *jobsTable;
+    QPushButton *cancelJobBtn;
+    
     // Summary Cards
     QLabel *totalRevenueLabel;
     QLabel *totalOrdersLabel;
     QLabel *averageOrderLabel;
     QLabel *topProductLabel;
+    QLabel *trendingLabel;
     QLabel *lowStockCountLabel;
     QLabel *totalInventoryValueLabel;
     
@@ -83,5 +130,15 @@ private:
     QString userRole;
     QString username; // Current user
     QPushButton *backupBtn; // Backup button
+    QAction *restoreAction;
+    int nightlyBackupJob = 0; // Running nightly backup, or 0
+    QDateTime nightlyRetryAt; // After a failed or cancelled nightly backup, when to try again
     QTableWidget *activityLogTable; // Activity log table
+    QLineEdit *logUserEdit;
+    QComboBox *logActionCombo;
+    QComboBox *logPeriodCombo; // All time, today, last 7 or 30 days
+    QLineEdit *logSaleEdit;
+    QLineEdit *logProductEdit;
+    QPushButton *loadMoreLogBtn;
+    QString activityLogCursor; // Keyset cursor after the last row shown; empty on the last page
 }; 
\ No newline at end of file
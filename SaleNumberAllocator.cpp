@@ -0,0 +1,166 @@
+#include "SaleNumberAllocator.h"
+#include <QSettings>
+#include <QSysInfo>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QMutexLocker>
+#include <QDebug>
+
+SaleNumberAllocator& SaleNumberAllocator::instance() {
+    static SaleNumberAllocator allocator;
+    return allocator;
+}
+
+SaleNumberAllocator::SaleNumberAllocator() {
+    load();
+    if (QSqlDatabase::database().isOpen()) {
+        fastForwardFromDatabase();
+    }
+}
+
+QString SaleNumberAllocator::terminalId() {
+    QSettings settings;
+    QString id = settings.value("terminal/id").toString();
+    if (id.isEmpty()) {
+        id = QSysInfo::machineHostName();
+        if (id.isEmpty()) id = "terminal";
+        settings.setValue("terminal/id", id);
+    }
+    return id;
+}
+
+int SaleNumberAllocator::nextSaleId() {
+    QMutexLocker locker(&mutex);
+    while (!blocks.isEmpty() && blocks.first().next >= blocks.first().end()) {
+        blocks.removeFirst();
+    }
+    if (blocks.isEmpty() && !reserveBlock()) {
+        return -1;
+    }
+    int id = blocks.first().next++;
+    save();
+    return id;
+}
+
+int SaleNumberAllocator::remaining() const {
+    QMutexLocker locker(&mutex);
+    int count = 0;
+    for (const Block& block : blocks) count += block.end() - block.next;
+    return count;
+}
+
+void SaleNumberAllocator::topUp() {
+    QMutexLocker locker(&mutex);
+    int usable = 0;
+    for (const Block& block : blocks) {
+        if (block.next < block.end()) usable++;
+    }
+    while (usable < reserveBlocks && reserveBlock()) {
+        usable++;
+    }
+}
+
+void SaleNumberAllocator::recordUsage(bool release) {
+    QMutexLocker locker(&mutex);
+    if (blocks.isEmpty()) return;
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen() || !db.transaction()) return; // Keep the blocks locally and reuse them next run
+    QSqlQuery q;
+    q.prepare(release
+        ? "UPDATE sale_id_blocks SET next_unused = ?, released_at = NOW() WHERE block_start = ? AND terminal_id = ?"
+        : "UPDATE sale_id_blocks SET next_unused = ? WHERE block_start = ? AND terminal_id = ?");
+    for (const Block& block : blocks) {
+        q.addBindValue(block.next);
+        q.addBindValue(block.start);
+        q.addBindValue(terminalId());
+        if (!q.exec()) {
+            qDebug() << "Failed to record sale ID block" << block.start << ":" << q.lastError().text();
+            db.rollback();
+            return;
+        }
+    }
+    db.commit();
+    if (release) {
+        blocks.clear();
+        save();
+    }
+}
+
+bool SaleNumberAllocator::reserveBlock() {
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen()) return false;
+
+    // Prefer the unused tail of a block another terminal handed back on shutdown
+    QSqlQuery claim;
+    claim.prepare("UPDATE sale_id_blocks SET terminal_id = ?, released_at = NULL "
+                  "WHERE block_start = (SELECT block_start FROM sale_id_blocks "
+                  "WHERE released_at IS NOT NULL AND next_unused < block_start + block_size "
+                  "ORDER BY block_start LIMIT 1 FOR UPDATE SKIP LOCKED) "
+                  "RETURNING block_start, block_size, next_unused");
+    claim.addBindValue(terminalId());
+    if (!claim.exec() || !claim.next()) {
+        claim.prepare("INSERT INTO sale_id_blocks (block_start, block_size, terminal_id, next_unused) "
+                      "SELECT v.start, v.size, ?, v.start FROM "
+                      "(SELECT nextval('sales_id_seq') AS start, increment_by AS size FROM pg_sequences "
+                      "WHERE schemaname = current_schema() AND sequencename = 'sales_id_seq') v "
+                      "RETURNING block_start, block_size, next_unused");
+        claim.addBindValue(terminalId());
+        if (!claim.exec() || !claim.next()) {
+            qDebug() << "Failed to reserve sale ID block:" << claim.lastError().text();
+            return false;
+        }
+    }
+    Block block;
+    block.start = claim.value(0).toInt();
+    block.size = claim.value(1).toInt();
+    block.next = claim.value(2).toInt();
+    blocks.append(block);
+    save();
+    return true;
+}
+
+void SaleNumberAllocator::fastForwardFromDatabase() {
+    // Settings are written lazily; if we crashed after a sale was committed but before
+    // the counter was flushed, skip past any IDs already present in sales.
+    QMutexLocker locker(&mutex);
+    QSqlQuery q;
+    q.prepare("SELECT MAX(id) FROM sales WHERE id >= ? AND id < ?");
+    bool changed = false;
+    for (Block& block : blocks) {
+        q.addBindValue(block.next);
+        q.addBindValue(block.end());
+        if (q.exec() && q.next() && !q.value(0).isNull()) {
+            block.next = q.value(0).toInt() + 1;
+            changed = true;
+        }
+    }
+    if (changed) save();
+}
+
+void SaleNumberAllocator::load() {
+    QSettings settings;
+    int count = settings.beginReadArray("saleIdBlocks");
+    for (int i = 0; i < count; ++i) {
+        settings.setArrayIndex(i);
+        Block block;
+        block.start = settings.value("start").toInt();
+        block.size = settings.value("size").toInt();
+        block.next = settings.value("next").toInt();
+        if (block.next < block.end()) blocks.append(block);
+    }
+    settings.endArray();
+}
+
+void SaleNumberAllocator::save() const {
+    QSettings settings;
+    settings.beginWriteArray("saleIdBlocks", blocks.size());
+    for (int i = 0; i < blocks.size(); ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("start", blocks[i].start);
+        settings.setValue("size", blocks[i].size);
+        settings.setValue("next", blocks[i].next);
+    }
+    settings.endArray();
+}
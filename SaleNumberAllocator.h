@@ -0,0 +1,39 @@
+#pragma once
+#include <QString>
+#include <QList>
+#include <QMutex>
+
+// Hands out sale IDs from blocks reserved ahead of time, so a sale can be
+// numbered (and its Bill built) without waiting on the database. Blocks come
+// from sales_id_seq, whose INCREMENT BY is the block size, so two terminals
+// can never be handed overlapping ranges. Held blocks are kept in QSettings
+// and survive restarts and offline periods.
+class SaleNumberAllocator {
+public:
+    static SaleNumberAllocator& instance();
+    static QString terminalId(); // Stable per-machine terminal name
+
+    int nextSaleId();        // -1 if every reserved block is used up
+    int remaining() const;   // IDs left across all held blocks
+    void topUp();            // Reserve blocks until the offline reserve is full
+    // Record how far each held block got. With release=true the unused tails are
+    // handed back for other terminals to claim; otherwise they stay reserved here.
+    void recordUsage(bool release);
+
+private:
+    SaleNumberAllocator();
+    struct Block {
+        int start;
+        int size;
+        int next;
+        int end() const { return start + size; }
+    };
+    bool reserveBlock();
+    void fastForwardFromDatabase();
+    void load();
+    void save() const;
+
+    QList<Block> blocks;
+    mutable QMutex mutex;
+    static const int reserveBlocks = 2;
+};
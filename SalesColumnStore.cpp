@@ -0,0 +1,400 @@
+#include "SalesColumnStore.h"
+#include "DbConnection.h"
+#include "PgCopy.h"
+#include <QtConcurrent>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QSettings>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QVariant>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Rows handled per kernel step; small enough that the scratch arrays stay in L1
+static const int blockRows = 1024;
+// Below this many lines per thread the pivot is not worth splitting
+static const size_t minChunkRows = 256 * 1024;
+
+static int32_t minuteOf(const QDate& date) {
+    // sale_time is a wall-clock TIMESTAMP, so read it as if it were UTC
+    return int32_t(date.startOfDay(Qt::UTC).toSecsSinceEpoch() / 60);
+}
+
+// mask[i] = -1 where lo <= t[i] < hi, else 0
+static void rangeMask(const int32_t* t, int n, int32_t lo, int32_t hi, int32_t* mask) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i below = _mm_set1_epi32(lo - 1);
+    const __m128i above = _mm_set1_epi32(hi);
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t + i));
+        const __m128i m = _mm_and_si128(_mm_cmpgt_epi32(v, below), _mm_cmplt_epi32(v, above));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mask + i), m);
+    }
+#endif
+    for (; i < n; ++i) mask[i] = -int32_t(t[i] >= lo && t[i] < hi);
+}
+
+namespace {
+struct Columns {
+    const int32_t* minutes;
+    const uint32_t* products;
+    const uint16_t* cashiers;
+    const uint8_t* payments;
+    const int32_t* quantities;
+    const int32_t* cents;
+    const uint16_t* productCategories;
+};
+
+struct Partial {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<int64_t> cents, quantity, lines; // Indexed by group key
+};
+}
+
+// The pivot kernel over one contiguous range: mask, key, then masked accumulate.
+// Nothing in the inner loops branches on the data.
+static void aggregate(const Columns& c, SalesColumnStore::Dimension dimension, int32_t lo, int32_t hi,
+                      int cashierCode, Partial& out) {
+    alignas(16) int32_t mask[blockRows];
+    uint32_t keys[blockRows];
+    for (size_t b = out.begin; b < out.end; b += blockRows) {
+        const int n = int(std::min<size_t>(blockRows, out.end - b));
+        rangeMask(c.minutes + b, n, lo, hi, mask);
+        if (cashierCode >= 0) {
+            for (int i = 0; i < n; ++i) mask[i] &= -int32_t(c.cashiers[b + i] == cashierCode);
+        }
+        int32_t any = 0;
+        for (int i = 0; i < n; ++i) any |= mask[i];
+        if (!any) continue; // Lines arrive roughly in time order, so whole blocks fall outside the range
+
+        switch (dimension) {
+        case SalesColumnStore::Category:
+            for (int i = 0; i < n; ++i) keys[i] = c.productCategories[c.products[b + i]];
+            break;
+        case SalesColumnStore::Product:
+            for (int i = 0; i < n; ++i) keys[i] = c.products[b + i];
+            break;
+        case SalesColumnStore::HourOfDay:
+            for (int i = 0; i < n; ++i) keys[i] = uint32_t(c.minutes[b + i] % 1440 / 60);
+            break;
+        case SalesColumnStore::Weekday: // 1970-01-01 was a Thursday; Monday is 0
+            for (int i = 0; i < n; ++i) keys[i] = uint32_t((c.minutes[b + i] / 1440 + 3) % 7);
+            break;
+        case SalesColumnStore::Cashier:
+            for (int i = 0; i < n; ++i) keys[i] = c.cashiers[b + i];
+            break;
+        case SalesColumnStore::PaymentMethod:
+            for (int i = 0; i < n; ++i) keys[i] = c.payments[b + i];
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            const uint32_t k = keys[i];
+            out.cents[k] += c.cents[b + i] & mask[i];
+            out.quantity[k] += c.quantities[b + i] & mask[i];
+            out.lines[k] += mask[i] & 1;
+        }
+    }
+}
+
+uint32_t SalesColumnStore::Dictionary::intern(const QString& value) {
+    auto it = codes.constFind(value);
+    if (it != codes.constEnd()) return it.value();
+    const uint32_t code = uint32_t(values.size());
+    values.append(value);
+    codes.insert(value, code);
+    return code;
+}
+
+SalesColumnStore::SalesColumnStore(QObject *parent) : QObject(parent) {
+}
+
+SalesColumnStore::~SalesColumnStore() {
+    future.waitForFinished();
+}
+
+bool SalesColumnStore::isEnabled() {
+    return QSettings().value("analytics/columnCache", false).toBool();
+}
+
+QString SalesColumnStore::dimensionName(Dimension dimension) {
+    switch (dimension) {
+    case Category: return "Category";
+    case Product: return "Product";
+    case HourOfDay: return "Hour of Day";
+    case Weekday: return "Weekday";
+    case Cashier: return "Cashier";
+    case PaymentMethod: return "Payment Method";
+    }
+    return QString();
+}
+
+void SalesColumnStore::refresh() {
+    if (isRunning()) return;
+    future = QtConcurrent::run([this]() { load(false); });
+}
+
+void SalesColumnStore::reload() {
+    if (isRunning()) return;
+    future = QtConcurrent::run([this]() { load(true); });
+}
+
+bool SalesColumnStore::isRunning() const {
+    return future.isRunning();
+}
+
+qint64 SalesColumnStore::lineCount() const {
+    QReadLocker locker(&lock);
+    return qint64(itemIds.size());
+}
+
+void SalesColumnStore::load(bool full) {
+    QElapsedTimer timer;
+    timer.start();
+
+    // Work on copies of the dictionaries; pivots keep reading the live ones meanwhile
+    Dictionary productDict, categoryDict, cashierDict, paymentDict;
+    std::vector<uint16_t> categoryOfProduct;
+    QDateTime changedAt;
+    int32_t after = 0;
+    if (!full) {
+        QReadLocker locker(&lock);
+        productDict = productNames;
+        categoryDict = categoryNames;
+        cashierDict = cashierNames;
+        paymentDict = paymentNames;
+        categoryOfProduct = productCategories;
+        changedAt = productsChangedAt;
+        if (!itemIds.empty()) after = std::max(0, itemIds.back() - reloadMargin);
+    }
+    categoryDict.intern(QString()); // Code 0: uncategorised
+
+    ScopedDbConnection connection("column-store");
+    if (!connection.isOpen()) {
+        emit refreshed(false, "Database error: " + connection.lastError());
+        return;
+    }
+    QSqlDatabase db = connection.database();
+
+    {
+        // Every product the first time, then only those renamed, recategorised or added since
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare("SELECT name, COALESCE(category, ''), changed_at FROM products WHERE changed_at >= ?");
+        query.addBindValue(changedAt.isNull() ? QDateTime(QDate(1970, 1, 1), QTime(0, 0))
+                                              : changedAt.addSecs(-productChangeMarginSeconds));
+        if (!query.exec()) {
+            emit refreshed(false, "Database error: " + query.lastError().text());
+            return;
+        }
+        while (query.next()) {
+            const uint32_t product = productDict.intern(query.value(0).toString());
+            const uint32_t category = categoryDict.intern(query.value(1).toString());
+            if (product >= categoryOfProduct.size()) categoryOfProduct.resize(product + 1, 0);
+            categoryOfProduct[product] = uint16_t(category);
+            const QDateTime changed = query.value(2).toDateTime();
+            if (changedAt.isNull() || changed > changedAt) changedAt = changed;
+        }
+        if (categoryDict.values.size() > 0xFFFF) {
+            emit refreshed(false, "Too many categories for the analytics cache.");
+            return;
+        }
+    }
+
+    std::vector<int32_t> newIds, newMinutes, newQuantities, newCents;
+    std::vector<uint32_t> newProducts;
+    std::vector<uint16_t> newCashiers;
+    std::vector<uint8_t> newPayments;
+    QString error;
+    PgCopy copy(db);
+    if (!copy.isValid()) {
+        emit refreshed(false, "Database error: " + copy.lastError());
+        return;
+    }
+    const QString copySql = QString("COPY (SELECT si.id, floor(extract(epoch FROM s.sale_time) / 60)::integer, si.quantity, "
+                                    "round(si.quantity * si.price * 100)::integer, COALESCE(si.product_name, ''), "
+                                    "COALESCE(s.cashier, ''), s.payment_method "
+                                    "FROM sales_items si JOIN sales s ON s.id = si.sale_id "
+                                    "WHERE si.id > %1 ORDER BY si.id) TO STDOUT").arg(after);
+    QByteArray text;
+    const bool copied = copy.copyOut(copySql, [&](const char* data, int size) {
+        const char* p = data;
+        const char* end = data + size;
+        int id, minute, quantity, amount;
+        if (!PgCopy::readIntField(p, end, id) || !PgCopy::readIntField(p, end, minute) || !PgCopy::readIntField(p, end, quantity)
+            || !PgCopy::readIntField(p, end, amount)) {
+            return true; // Malformed row; skip it
+        }
+        PgCopy::readTextField(p, end, text);
+        const uint32_t product = productDict.intern(QString::fromUtf8(text));
+        PgCopy::readTextField(p, end, text);
+        const uint32_t cashier = cashierDict.intern(QString::fromUtf8(text));
+        PgCopy::readTextField(p, end, text);
+        const uint32_t payment = paymentDict.intern(QString::fromUtf8(text));
+        if (cashier > 0xFFFF || payment > 0xFF) {
+            error = "Too many distinct cashiers or payment methods for the analytics cache.";
+            return false;
+        }
+        newIds.push_back(id);
+        newMinutes.push_back(minute);
+        newQuantities.push_back(quantity);
+        newCents.push_back(amount);
+        newProducts.push_back(product);
+        newCashiers.push_back(uint16_t(cashier));
+        newPayments.push_back(uint8_t(payment));
+        return true;
+    });
+    if (!error.isEmpty() || !copied) {
+        emit refreshed(false, "Failed to load sales: " + (error.isEmpty() ? copy.lastError() : error));
+        return;
+    }
+    // Products only seen in sales (since renamed or removed) are uncategorised
+    categoryOfProduct.resize(productDict.values.size(), 0);
+
+    qint64 total;
+    {
+        QWriteLocker locker(&lock);
+        // Drop the re-read tail before appending it again
+        const size_t keep = full ? 0 : size_t(std::upper_bound(itemIds.begin(), itemIds.end(), after) - itemIds.begin());
+        auto replaceTail = [keep](auto& column, auto& fresh) {
+            column.resize(keep);
+            column.insert(column.end(), fresh.begin(), fresh.end());
+        };
+        replaceTail(itemIds, newIds);
+        replaceTail(minutes, newMinutes);
+        replaceTail(products, newProducts);
+        replaceTail(cashiers, newCashiers);
+        replaceTail(payments, newPayments);
+        replaceTail(quantities, newQuantities);
+        replaceTail(cents, newCents);
+        productCategories.swap(categoryOfProduct);
+        productsChangedAt = changedAt;
+        productNames = productDict;
+        categoryNames = categoryDict;
+        cashierNames = cashierDict;
+        paymentNames = paymentDict;
+        total = qint64(itemIds.size());
+    }
+    emit refreshed(true, QString("%1 sale lines cached (%2 read) in %3 ms")
+                             .arg(total).arg(newIds.size()).arg(timer.elapsed()));
+}
+
+QString SalesColumnStore::label(Dimension dimension, uint32_t key, const QStringList& names) {
+    switch (dimension) {
+    case HourOfDay: return QString("%1:00").arg(key, 2, 10, QChar('0'));
+    case Weekday: return QLocale().dayName(int(key) + 1);
+    default: {
+        const QString name = names.value(int(key));
+        return name.isEmpty() ? QString("(none)") : name;
+    }
+    }
+}
+
+void SalesColumnStore::sortRows(Dimension dimension, QList<PivotRow>& rows) {
+    // Hours and weekdays already come in key order
+    if (dimension == HourOfDay || dimension == Weekday) return;
+    std::stable_sort(rows.begin(), rows.end(), [](const PivotRow& a, const PivotRow& b) {
+        return a.revenueCents > b.revenueCents;
+    });
+}
+
+QList<SalesColumnStore::PivotRow> SalesColumnStore::pivot(Dimension dimension, const QDate& from, const QDate& to,
+                                                          const QString& cashier) const {
+    QList<PivotRow> rows;
+    QReadLocker locker(&lock);
+    const size_t lines = itemIds.size();
+    if (lines == 0) return rows;
+    int cashierCode = -1;
+    if (!cashier.isEmpty()) {
+        auto it = cashierNames.codes.constFind(cashier);
+        if (it == cashierNames.codes.constEnd()) return rows; // No sales by this cashier
+        cashierCode = int(it.value());
+    }
+
+    const QStringList* names = nullptr;
+    size_t groups = 0;
+    switch (dimension) {
+    case Category: names = &categoryNames.values; break;
+    case Product: names = &productNames.values; break;
+    case Cashier: names = &cashierNames.values; break;
+    case PaymentMethod: names = &paymentNames.values; break;
+    case HourOfDay: groups = 24; break;
+    case Weekday: groups = 7; break;
+    }
+    if (names) groups = size_t(names->size());
+
+    const Columns columns{minutes.data(), products.data(), cashiers.data(), payments.data(),
+                          quantities.data(), cents.data(), productCategories.data()};
+    const size_t chunks = std::max<size_t>(1, std::min<size_t>(size_t(QThread::idealThreadCount()), lines / minChunkRows));
+    std::vector<Partial> partials(chunks);
+    for (size_t i = 0; i < chunks; ++i) {
+        partials[i].begin = lines * i / chunks;
+        partials[i].end = lines * (i + 1) / chunks;
+        partials[i].cents.assign(groups, 0);
+        partials[i].quantity.assign(groups, 0);
+        partials[i].lines.assign(groups, 0);
+    }
+    const int32_t lo = minuteOf(from);
+    const int32_t hi = minuteOf(to.addDays(1));
+    QtConcurrent::blockingMap(partials, [&](Partial& part) { aggregate(columns, dimension, lo, hi, cashierCode, part); });
+
+    for (size_t k = 0; k < groups; ++k) {
+        PivotRow row;
+        for (const Partial& part : partials) {
+            row.revenueCents += part.cents[k];
+            row.quantity += part.quantity[k];
+            row.lines += part.lines[k];
+        }
+        if (row.lines == 0) continue;
+        row.label = label(dimension, uint32_t(k), names ? *names : QStringList());
+        rows.append(row);
+    }
+    sortRows(dimension, rows);
+    return rows;
+}
+
+bool SalesColumnStore::pivotFromDatabase(const QSqlDatabase& db, Dimension dimension, const QDate& from, const QDate& to,
+                                         const QString& cashier, QList<PivotRow>& rows, QString* error) {
+    rows.clear();
+    QString key;
+    switch (dimension) {
+    case Category: key = "COALESCE(p.category, '')"; break;
+    case Product: key = "COALESCE(si.product_name, '')"; break;
+    case HourOfDay: key = "extract(hour FROM s.sale_time)::integer"; break;
+    case Weekday: key = "(extract(isodow FROM s.sale_time)::integer - 1)"; break;
+    case Cashier: key = "COALESCE(s.cashier, '')"; break;
+    case PaymentMethod: key = "s.payment_method"; break;
+    }
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(QString("SELECT %1, SUM(round(si.quantity * si.price * 100))::bigint, SUM(si.quantity), COUNT(*) "
+                          "FROM sales_items si JOIN sales s ON s.id = si.sale_id "
+                          "LEFT JOIN products p ON p.name = si.product_name "
+                          "WHERE s.sale_time >= ? AND s.sale_time < ? AND (? = '' OR s.cashier = ?) "
+                          "GROUP BY 1 ORDER BY 1").arg(key));
+    query.addBindValue(from.startOfDay());
+    query.addBindValue(to.addDays(1).startOfDay());
+    query.addBindValue(cashier);
+    query.addBindValue(cashier);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    const bool numericKey = dimension == HourOfDay || dimension == Weekday;
+    while (query.next()) {
+        PivotRow row;
+        row.label = numericKey ? label(dimension, query.value(0).toUInt(), QStringList())
+                               : label(dimension, 0, QStringList{query.value(0).toString()});
+        row.revenueCents = query.value(1).toLongLong();
+        row.quantity = query.value(2).toLongLong();
+        row.lines = query.value(3).toLongLong();
+        rows.append(row);
+    }
+    sortRows(dimension, rows);
+    return true;
+}
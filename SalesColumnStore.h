@@ -0,0 +1,91 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QDate>
+#include <QDateTime>
+#include <QFuture>
+#include <QReadWriteLock>
+#include <QSqlDatabase>
+#include <cstdint>
+#include <vector>
+
+// Optional in-process copy of sales_items joined to sales, kept column by
+// column (struct of arrays) for the Pivot tab on the Reports screen. Names are
+// dictionary-encoded, amounts are integer cents and sale time is minutes since
+// the epoch, about 23 bytes per sale line. Pivots filter and group in blocks
+// with branch-free kernels spread over the thread pool, so tens of millions of
+// lines take milliseconds instead of a round trip per click.
+//
+// refresh() loads incrementally past the highest sale line id already held.
+// The last reloadMargin ids are re-read each time to pick up lines committed
+// out of id order; deleted sales are only dropped by a full reload(). Product
+// categories are re-read only for products whose changed_at moved (see
+// product_changes_setup.sql); a renamed product's old name keeps its last
+// category until the next reload(). Pivots never wait on a refresh: the
+// Reports screen refreshes on a timer and pivots whatever is resident.
+//
+// Enabled by the analytics/columnCache setting (off by default). Without it
+// the Pivot tab runs the same grouping in PostgreSQL via pivotFromDatabase().
+class SalesColumnStore : public QObject {
+    Q_OBJECT
+public:
+    enum Dimension { Category, Product, HourOfDay, Weekday, Cashier, PaymentMethod };
+    struct PivotRow {
+        QString label;
+        qint64 revenueCents = 0;
+        qint64 quantity = 0;
+        qint64 lines = 0;
+    };
+    static constexpr int reloadMargin = 10000;
+    // Product changes committed this long after they were stamped are still picked up
+    static constexpr int productChangeMarginSeconds = 300;
+
+    explicit SalesColumnStore(QObject *parent = nullptr);
+    ~SalesColumnStore();
+
+    static bool isEnabled();
+    static QString dimensionName(Dimension dimension);
+
+    void refresh(); // Background; emits refreshed()
+    void reload();  // Drops everything and loads from scratch
+    bool isRunning() const;
+    qint64 lineCount() const;
+
+    // from and to are inclusive. An empty cashier means all cashiers.
+    // Rows come back by revenue, or in clock/calendar order for hours and weekdays.
+    QList<PivotRow> pivot(Dimension dimension, const QDate& from, const QDate& to, const QString& cashier) const;
+    static bool pivotFromDatabase(const QSqlDatabase& db, Dimension dimension, const QDate& from, const QDate& to,
+                                  const QString& cashier, QList<PivotRow>& rows, QString* error = nullptr);
+
+signals:
+    void refreshed(bool ok, const QString& message);
+
+private:
+    struct Dictionary {
+        QStringList values;
+        QHash<QString, uint32_t> codes;
+        uint32_t intern(const QString& value);
+    };
+    void load(bool full);
+    static QString label(Dimension dimension, uint32_t key, const QStringList& names);
+    static void sortRows(Dimension dimension, QList<PivotRow>& rows);
+
+    mutable QReadWriteLock lock;
+    // One entry per sale line, ascending by sales_items.id
+    std::vector<int32_t> itemIds;
+    std::vector<int32_t> minutes;    // sale_time as wall-clock minutes since 1970-01-01
+    std::vector<uint32_t> products;
+    std::vector<uint16_t> cashiers;
+    std::vector<uint8_t> payments;
+    std::vector<int32_t> quantities;
+    std::vector<int32_t> cents;      // quantity * price
+    // Per product code; products changed since productsChangedAt are re-read on each load
+    std::vector<uint16_t> productCategories;
+    QDateTime productsChangedAt; // Newest products.changed_at seen; null until the first load
+    Dictionary productNames, categoryNames, cashierNames, paymentNames;
+
+    QFuture<void> future;
+};
@@ -0,0 +1,96 @@
+#include "SalesReportQuery.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDateTime>
+
+SalesReportQuery::Bucket SalesReportQuery::bucketFor(const QDate& from, const QDate& to) {
+    if (from == to) return Bucket::Hour;
+    const qint64 days = from.daysTo(to);
+    if (days <= 31) return Bucket::Day;
+    return days <= 183 ? Bucket::Week : Bucket::Month;
+}
+
+static QString bucketUnit(SalesReportQuery::Bucket bucket) {
+    switch (bucket) {
+    case SalesReportQuery::Bucket::Hour: return "hour";
+    case SalesReportQuery::Bucket::Week: return "week";
+    case SalesReportQuery::Bucket::Month: return "month";
+    default: return "day";
+    }
+}
+
+static QString bucketLabel(const QDateTime& start, SalesReportQuery::Bucket bucket) {
+    switch (bucket) {
+    case SalesReportQuery::Bucket::Hour: return start.toString("yyyy-MM-dd hh:00");
+    case SalesReportQuery::Bucket::Week: return "Week of " + start.toString("yyyy-MM-dd");
+    case SalesReportQuery::Bucket::Month: return start.toString("MMMM yyyy");
+    default: return start.toString("yyyy-MM-dd");
+    }
+}
+
+bool SalesReportQuery::run(const QSqlDatabase& db, const QDate& from, const QDate& to, const QString& cashier, Bucket bucket,
+                           QList<SalesReport>& rows, SalesReport& period, QString* error) {
+    // Only the hourly report needs the hourly rollups; everything else regroups days
+    const bool hourly = bucket == Bucket::Hour;
+    const QString cashierFilter = cashier.isEmpty() ? QString() : QString(" AND cashier = ?");
+    // Grouping sets give one row per bucket plus a period row with a NULL bucket
+    const QString sql = QString(
+        "WITH sales_rows AS ("
+        "  SELECT date_trunc('%1', bucket::timestamp) AS bucket, total, orders FROM %2"
+        "  WHERE bucket >= ? AND bucket < ?%4), "
+        "product_rows AS ("
+        "  SELECT date_trunc('%1', bucket::timestamp) AS bucket, product_name, quantity FROM %3"
+        "  WHERE bucket >= ? AND bucket < ?%4), "
+        "buckets AS ("
+        "  SELECT bucket, SUM(total) AS total_sales, SUM(orders) AS orders FROM sales_rows"
+        "  GROUP BY GROUPING SETS ((bucket), ())), "
+        "top_products AS ("
+        "  SELECT bucket, product_name, SUM(quantity) AS quantity,"
+        "         ROW_NUMBER() OVER (PARTITION BY bucket ORDER BY SUM(quantity) DESC, product_name) AS rank"
+        "  FROM product_rows GROUP BY GROUPING SETS ((bucket, product_name), (product_name))) "
+        "SELECT b.bucket, b.total_sales::float8, b.orders, p.product_name, p.quantity "
+        "FROM buckets b LEFT JOIN top_products p ON p.bucket IS NOT DISTINCT FROM b.bucket AND p.rank = 1 "
+        "ORDER BY b.bucket NULLS FIRST")
+        .arg(bucketUnit(bucket),
+             hourly ? "sales_rollup_hourly" : "sales_rollup_daily",
+             hourly ? "product_rollup_hourly" : "product_rollup_daily",
+             cashierFilter);
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare(sql);
+    for (int i = 0; i < 2; ++i) {
+        if (hourly) {
+            query.addBindValue(from.startOfDay());
+            query.addBindValue(to.addDays(1).startOfDay());
+        } else {
+            query.addBindValue(from);
+            query.addBindValue(to.addDays(1));
+        }
+        if (!cashier.isEmpty()) query.addBindValue(cashier);
+    }
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+
+    rows.clear();
+    period = SalesReport{QString(), 0.0, 0, 0.0, QString(), 0};
+    while (query.next()) {
+        SalesReport report;
+        report.totalSales = query.value(1).toDouble();
+        report.totalOrders = query.value(2).toInt();
+        report.averageOrderValue = report.totalOrders > 0 ? report.totalSales / report.totalOrders : 0.0;
+        report.topProduct = query.value(3).toString();
+        report.topProductQuantity = query.value(4).toInt();
+        if (query.value(0).isNull()) {
+            report.date = "Total";
+            period = report;
+        } else {
+            report.date = bucketLabel(query.value(0).toDateTime(), bucket);
+            rows.append(report);
+        }
+    }
+    return true;
+}
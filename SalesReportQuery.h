@@ -0,0 +1,31 @@
+#pragma once
+#include <QString>
+#include <QDate>
+#include <QList>
+#include <QSqlDatabase>
+
+struct SalesReport {
+    QString date;
+    double totalSales;
+    int totalOrders;
+    double averageOrderValue;
+    QString topProduct;
+    int topProductQuantity;
+};
+
+// Builds the Sales Report in the database from the sales rollups (see
+// SalesRollup): the hourly or daily rollup rows are regrouped into report
+// buckets and each bucket's top product is picked with a window function, all
+// in one grouped query. The same query also returns the whole period's totals.
+// Cost follows the number of rollup rows in the range, not the number of sales.
+class SalesReportQuery {
+public:
+    enum class Bucket { Hour, Day, Week, Month };
+    // Hours for one day, days up to a month, (Monday-based) weeks up to half a year, then months
+    static Bucket bucketFor(const QDate& from, const QDate& to);
+
+    // from and to are inclusive. An empty cashier means all cashiers.
+    // Returns false on a database error.
+    static bool run(const QSqlDatabase& db, const QDate& from, const QDate& to, const QString& cashier, Bucket bucket,
+                    QList<SalesReport>& rows, SalesReport& period, QString* error = nullptr);
+};
@@ -0,0 +1,67 @@
+#include "SalesRollup.h"
+#include "DbConnection.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+
+// Sales rolled up per catch-up transaction
+static const int catchUpBatchSize = 5000;
+
+bool SalesRollup::rollupSale(int saleId, QString* error) {
+    QSqlQuery query;
+    query.prepare("SELECT rollup_sales(ARRAY[?]::integer[])");
+    query.addBindValue(saleId);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void SalesRollup::catchUp() {
+    ScopedDbConnection connection("sales-rollup");
+    if (!connection.isOpen()) {
+        qDebug() << "Sales rollup catch-up: no connection:" << connection.lastError();
+        return;
+    }
+    QSqlQuery query(connection.database());
+    if (!query.exec("SELECT COALESCE(MAX(ingest_seq), 0) FROM sales WHERE NOT rolled_up") || !query.next()) {
+        qDebug() << "Sales rollup catch-up failed:" << query.lastError().text();
+        return;
+    }
+    const qlonglong highWater = query.value(0).toLongLong();
+    if (highWater == 0) return;
+    // Each batch commits on its own, so a long backlog never holds locks for long
+    int total = 0;
+    query.prepare("SELECT rollup_pending_sales(?, ?)");
+    while (true) {
+        query.addBindValue(highWater);
+        query.addBindValue(catchUpBatchSize);
+        if (!query.exec() || !query.next()) {
+            qDebug() << "Sales rollup catch-up failed:" << query.lastError().text();
+            break;
+        }
+        const int rolled = query.value(0).toInt();
+        if (rolled == 0) break;
+        total += rolled;
+    }
+    if (total > 0) qDebug() << "Rolled up" << total << "sales";
+}
+
+bool SalesRollup::totals(Totals& totals, QString* error) {
+    QSqlQuery query;
+    if (!query.exec("SELECT COALESCE(SUM(total), 0)::float8, COALESCE(SUM(orders), 0), "
+                    "COALESCE(SUM(total) FILTER (WHERE bucket = CURRENT_DATE), 0)::float8, "
+                    "COALESCE(SUM(orders) FILTER (WHERE bucket = CURRENT_DATE), 0) "
+                    "FROM sales_rollup_daily")
+        || !query.next()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    totals.allSales = query.value(0).toDouble();
+    totals.allOrders = query.value(1).toInt();
+    totals.todaySales = query.value(2).toDouble();
+    totals.todayOrders = query.value(3).toInt();
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <QString>
+
+// Keeps the hourly/daily sales rollup tables current. Sales rung up here are
+// rolled up inside their own transaction; sales inserted any other way are
+// picked up by catchUp(), which works through pending sales in ingest order
+// up to the high-water mark taken when it starts.
+class SalesRollup {
+public:
+    struct Totals {
+        double allSales = 0.0;
+        int allOrders = 0;
+        double todaySales = 0.0;
+        int todayOrders = 0;
+    };
+
+    // Default connection; joins the caller's transaction
+    static bool rollupSale(int saleId, QString* error = nullptr);
+    // Opens its own connection, so it can run on a worker thread
+    static void catchUp();
+    // All-time and today's sales for the dashboard and /api/summary
+    static bool totals(Totals& totals, QString* error = nullptr);
+};
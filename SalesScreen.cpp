@@ -2,6 +2,11 @@
 #include "BillDialog.h"
 #include "Bill.h"
 #include "ReportsScreen.h"
+#include "SaleNumberAllocator.h"
+#include "StockLedger.h"
+#include "SalesRollup.h"
+#include "TopSellers.h"
+#include "OrderQuantiles.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
@@ -12,11 +17,14 @@
 #include <QHeaderView>
 #include <QComboBox>
 #include <QMessageBox>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QVariant>
 #include <QDebug>
 #include <QDateTime>
+#include <QTimer>
+#include <QThreadPool>
 
 SalesScreen::SalesScreen(QWidget *parent) : QWidget(parent), subtotal(0), tax(0), finalTotal(0) {
     QHBoxLayout *mainLayout = new QHBoxLayout(this);
@@ -274,18 +282,46 @@ void SalesScreen::processPayment() {
     QString paymentMethod = paymentMethodCombo->currentText();
     double paidAmount = finalTotal; // For now, assume paid in full (can add input dialog later)
     double change = 0.0; // For now, assume no change (can add cash input later)
-    // --- Save Sale to DB ---
+    // --- Number the sale locally from the reserved block ---
+    int saleId = SaleNumberAllocator::instance().nextSaleId();
+    if (saleId < 0) {
+        QMessageBox::critical(this, "Error", "No sale numbers available. Check the database connection.");
+        return;
+    }
+    QDateTime saleTime = QDateTime::currentDateTime();
+    // --- Create Bill from real cart data ---
+    Bill bill;
+    bill.saleId = saleId;
+    bill.cashier = username;
+    bill.dateTime = saleTime;
+    bill.taxRate = 0.085;
+    bill.paid = paidAmount;
+    bill.change = change;
+    for (const auto& item : cartItems) {
+        BillItem bitem;
+        bitem.name = item.name;
+        bitem.quantity = item.quantity;
+        bitem.price = item.price;
+        bill.items.append(bitem);
+    }
+    // --- Save Sale to DB: the sale, its items, stock movements, rollups and order sketches commit together ---
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction()) {
+        QMessageBox::critical(this, "Error", "Failed to save sale: " + db.lastError().text());
+        return;
+    }
     QSqlQuery saleQuery;
-    saleQuery.prepare("INSERT INTO sales (cashier, sale_time, total, payment_method) VALUES (?, ?, ?, ?) RETURNING id");
+    saleQuery.prepare("INSERT INTO sales (id, cashier, sale_time, total, payment_method) VALUES (?, ?, ?, ?, ?)");
+    saleQuery.addBindValue(saleId);
     saleQuery.addBindValue(username);
-    saleQuery.addBindValue(QDateTime::currentDateTime());
+    saleQuery.addBindValue(saleTime);
     saleQuery.addBindValue(finalTotal);
     saleQuery.addBindValue(paymentMethod);
-    if (!saleQuery.exec() || !saleQuery.next()) {
+    if (!saleQuery.exec()) {
+        db.rollback();
         QMessageBox::critical(this, "Error", "Failed to save sale: " + saleQuery.lastError().text());
         return;
     }
-    int saleId = saleQuery.value(0).toInt();
     // Save each item
     QSqlQuery itemQuery;
     for (const auto& item : cartItems) {
@@ -295,28 +331,28 @@ void SalesScreen::processPayment() {
         itemQuery.addBindValue(item.quantity);
         itemQuery.addBindValue(item.price);
         if (!itemQuery.exec()) {
+            db.rollback();
             QMessageBox::critical(this, "Error", "Failed to save sale item: " + itemQuery.lastError().text());
-            // Optionally: rollback or mark sale as incomplete
+            return;
         }
     }
-    // --- Create Bill from real cart data ---
-    Bill bill;
-    bill.saleId = saleId;
-    bill.cashier = username;
-    bill.dateTime = QDateTime::currentDateTime();
-    bill.taxRate = 0.085;
-    bill.paid = paidAmount;
-    bill.change = change;
-    for (const auto& item : cartItems) {
-        BillItem bitem;
-        bitem.name = item.name;
-        bitem.quantity = item.quantity;
-        bitem.price = item.price;
-        bill.items.append(bitem);
+    int itemCount = 0;
+    for (const auto& item : cartItems) itemCount += item.quantity;
+    QString saveError;
+    if (!StockLedger::recordSale(bill, &saveError) || !SalesRollup::rollupSale(saleId, &saveError)
+        || !OrderQuantiles::recordSale(saleTime, username, SaleNumberAllocator::terminalId(), finalTotal, itemCount, &saveError)
+        || !db.commit()) {
+        db.rollback();
+        QMessageBox::critical(this, "Error", "Failed to save sale: " + (saveError.isEmpty() ? db.lastError().text() : saveError));
+        return;
     }
+    // Refill the offline reserve once the customer-facing work is done
+    QTimer::singleShot(0, [] { SaleNumberAllocator::instance().topUp(); });
+    QThreadPool::globalInstance()->start([] { TopSellers::instance().poll(); });
     // Log sale
     QString details = QString("Total: $%1, Items: %2, Payment: %3, SaleID: %4").arg(finalTotal, 0, 'f', 2).arg(cartItems.size()).arg(paymentMethod).arg(saleId);
-    ReportsScreen::logActivity(username, "Sale", details);
+    ReportsScreen::logActivity(username, "Sale", details,
+                               {{"sale_id", saleId}, {"total", finalTotal}, {"items", cartItems.size()}, {"payment", paymentMethod}});
     // Show BillDialog
     BillDialog dlg(bill, this);
     dlg.exec();
@@ -355,18 +391,24 @@ void SalesScreen::addProductToSales(const QString &name, double price, int quant
 
 void SalesScreen::reloadProductsFromDatabase() {
     productList->clear();
-    QSqlQuery query("SELECT name, price, quantity FROM products WHERE quantity > 0");
+    // Low stock uses the same rule as Inventory, plus the forecast when one has run
+    QSqlQuery query("SELECT p.name, p.price, p.quantity, p.min_stock, f.stockout_date, COALESCE(f.suggested_order, 0) "
+                    "FROM products p LEFT JOIN product_forecasts f ON f.product_id = p.id WHERE p.quantity > 0");
     int count = 0;
-    const int lowStockThreshold = 5;
     while (query.next()) {
         QString name = query.value(0).toString();
         double price = query.value(1).toDouble();
         int quantity = query.value(2).toInt();
+        int minStock = query.value(3).toInt();
+        QDate stockoutDate = query.value(4).toDate();
+        bool reorder = query.value(5).toInt() > 0;
         QString productText = QString("%1 - $%2").arg(name).arg(price, 0, 'f', 2);
         QListWidgetItem* item = new QListWidgetItem(productText);
-        if (quantity <= lowStockThreshold) {
+        if (quantity <= minStock || reorder) {
             item->setForeground(QColor("#FFD600")); // yellow for low stock
-            item->setToolTip("Low stock: " + QString::number(quantity));
+            QString tip = "Low stock: " + QString::number(quantity);
+            if (stockoutDate.isValid()) tip += ", expected to run out " + stockoutDate.toString("yyyy-MM-dd");
+            item->setToolTip(tip);
         }
         productList->addItem(item);
         count++;
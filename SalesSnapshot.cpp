@@ -0,0 +1,371 @@
+#include "SalesSnapshot.h"
+#include <QDataStream>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace SalesSnapshot {
+
+static const char magic[8] = {'P', 'O', 'S', 'S', 'N', 'A', 'P', '\0'};
+static const int headerBytes = 16;
+static const int footerBytes = 28;
+
+static void appendLE64(QByteArray& out, quint64 value) {
+    char bytes[8];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 8);
+}
+
+static void appendLE32(QByteArray& out, quint32 value) {
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+static int bitsFor(quint64 range) {
+    int bits = 0;
+    while (range) {
+        ++bits;
+        range >>= 1;
+    }
+    return bits;
+}
+
+static qint64 packedBytes(qint64 count, int width) {
+    return (count * width + 63) / 64 * 8;
+}
+
+// Packs each value's low `width` bits end to end, least significant bit first
+static void packBits(const std::vector<quint64>& values, int width, QByteArray& out) {
+    if (width == 0) return;
+    quint64 word = 0;
+    int used = 0;
+    for (quint64 v : values) {
+        word |= v << used;
+        used += width;
+        if (used >= 64) {
+            appendLE64(out, word);
+            used -= 64;
+            word = used ? v >> (width - used) : 0;
+        }
+    }
+    if (used > 0) appendLE64(out, word);
+}
+
+static quint64 unpackBits(const uchar* packed, qint64 index, int width) {
+    if (width == 0) return 0;
+    const qint64 bit = index * width;
+    const qint64 wordIndex = bit / 64;
+    const int shift = int(bit % 64);
+    quint64 value = qFromLittleEndian<quint64>(packed + wordIndex * 8) >> shift;
+    if (shift + width > 64) value |= qFromLittleEndian<quint64>(packed + (wordIndex + 1) * 8) << (64 - shift);
+    return width == 64 ? value : value & ((quint64(1) << width) - 1);
+}
+
+// Picks the smallest of the three encodings for one block
+static QByteArray encodeBlock(const std::vector<qint64>& values, BlockInfo& info) {
+    const qint64 n = qint64(values.size());
+    const auto [minIt, maxIt] = std::minmax_element(values.begin(), values.end());
+    info.min = *minIt;
+    info.max = *maxIt;
+    info.rows = quint32(n);
+
+    const int forWidth = bitsFor(quint64(info.max) - quint64(info.min));
+    const qint64 forSize = 9 + packedBytes(n, forWidth);
+
+    // Deltas wrap like unsigned integers, so decoding is exact even across overflow
+    qint64 deltaMin = 0, deltaMax = 0;
+    for (qint64 i = 1; i < n; ++i) {
+        const qint64 delta = qint64(quint64(values[i]) - quint64(values[i - 1]));
+        if (i == 1 || delta < deltaMin) deltaMin = delta;
+        if (i == 1 || delta > deltaMax) deltaMax = delta;
+    }
+    const int deltaWidth = bitsFor(quint64(deltaMax) - quint64(deltaMin));
+    const qint64 deltaSize = 17 + packedBytes(n - 1, deltaWidth);
+    const qint64 plainSize = n * 8;
+
+    QByteArray out;
+    if (plainSize <= forSize && plainSize <= deltaSize) {
+        info.encoding = Encoding::Plain;
+        out.reserve(int(plainSize));
+        for (qint64 v : values) appendLE64(out, quint64(v));
+    } else if (forSize <= deltaSize) {
+        info.encoding = Encoding::FrameOfReference;
+        out.reserve(int(forSize));
+        appendLE64(out, quint64(info.min));
+        out.append(char(forWidth));
+        std::vector<quint64> offsets(values.size());
+        for (size_t i = 0; i < values.size(); ++i) offsets[i] = quint64(values[i]) - quint64(info.min);
+        packBits(offsets, forWidth, out);
+    } else {
+        info.encoding = Encoding::DeltaFrameOfReference;
+        out.reserve(int(deltaSize));
+        appendLE64(out, quint64(values[0]));
+        appendLE64(out, quint64(deltaMin));
+        out.append(char(deltaWidth));
+        std::vector<quint64> deltas(values.size() - 1);
+        for (size_t i = 1; i < values.size(); ++i) {
+            deltas[i - 1] = quint64(values[i]) - quint64(values[i - 1]) - quint64(deltaMin);
+        }
+        packBits(deltas, deltaWidth, out);
+    }
+    info.size = quint32(out.size());
+    return out;
+}
+
+int TableInfo::columnIndex(const QString& column) const {
+    for (int i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == column) return i;
+    }
+    return -1;
+}
+
+Writer::Writer(const QString& path) : file(path) {
+}
+
+bool Writer::open() {
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = file.errorString();
+        return false;
+    }
+    QByteArray header(magic, 8);
+    appendLE32(header, formatVersion);
+    appendLE32(header, 0);
+    if (file.write(header) != header.size()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool Writer::beginTable(const QString& name, const QList<QPair<QString, ColumnType>>& columns) {
+    if (inTable && !endTable()) return false;
+    TableInfo table;
+    table.name = name;
+    for (const auto& column : columns) {
+        ColumnInfo info;
+        info.name = column.first;
+        info.type = column.second;
+        table.columns.append(info);
+    }
+    tables.append(table);
+    pending.assign(size_t(columns.size()), std::vector<qint64>());
+    for (auto& values : pending) values.reserve(blockRows);
+    codes.assign(size_t(columns.size()), QHash<QString, qint64>());
+    row.assign(size_t(columns.size()), 0);
+    inTable = true;
+    return true;
+}
+
+void Writer::setInteger(int column, qint64 value) {
+    row[size_t(column)] = value;
+}
+
+void Writer::setString(int column, const QString& value) {
+    QHash<QString, qint64>& dictionary = codes[size_t(column)];
+    auto it = dictionary.constFind(value);
+    if (it == dictionary.constEnd()) {
+        it = dictionary.insert(value, dictionary.size());
+        tables.last().columns[column].dictionary.append(value);
+    }
+    row[size_t(column)] = it.value();
+}
+
+bool Writer::commitRow() {
+    for (size_t i = 0; i < row.size(); ++i) {
+        pending[i].push_back(row[i]);
+        row[i] = 0;
+    }
+    ++tables.last().rows;
+    return pending.empty() || pending[0].size() < size_t(blockRows) || flushBlock();
+}
+
+bool Writer::flushBlock() {
+    TableInfo& table = tables.last();
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (pending[i].empty()) continue;
+        BlockInfo info;
+        const QByteArray encoded = encodeBlock(pending[i], info);
+        if (!writeAligned(encoded, info.offset)) return false;
+        table.columns[int(i)].blocks.append(info);
+        pending[i].clear();
+    }
+    return true;
+}
+
+bool Writer::writeAligned(const QByteArray& data, quint64& offset) {
+    const qint64 padding = (8 - file.pos() % 8) % 8;
+    if (padding && file.write(QByteArray(int(padding), '\0')) != padding) {
+        error = file.errorString();
+        return false;
+    }
+    offset = quint64(file.pos());
+    if (file.write(data) != data.size()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool Writer::endTable() {
+    if (!inTable) return true;
+    inTable = false;
+    return flushBlock();
+}
+
+bool Writer::close() {
+    if (!endTable()) return false;
+    QByteArray directory;
+    {
+        QDataStream out(&directory, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out << QDateTime::currentDateTimeUtc().toMSecsSinceEpoch() << quint32(tables.size());
+        for (const TableInfo& table : tables) {
+            out << table.name << table.rows << quint32(table.columns.size());
+            for (const ColumnInfo& column : table.columns) {
+                out << column.name << quint8(column.type) << column.dictionary << quint32(column.blocks.size());
+                for (const BlockInfo& block : column.blocks) {
+                    out << block.offset << block.size << block.rows << quint8(block.encoding) << block.min << block.max;
+                }
+            }
+        }
+    }
+    quint64 directoryOffset;
+    if (!writeAligned(directory, directoryOffset)) return false;
+    QByteArray footer;
+    appendLE64(footer, directoryOffset);
+    appendLE64(footer, quint64(directory.size()));
+    appendLE32(footer, formatVersion);
+    footer.append(magic, 8);
+    if (file.write(footer) != footer.size() || !file.flush()) {
+        error = file.errorString();
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+void Writer::discard() {
+    file.close();
+    file.remove();
+    inTable = false;
+}
+
+Reader::~Reader() {
+    if (data) file.unmap(const_cast<uchar*>(data));
+}
+
+bool Reader::open(const QString& path) {
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+        return false;
+    }
+    size = file.size();
+    if (size < headerBytes + footerBytes) {
+        error = "Not a sales snapshot (file too short)";
+        return false;
+    }
+    data = file.map(0, size);
+    if (!data) {
+        error = "Could not map the file: " + file.errorString();
+        return false;
+    }
+    const uchar* footer = data + size - footerBytes;
+    if (memcmp(data, magic, 8) != 0 || memcmp(footer + 20, magic, 8) != 0) {
+        error = "Not a sales snapshot";
+        return false;
+    }
+    fileVersion = qFromLittleEndian<quint32>(data + 8);
+    if (fileVersion > formatVersion) {
+        error = QString("Snapshot format %1 is newer than this reader (%2)").arg(fileVersion).arg(formatVersion);
+        return false;
+    }
+    const quint64 directoryOffset = qFromLittleEndian<quint64>(footer);
+    const quint64 directorySize = qFromLittleEndian<quint64>(footer + 8);
+    if (directoryOffset < quint64(headerBytes) || directoryOffset + directorySize > quint64(size - footerBytes)) {
+        error = "Corrupt snapshot directory";
+        return false;
+    }
+
+    const QByteArray directory = QByteArray::fromRawData(reinterpret_cast<const char*>(data + directoryOffset), int(directorySize));
+    QDataStream in(directory);
+    in.setVersion(QDataStream::Qt_6_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+    qint64 createdMs;
+    quint32 tableCount;
+    in >> createdMs >> tableCount;
+    created = QDateTime::fromMSecsSinceEpoch(createdMs, Qt::UTC);
+    for (quint32 t = 0; t < tableCount && in.status() == QDataStream::Ok; ++t) {
+        TableInfo table;
+        quint32 columnCount;
+        in >> table.name >> table.rows >> columnCount;
+        for (quint32 c = 0; c < columnCount && in.status() == QDataStream::Ok; ++c) {
+            ColumnInfo column;
+            quint8 type;
+            quint32 blockCount;
+            in >> column.name >> type >> column.dictionary >> blockCount;
+            column.type = ColumnType(type);
+            for (quint32 b = 0; b < blockCount && in.status() == QDataStream::Ok; ++b) {
+                BlockInfo block;
+                quint8 encoding;
+                in >> block.offset >> block.size >> block.rows >> encoding >> block.min >> block.max;
+                block.encoding = Encoding(encoding);
+                if (block.offset + block.size > directoryOffset) in.setStatus(QDataStream::ReadCorruptData);
+                column.blocks.append(block);
+            }
+            table.columns.append(column);
+        }
+        tableList.append(table);
+    }
+    if (in.status() != QDataStream::Ok) {
+        error = "Corrupt snapshot directory";
+        tableList.clear();
+        return false;
+    }
+    return true;
+}
+
+const TableInfo* Reader::table(const QString& name) const {
+    for (const TableInfo& table : tableList) {
+        if (table.name == name) return &table;
+    }
+    return nullptr;
+}
+
+bool Reader::readBlock(const ColumnInfo& column, int block, std::vector<qint64>& out) const {
+    if (block < 0 || block >= column.blocks.size()) return false;
+    const BlockInfo& info = column.blocks[block];
+    const uchar* p = data + info.offset;
+    const qint64 n = info.rows;
+    out.resize(size_t(n));
+    switch (info.encoding) {
+    case Encoding::Plain:
+        if (info.size < n * 8) return false;
+        for (qint64 i = 0; i < n; ++i) out[size_t(i)] = qFromLittleEndian<qint64>(p + i * 8);
+        return true;
+    case Encoding::FrameOfReference: {
+        const quint64 base = qFromLittleEndian<quint64>(p);
+        const int width = p[8];
+        if (width > 64 || info.size < 9 + packedBytes(n, width)) return false;
+        for (qint64 i = 0; i < n; ++i) out[size_t(i)] = qint64(base + unpackBits(p + 9, i, width));
+        return true;
+    }
+    case Encoding::DeltaFrameOfReference: {
+        quint64 value = qFromLittleEndian<quint64>(p);
+        const quint64 deltaMin = qFromLittleEndian<quint64>(p + 8);
+        const int width = p[16];
+        if (n == 0 || width > 64 || info.size < 17 + packedBytes(n - 1, width)) return false;
+        out[0] = qint64(value);
+        for (qint64 i = 1; i < n; ++i) {
+            value += deltaMin + unpackBits(p + 17, i - 1, width);
+            out[size_t(i)] = qint64(value);
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QPair>
+#include <QFile>
+#include <QDateTime>
+#include <vector>
+
+// Columnar snapshot files (.possnap) of the sales tables, for analysis away
+// from the production database. Built as the salessnapshot library: the app
+// writes snapshots and the snapshot_query tool reads them.
+//
+// Layout (little-endian):
+//   "POSSNAP\0" magic, u32 format version, u32 reserved
+//   column blocks, each 8-byte aligned
+//   directory (QDataStream): tables -> columns -> blocks with min/max
+//   footer: u64 directory offset, u64 directory size, u32 version, "POSSNAP\0"
+//
+// Every column of a table is cut into blocks of blockRows rows, so block i of
+// each column covers the same rows. Each block is encoded on its own as plain
+// int64, frame-of-reference bit-packed, or delta bit-packed, whichever is
+// smallest. String columns store dictionary codes; the dictionary lives in
+// the directory. Readers map the file and decode only the blocks whose
+// min/max can match, using the statistics in the directory.
+namespace SalesSnapshot {
+
+constexpr quint32 formatVersion = 1;
+constexpr int blockRows = 65536;
+
+enum class ColumnType : quint8 { Integer = 1, String = 2 };
+enum class Encoding : quint8 { Plain = 0, FrameOfReference = 1, DeltaFrameOfReference = 2 };
+
+struct BlockInfo {
+    quint64 offset = 0;
+    quint32 size = 0;  // Encoded bytes
+    quint32 rows = 0;
+    Encoding encoding = Encoding::Plain;
+    qint64 min = 0;    // Over the stored values (dictionary codes for strings)
+    qint64 max = 0;
+};
+
+struct ColumnInfo {
+    QString name;
+    ColumnType type = ColumnType::Integer;
+    QStringList dictionary; // String columns only; code -> value
+    QList<BlockInfo> blocks;
+};
+
+struct TableInfo {
+    QString name;
+    quint64 rows = 0;
+    QList<ColumnInfo> columns;
+    int columnIndex(const QString& column) const;
+};
+
+// Appends tables one at a time. Only the current block of each column and the
+// string dictionaries are held in memory.
+class Writer {
+public:
+    explicit Writer(const QString& path);
+
+    bool open();
+    bool beginTable(const QString& name, const QList<QPair<QString, ColumnType>>& columns);
+    void setInteger(int column, qint64 value);
+    void setString(int column, const QString& value); // Empty and null share one code
+    bool commitRow();
+    bool endTable();
+    bool close();
+    void discard(); // Abandons the file and deletes it
+    QString errorString() const { return error; }
+
+private:
+    bool flushBlock();
+    bool writeAligned(const QByteArray& data, quint64& offset);
+
+    QFile file;
+    QList<TableInfo> tables;
+    std::vector<std::vector<qint64>> pending; // Current block, per column
+    std::vector<QHash<QString, qint64>> codes;  // String columns' dictionaries
+    std::vector<qint64> row;                    // The row being filled in
+    bool inTable = false;
+    QString error;
+};
+
+// Maps a snapshot read-only. Decoding touches only the requested blocks.
+class Reader {
+public:
+    ~Reader();
+
+    bool open(const QString& path);
+    QString errorString() const { return error; }
+    quint32 version() const { return fileVersion; }
+    QDateTime createdAt() const { return created; }
+    const QList<TableInfo>& tables() const { return tableList; }
+    const TableInfo* table(const QString& name) const;
+
+    // Decodes block `block` of a column into out (resized to the block's rows)
+    bool readBlock(const ColumnInfo& column, int block, std::vector<qint64>& out) const;
+
+private:
+    QFile file;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+    quint32 fileVersion = 0;
+    QDateTime created;
+    QList<TableInfo> tableList;
+    QString error;
+};
+
+}
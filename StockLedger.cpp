@@ -0,0 +1,136 @@
+#include "StockLedger.h"
+#include "DbConnection.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QStringList>
+#include <QVariant>
+#include <QDebug>
+
+QString StockLedger::reasonName(Reason reason) {
+    switch (reason) {
+    case Sale: return "sale";
+    case Receipt: return "receipt";
+    case Return: return "return";
+    default: return "adjustment";
+    }
+}
+
+bool StockLedger::recordSale(const Bill& bill, QString* error) {
+    if (bill.items.isEmpty()) return true;
+    QStringList rows;
+    for (int i = 0; i < bill.items.size(); ++i) rows << "(?::text, ?::integer)";
+    QSqlQuery query;
+    query.prepare(QString("INSERT INTO stock_movements (product_id, quantity_delta, reason, reference, username) "
+                          "SELECT p.id, -v.quantity, 'sale', ?, ? FROM (VALUES %1) AS v(name, quantity) "
+                          "JOIN products p ON p.name = v.name WHERE v.quantity <> 0").arg(rows.join(", ")));
+    query.addBindValue(QString::number(bill.saleId));
+    query.addBindValue(bill.cashier);
+    for (const BillItem& item : bill.items) {
+        query.addBindValue(item.name);
+        query.addBindValue(item.quantity);
+    }
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool StockLedger::record(int productId, int delta, Reason reason, const QString& reference,
+                         const QString& username, QString* error) {
+    if (delta == 0) return true;
+    QSqlQuery query;
+    query.prepare("INSERT INTO stock_movements (product_id, quantity_delta, reason, reference, username) "
+                  "VALUES (?, ?, ?, ?, ?)");
+    query.addBindValue(productId);
+    query.addBindValue(delta);
+    query.addBindValue(reasonName(reason));
+    query.addBindValue(reference);
+    query.addBindValue(username);
+    if (!query.exec()) {
+        if (error) *error = query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool StockLedger::adjustTo(int productId, int newQuantity, const QString& username, QString* error) {
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.transaction()) {
+        if (error) *error = db.lastError().text();
+        return false;
+    }
+    // Lock the row so a sale committing meanwhile is not overwritten by a stale delta
+    QSqlQuery current;
+    current.prepare("SELECT quantity FROM products WHERE id = ? FOR UPDATE");
+    current.addBindValue(productId);
+    if (!current.exec() || !current.next()) {
+        if (error) *error = current.lastError().isValid() ? current.lastError().text() : QString("Product not found");
+        db.rollback();
+        return false;
+    }
+    const int delta = newQuantity - current.value(0).toInt();
+    if (!record(productId, delta, Adjustment, "Stock count", username, error) || !db.commit()) {
+        if (error && error->isEmpty()) *error = db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    return true;
+}
+
+int StockLedger::applyCounts(const QMap<int, int>& counts, const QString& reference,
+                             const QString& username, QString* error) {
+    if (counts.isEmpty()) return 0;
+    QStringList ids, quantities;
+    for (auto it = counts.constBegin(); it != counts.constEnd(); ++it) {
+        ids << QString::number(it.key());
+        quantities << QString::number(it.value());
+    }
+    QSqlQuery query;
+    query.prepare("WITH counted AS (SELECT * FROM unnest(?::integer[], ?::integer[]) AS c(product_id, quantity)), "
+                  "locked AS (SELECT p.id, p.quantity FROM products p JOIN counted c ON c.product_id = p.id "
+                  "ORDER BY p.id FOR UPDATE OF p), "
+                  "moved AS (INSERT INTO stock_movements (product_id, quantity_delta, reason, reference, username) "
+                  "SELECT c.product_id, c.quantity - l.quantity, 'adjustment', ?, ? FROM counted c "
+                  "JOIN locked l ON l.id = c.product_id WHERE c.quantity <> l.quantity RETURNING 1) "
+                  "SELECT COUNT(*) FROM moved");
+    query.addBindValue("{" + ids.join(',') + "}");
+    query.addBindValue("{" + quantities.join(',') + "}");
+    query.addBindValue(reference);
+    query.addBindValue(username);
+    if (!query.exec() || !query.next()) {
+        if (error) *error = query.lastError().text();
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+int StockLedger::quantityAt(int productId, const QDateTime& at, bool* ok) {
+    QSqlQuery query;
+    query.prepare("SELECT stock_at(?, ?)");
+    query.addBindValue(productId);
+    query.addBindValue(at);
+    const bool found = query.exec() && query.next();
+    if (ok) *ok = found;
+    return found ? query.value(0).toInt() : 0;
+}
+
+void StockLedger::runMaintenance() {
+    ScopedDbConnection connection("stock-ledger");
+    if (!connection.isOpen()) {
+        qDebug() << "Stock ledger maintenance: no connection:" << connection.lastError();
+        return;
+    }
+    QSqlQuery query(connection.database());
+    query.prepare("SELECT ensure_monthly_partitions('stock_movements', ?)");
+    query.addBindValue(partitionMonthsAhead);
+    if (!query.exec()) {
+        qDebug() << "Failed to create stock ledger partitions:" << query.lastError().text();
+    }
+    if (!query.exec("SELECT take_stock_snapshot()")) {
+        qDebug() << "Failed to snapshot stock ledger:" << query.lastError().text();
+    } else if (query.next() && query.value(0).toInt() > 0) {
+        qDebug() << "Stock snapshot written for" << query.value(0).toInt() << "products";
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <QString>
+#include <QDateTime>
+#include <QMap>
+#include "Bill.h"
+
+// Appends to the stock_movements ledger on the default connection. A trigger
+// keeps products.quantity equal to the sum of a product's movements, so stock
+// changes go through here instead of writing the column directly.
+class StockLedger {
+public:
+    enum Reason { Sale, Receipt, Adjustment, Return };
+    static QString reasonName(Reason reason);
+
+    // One statement for the whole bill; joins the caller's transaction if any
+    static bool recordSale(const Bill& bill, QString* error = nullptr);
+    static bool record(int productId, int delta, Reason reason, const QString& reference,
+                       const QString& username, QString* error = nullptr);
+    // Stock count: appends whatever adjustment brings the product to newQuantity
+    static bool adjustTo(int productId, int newQuantity, const QString& username, QString* error = nullptr);
+    // Applies a stocktake (product id -> counted quantity) as one set-based
+    // statement against the locked current quantities. Returns the number of
+    // products adjusted, or -1 on error.
+    static int applyCounts(const QMap<int, int>& counts, const QString& reference,
+                           const QString& username, QString* error = nullptr);
+    // Latest snapshot at or before the time plus the movements after it
+    static int quantityAt(int productId, const QDateTime& at, bool* ok = nullptr);
+
+    // Creates upcoming monthly partitions and compacts the ledger into
+    // snapshots. Opens its own connection, so it can run on a worker thread.
+    static void runMaintenance();
+};
@@ -0,0 +1,132 @@
+#include "TDigest.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+#include <cmath>
+
+static const double pi = 3.14159265358979323846;
+static const quint8 serialVersion = 1;
+
+TDigest::TDigest(double compression) : compression(compression) {
+}
+
+void TDigest::add(double value, double weight) {
+    if (!(weight > 0) || std::isnan(value)) return;
+    if (isEmpty()) {
+        min = max = value;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    buffer.push_back({value, weight});
+    bufferWeight += weight;
+    if (buffer.size() >= size_t(5 * compression)) compress();
+}
+
+void TDigest::merge(const TDigest& other) {
+    if (other.isEmpty()) return;
+    other.compress();
+    if (isEmpty()) {
+        min = other.min;
+        max = other.max;
+    } else {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+    for (const Centroid& centroid : other.centroids) {
+        buffer.push_back(centroid);
+        bufferWeight += centroid.weight;
+    }
+    if (buffer.size() >= size_t(5 * compression)) compress();
+}
+
+// One merging pass: centroids are walked in order and combined while the
+// combined centroid stays within one unit of the scale function
+// k(q) = compression / 2pi * asin(2q - 1).
+void TDigest::compress() const {
+    if (buffer.empty()) return;
+    std::vector<Centroid> all;
+    all.reserve(centroids.size() + buffer.size());
+    all.insert(all.end(), centroids.begin(), centroids.end());
+    all.insert(all.end(), buffer.begin(), buffer.end());
+    std::sort(all.begin(), all.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+    const double total = totalWeight + bufferWeight;
+    auto k = [this](double q) { return compression / (2 * pi) * std::asin(2 * q - 1); };
+    auto qLimit = [this, &k](double q) { return (std::sin(std::min(k(q) + 1, compression / 4) * 2 * pi / compression) + 1) / 2; };
+
+    centroids.clear();
+    Centroid current = all[0];
+    double weightSoFar = 0;
+    double limit = qLimit(0);
+    for (size_t i = 1; i < all.size(); ++i) {
+        const Centroid& next = all[i];
+        if ((weightSoFar + current.weight + next.weight) / total <= limit) {
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        } else {
+            centroids.push_back(current);
+            weightSoFar += current.weight;
+            limit = qLimit(weightSoFar / total);
+            current = next;
+        }
+    }
+    centroids.push_back(current);
+    buffer.clear();
+    totalWeight = total;
+    bufferWeight = 0;
+}
+
+// Interpolates between centroid centres, using min and max for the ends
+double TDigest::quantile(double q) const {
+    if (isEmpty()) return 0;
+    compress();
+    q = std::clamp(q, 0.0, 1.0);
+    if (centroids.size() == 1) return centroids[0].mean;
+    const double index = q * totalWeight;
+    const Centroid& first = centroids.front();
+    if (index < first.weight / 2) {
+        return min + (first.mean - min) * (first.weight == 1 ? 0 : index / (first.weight / 2));
+    }
+    double weightSoFar = first.weight / 2; // Rank of the current centroid's centre
+    for (size_t i = 0; i + 1 < centroids.size(); ++i) {
+        const double step = (centroids[i].weight + centroids[i + 1].weight) / 2;
+        if (index < weightSoFar + step) {
+            return centroids[i].mean + (centroids[i + 1].mean - centroids[i].mean) * (index - weightSoFar) / step;
+        }
+        weightSoFar += step;
+    }
+    const Centroid& last = centroids.back();
+    if (last.weight == 1) return max;
+    return last.mean + (max - last.mean) * std::min(1.0, (index - weightSoFar) / (last.weight / 2));
+}
+
+QByteArray TDigest::serialize() const {
+    compress();
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << serialVersion << compression << min << max << quint32(centroids.size());
+    for (const Centroid& centroid : centroids) out << centroid.mean << centroid.weight;
+    return data;
+}
+
+bool TDigest::deserialize(const QByteArray& data, TDigest& digest) {
+    digest = TDigest();
+    if (data.isEmpty()) return true;
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint8 version = 0;
+    quint32 size = 0;
+    in >> version;
+    if (version != serialVersion) return false;
+    in >> digest.compression >> digest.min >> digest.max >> size;
+    if (in.status() != QDataStream::Ok || size > quint32(data.size())) return false;
+    digest.centroids.reserve(size);
+    for (quint32 i = 0; i < size; ++i) {
+        Centroid centroid;
+        in >> centroid.mean >> centroid.weight;
+        digest.centroids.push_back(centroid);
+        digest.totalWeight += centroid.weight;
+    }
+    return in.status() == QDataStream::Ok;
+}
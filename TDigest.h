@@ -0,0 +1,40 @@
+#pragma once
+#include <QByteArray>
+#include <vector>
+
+// Merging t-digest (Dunning) for approximate quantiles of a stream of values.
+// Values are kept as weighted centroids, small near the tails and larger in
+// the middle (arcsine scale), so with the default compression of 100 a digest
+// holds at most about 100 centroids (about 1 KB serialized) and quantiles
+// stay within about 0.1% of rank. Digests merge without losing accuracy,
+// which is what lets per-hour sketches be combined into any range.
+class TDigest {
+public:
+    explicit TDigest(double compression = 100);
+
+    void add(double value, double weight = 1);
+    void merge(const TDigest& other);
+    double quantile(double q) const; // q in [0, 1]; 0 for an empty digest
+    double count() const { return totalWeight + bufferWeight; }
+    bool isEmpty() const { return count() == 0; }
+
+    QByteArray serialize() const;
+    static bool deserialize(const QByteArray& data, TDigest& digest); // An empty array is an empty digest
+
+private:
+    struct Centroid {
+        double mean;
+        double weight;
+    };
+    void compress() const;
+
+    double compression;
+    // Unmerged additions are buffered and folded in by compress(), which the
+    // const readers call too, hence mutable
+    mutable std::vector<Centroid> centroids; // Sorted by mean
+    mutable std::vector<Centroid> buffer;
+    mutable double totalWeight = 0;
+    mutable double bufferWeight = 0;
+    double min = 0;
+    double max = 0;
+};
@@ -0,0 +1,299 @@
+#include "TopSellers.h"
+#include "DbConnection.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDataStream>
+#include <QVariant>
+#include <QDebug>
+#include <algorithm>
+#include <mutex>
+
+static const qint64 minuteBucketSeconds = 5 * 60;
+static const qint64 hourBucketSeconds = 60 * 60;
+static const int lastHourBuckets = 12;
+static const int lastWeekBuckets = 7 * 24;
+static const int fetchSize = 5000;
+static const quint32 stateVersion = 1;
+
+void TopSellers::Sketch::add(const QString& product, qint64 quantity) {
+    total += quantity;
+    auto it = position.constFind(product);
+    int i;
+    if (it != position.constEnd()) {
+        i = it.value();
+        heap[size_t(i)].count += quantity;
+    } else if (int(heap.size()) < capacity) {
+        // Not full yet: the new counter is exact and climbs up from the bottom
+        heap.push_back({product, quantity, 0});
+        i = int(heap.size()) - 1;
+        while (i > 0 && heap[size_t((i - 1) / 2)].count > heap[size_t(i)].count) {
+            std::swap(heap[size_t(i)], heap[size_t((i - 1) / 2)]);
+            position[heap[size_t(i)].product] = i;
+            i = (i - 1) / 2;
+        }
+        position[product] = i;
+        return;
+    } else {
+        // Evict the smallest counter; its count becomes the newcomer's error
+        Counter& smallest = heap[0];
+        position.remove(smallest.product);
+        smallest.product = product;
+        smallest.error = smallest.count;
+        smallest.count += quantity;
+        position[product] = 0;
+        i = 0;
+    }
+    siftDown(i);
+}
+
+void TopSellers::Sketch::siftDown(int i) {
+    const int size = int(heap.size());
+    while (true) {
+        int smallest = i;
+        const int left = 2 * i + 1, right = left + 1;
+        if (left < size && heap[size_t(left)].count < heap[size_t(smallest)].count) smallest = left;
+        if (right < size && heap[size_t(right)].count < heap[size_t(smallest)].count) smallest = right;
+        if (smallest == i) return;
+        std::swap(heap[size_t(i)], heap[size_t(smallest)]);
+        position[heap[size_t(i)].product] = i;
+        position[heap[size_t(smallest)].product] = smallest;
+        i = smallest;
+    }
+}
+
+qint64 TopSellers::Sketch::floor() const {
+    return int(heap.size()) < capacity ? 0 : heap[0].count;
+}
+
+TopSellers& TopSellers::instance() {
+    static TopSellers topSellers;
+    return topSellers;
+}
+
+TopSellers::TopSellers() {
+}
+
+QString TopSellers::windowName(Window window) {
+    switch (window) {
+    case Window::LastHour: return "Last hour";
+    case Window::Today: return "Today";
+    case Window::LastSevenDays: return "Last 7 days";
+    }
+    return QString();
+}
+
+bool TopSellers::parseWindow(const QString& text, Window& window) {
+    if (text == "hour") window = Window::LastHour;
+    else if (text == "today") window = Window::Today;
+    else if (text == "7d") window = Window::LastSevenDays;
+    else return false;
+    return true;
+}
+
+TopSellers::Result TopSellers::top(Window window, int limit) const {
+    QReadLocker locker(&lock);
+    Result result = windows[int(window)];
+    if (result.entries.size() > limit) result.entries.resize(qMax(0, limit));
+    return result;
+}
+
+void TopSellers::poll() {
+    std::unique_lock<QMutex> guard(busy, std::try_to_lock);
+    if (!guard.owns_lock()) return; // The running poll will pick the new sales up
+    ScopedDbConnection connection("top-sellers");
+    if (!connection.isOpen()) {
+        qDebug() << "Top sellers: no connection:" << connection.lastError();
+        return;
+    }
+    if (!loaded) {
+        loaded = true; // A missing or unreadable state just means starting from the last week of sales
+        load(connection.database());
+    }
+
+    const QDateTime started = QDateTime::currentDateTime();
+    const qint64 now = started.toSecsSinceEpoch();
+    const qint64 hourStart = now - now % minuteBucketSeconds - lastHourBuckets * minuteBucketSeconds;
+    qint64 fromSeq;
+    {
+        QReadLocker locker(&lock);
+        fromSeq = qMax<qint64>(0, watermark - seqMargin);
+    }
+    SqlCursor cursor(connection.database(), "top_sellers", fetchSize);
+    if (!cursor.open("SELECT s.id, s.ingest_seq, s.sale_time, si.product_name, si.quantity "
+                     "FROM sales s JOIN sales_items si ON si.sale_id = s.id "
+                     "WHERE s.ingest_seq > ? AND s.sale_time >= ? ORDER BY s.ingest_seq",
+                     {fromSeq, started.addSecs(-(lastWeekBuckets + 1) * hourBucketSeconds)})) {
+        qDebug() << "Top sellers poll failed:" << cursor.lastError();
+        return;
+    }
+    // Rows of one sale arrive together, since each sale has its own ingest_seq
+    int currentSale = -1;
+    bool skip = false;
+    QSqlQuery batch(connection.database());
+    while (cursor.fetch(batch)) {
+        QWriteLocker locker(&lock);
+        do {
+            const int saleId = batch.value(0).toInt();
+            if (saleId != currentSale) {
+                currentSale = saleId;
+                skip = recentSales.contains(saleId);
+                if (!skip) {
+                    const qint64 seq = batch.value(1).toLongLong();
+                    recentSales.insert(saleId, seq);
+                    watermark = qMax(watermark, seq);
+                }
+            }
+            const qint64 quantity = batch.value(4).toLongLong();
+            if (skip || quantity <= 0) continue;
+            const qint64 time = batch.value(2).toDateTime().toSecsSinceEpoch();
+            const QString product = batch.value(3).toString();
+            hourBuckets[time - time % hourBucketSeconds].add(product, quantity);
+            if (time >= hourStart) minuteBuckets[time - time % minuteBucketSeconds].add(product, quantity);
+        } while (batch.next());
+    }
+    if (!cursor.atEnd()) qDebug() << "Top sellers poll failed:" << cursor.lastError();
+    cursor.close();
+
+    {
+        QWriteLocker locker(&lock);
+        prune(now);
+        rebuildWindows(now);
+    }
+    emit updated();
+}
+
+void TopSellers::prune(qint64 now) {
+    const qint64 minuteCutoff = now - now % minuteBucketSeconds - lastHourBuckets * minuteBucketSeconds;
+    while (!minuteBuckets.isEmpty() && minuteBuckets.firstKey() < minuteCutoff) minuteBuckets.erase(minuteBuckets.begin());
+    const qint64 hourCutoff = now - now % hourBucketSeconds - lastWeekBuckets * hourBucketSeconds;
+    while (!hourBuckets.isEmpty() && hourBuckets.firstKey() < hourCutoff) hourBuckets.erase(hourBuckets.begin());
+    for (auto it = recentSales.begin(); it != recentSales.end();) {
+        if (it.value() <= watermark - seqMargin) it = recentSales.erase(it);
+        else ++it;
+    }
+}
+
+void TopSellers::rebuildWindows(qint64 now) {
+    const qint64 midnight = QDateTime(QDate::currentDate(), QTime(0, 0)).toSecsSinceEpoch();
+    windows[int(Window::LastHour)] = merge(minuteBuckets, now - now % minuteBucketSeconds - (lastHourBuckets - 1) * minuteBucketSeconds);
+    windows[int(Window::Today)] = merge(hourBuckets, midnight);
+    windows[int(Window::LastSevenDays)] = merge(hourBuckets, now - now % hourBucketSeconds - (lastWeekBuckets - 1) * hourBucketSeconds);
+}
+
+// Merging keeps the Space-Saving guarantees: a product missing from a bucket
+// sold at most that bucket's floor there, so it is charged the floor as
+// possible overcount, and the floors add up to the window's error bound.
+TopSellers::Result TopSellers::merge(const Buckets& buckets, qint64 from) {
+    struct Bounds {
+        qint64 aboveFloors = 0; // Sum of count - floor over buckets holding the product
+        qint64 lower = 0;
+    };
+    QHash<QString, Bounds> bounds;
+    Result result;
+    for (auto it = buckets.lowerBound(from); it != buckets.constEnd(); ++it) {
+        const Sketch& sketch = it.value();
+        const qint64 floor = sketch.floor();
+        for (const Sketch::Counter& counter : sketch.heap) {
+            Bounds& b = bounds[counter.product];
+            b.aboveFloors += counter.count - floor;
+            b.lower += counter.count - counter.error;
+        }
+        result.totalQuantity += sketch.total;
+        result.errorBound += floor;
+    }
+    std::vector<Entry> entries;
+    entries.reserve(size_t(bounds.size()));
+    for (auto it = bounds.constBegin(); it != bounds.constEnd(); ++it) {
+        const qint64 upper = it->aboveFloors + result.errorBound;
+        entries.push_back({it.key(), upper, upper - it->lower});
+    }
+    const size_t keep = std::min(entries.size(), size_t(listed));
+    std::partial_sort(entries.begin(), entries.begin() + keep, entries.end(), [](const Entry& a, const Entry& b) {
+        return a.quantity != b.quantity ? a.quantity > b.quantity : a.product < b.product;
+    });
+    for (size_t i = 0; i < keep; ++i) result.entries << entries[i];
+    result.updatedAt = QDateTime::currentDateTime();
+    return result;
+}
+
+void TopSellers::save(int waitMs) {
+    if (!busy.tryLock(waitMs)) {
+        qDebug() << "Top sellers: not saved, a poll is still running";
+        return;
+    }
+    std::lock_guard<QMutex> guard(busy, std::adopt_lock);
+    QByteArray state;
+    qint64 savedWatermark;
+    {
+        QReadLocker locker(&lock);
+        if (!loaded) return; // Nothing polled yet, so don't overwrite what's saved
+        savedWatermark = watermark;
+        QDataStream out(&state, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << stateVersion << watermark << recentSales;
+        for (const Buckets* buckets : {&minuteBuckets, &hourBuckets}) {
+            out << quint32(buckets->size());
+            for (auto it = buckets->constBegin(); it != buckets->constEnd(); ++it) {
+                out << it.key() << it->total << quint32(it->heap.size());
+                for (const Sketch::Counter& counter : it->heap) out << counter.product << counter.count << counter.error;
+            }
+        }
+    }
+    ScopedDbConnection connection("top-sellers");
+    if (!connection.isOpen()) {
+        qDebug() << "Top sellers: no connection:" << connection.lastError();
+        return;
+    }
+    QSqlQuery query(connection.database());
+    query.prepare("INSERT INTO top_sellers_state (id, watermark, saved_at, state) VALUES (true, ?, NOW(), ?) "
+                  "ON CONFLICT (id) DO UPDATE SET watermark = EXCLUDED.watermark, saved_at = EXCLUDED.saved_at, state = EXCLUDED.state");
+    query.addBindValue(savedWatermark);
+    query.addBindValue(state);
+    if (!query.exec()) qDebug() << "Failed to save top sellers:" << query.lastError().text();
+}
+
+bool TopSellers::load(const QSqlDatabase& db) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT state FROM top_sellers_state WHERE id")) {
+        qDebug() << "Top sellers: no saved state:" << query.lastError().text();
+        return false;
+    }
+    if (!query.next()) return false;
+    QDataStream in(query.value(0).toByteArray());
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 version = 0;
+    qint64 savedWatermark = 0;
+    QHash<int, qint64> savedSales;
+    Buckets savedBuckets[2];
+    in >> version;
+    if (version != stateVersion) return false;
+    in >> savedWatermark >> savedSales;
+    for (Buckets& buckets : savedBuckets) {
+        quint32 count = 0;
+        in >> count;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            qint64 start = 0;
+            quint32 counters = 0;
+            Sketch sketch;
+            in >> start >> sketch.total >> counters;
+            if (counters > quint32(capacity)) in.setStatus(QDataStream::ReadCorruptData);
+            for (quint32 c = 0; c < counters && in.status() == QDataStream::Ok; ++c) {
+                Sketch::Counter counter;
+                in >> counter.product >> counter.count >> counter.error;
+                sketch.position.insert(counter.product, int(sketch.heap.size())); // Saved in heap order
+                sketch.heap.push_back(counter);
+            }
+            buckets.insert(start, sketch);
+        }
+    }
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "Top sellers: saved state is corrupt; rebuilding from the last week of sales";
+        return false;
+    }
+    QWriteLocker locker(&lock);
+    watermark = savedWatermark;
+    recentSales = savedSales;
+    minuteBuckets = savedBuckets[0];
+    hourBuckets = savedBuckets[1];
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QDateTime>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSqlDatabase>
+#include <vector>
+
+// Approximate best sellers for the dashboard, the Reports screen and
+// /api/top-sellers, held in memory so reading them never touches the
+// database. Every five-minute and every hourly bucket keeps a weighted
+// Space-Saving summary of at most `capacity` products, counting quantity sold.
+//
+// Error bounds: a listed quantity never undercounts and overcounts by at most
+// the entry's error. A window's errorBound is at most its total quantity
+// divided by capacity, and any product that sold more than errorBound in the
+// window is guaranteed to be listed. Windows align to bucket edges: the last
+// hour covers the last 55-60 minutes and seven days the last 167-168 hours.
+//
+// poll() feeds sales committed on any terminal since the previous poll, in
+// ingest order. It re-reads a trailing margin of ingest_seq to catch sales
+// that committed out of order and skips sales it has already counted. The
+// summaries and the poll position are saved to top_sellers_state.
+class TopSellers : public QObject {
+    Q_OBJECT
+public:
+    enum class Window { LastHour, Today, LastSevenDays };
+    struct Entry {
+        QString product;
+        qint64 quantity = 0; // Upper bound on the quantity sold
+        qint64 error = 0;    // The true quantity is at least quantity - error
+    };
+    struct Result {
+        QList<Entry> entries; // Largest first
+        qint64 totalQuantity = 0;
+        qint64 errorBound = 0;
+        QDateTime updatedAt;  // Null until the first poll
+    };
+    static constexpr int capacity = 100;      // Counters per bucket
+    static constexpr int listed = 50;         // Entries kept per window
+    static constexpr qint64 seqMargin = 1000; // ingest_seq values re-read each poll
+
+    static TopSellers& instance();
+    static QString windowName(Window window);
+    static bool parseWindow(const QString& text, Window& window); // "hour", "today" or "7d"
+
+    // O(limit); served from the window lists rebuilt by each poll
+    Result top(Window window, int limit) const;
+
+    // Blocking; run on a worker thread. Each opens its own connection and
+    // does nothing if another poll or save is in progress; save() first waits
+    // up to waitMs for it to finish.
+    void poll();
+    void save(int waitMs = 0);
+
+signals:
+    void updated(); // Emitted from the polling thread
+
+private:
+    TopSellers();
+
+    // Weighted Space-Saving: an indexed min-heap of counters by count
+    struct Sketch {
+        struct Counter {
+            QString product;
+            qint64 count = 0;
+            qint64 error = 0;
+        };
+        std::vector<Counter> heap;
+        QHash<QString, int> position;
+        qint64 total = 0;
+
+        void add(const QString& product, qint64 quantity);
+        qint64 floor() const; // Most a product missing from the summary can have sold
+    private:
+        void siftDown(int i);
+    };
+    using Buckets = QMap<qint64, Sketch>; // Bucket start (epoch seconds) -> summary
+
+    bool load(const QSqlDatabase& db);
+    void prune(qint64 now);
+    void rebuildWindows(qint64 now);
+    static Result merge(const Buckets& buckets, qint64 from);
+
+    mutable QReadWriteLock lock;
+    Buckets minuteBuckets; // Five-minute buckets for the last hour
+    Buckets hourBuckets;   // Hourly buckets for the last seven days
+    Result windows[3];
+    qint64 watermark = 0;         // Highest ingest_seq counted
+    QHash<int, qint64> recentSales; // Sale id -> ingest_seq, within seqMargin of watermark
+    bool loaded = false;
+    QMutex busy;
+};
@@ -0,0 +1,318 @@
+#include "XlsxWriter.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <zlib.h>
+
+// Deflate input and output are handled in chunks of this size
+static const int chunkBytes = 64 * 1024;
+
+static void appendLE16(QByteArray& out, quint16 value) {
+    char bytes[2];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 2);
+}
+
+static void appendLE32(QByteArray& out, quint32 value) {
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, 4);
+}
+
+static void appendXmlText(QByteArray& out, const QString& text) {
+    QString escaped;
+    escaped.reserve(text.size());
+    for (const QChar c : text) {
+        switch (c.unicode()) {
+        case '&': escaped += QLatin1String("&amp;"); break;
+        case '<': escaped += QLatin1String("&lt;"); break;
+        case '>': escaped += QLatin1String("&gt;"); break;
+        case '"': escaped += QLatin1String("&quot;"); break;
+        case '\t': case '\n': case '\r': escaped += c; break;
+        default:
+            if (c.unicode() >= 0x20) escaped += c; // Other control characters are not valid XML
+            break;
+        }
+    }
+    out.append(escaped.toUtf8());
+}
+
+// Excel's serial date: days since 1899-12-30, time as the fraction
+static double excelSerial(const QDateTime& value) {
+    static const QDate epoch(1899, 12, 30);
+    return epoch.daysTo(value.date()) + value.time().msecsSinceStartOfDay() / 86400000.0;
+}
+
+XlsxWriter::XlsxWriter(const QString& path) : file(path) {
+}
+
+XlsxWriter::~XlsxWriter() {
+    if (stream) {
+        deflateEnd(stream);
+        delete stream;
+    }
+}
+
+bool XlsxWriter::open(const QString& sheetTitle, const QStringList& headerLabels, const QList<CellType>& cellTypes) {
+    title = sheetTitle.left(25);
+    for (const char c : QByteArray("[]:*?/\\")) title.remove(QChar(c));
+    if (title.isEmpty()) title = "Sheet";
+    headers = headerLabels;
+    types = cellTypes;
+    for (int i = 0; i < headers.size(); ++i) {
+        QByteArray letters;
+        for (int n = i + 1; n > 0; n = (n - 1) / 26) letters.prepend(char('A' + (n - 1) % 26));
+        columnLetters << letters;
+    }
+    const QDateTime now = QDateTime::currentDateTime();
+    dosTime = quint16((now.time().hour() << 11) | (now.time().minute() << 5) | (now.time().second() / 2));
+    dosDate = quint16(((now.date().year() - 1980) << 9) | (now.date().month() << 5) | now.date().day());
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        error = file.errorString();
+        return false;
+    }
+    stream = new z_stream_s();
+    // Raw deflate: zip supplies its own framing
+    if (deflateInit2(stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        error = "Could not initialise compression";
+        return false;
+    }
+    deflated.resize(chunkBytes);
+    return beginSheet();
+}
+
+bool XlsxWriter::writeRow(const QVariantList& values) {
+    if (sheetRow >= maxRowsPerSheet && !(endSheet() && beginSheet())) return false;
+    ++sheetRow;
+    const QByteArray rowNumber = QByteArray::number(sheetRow);
+    QByteArray xml = "<row r=\"" + rowNumber + "\">";
+    for (int i = 0; i < values.size() && i < types.size(); ++i) {
+        const QVariant& value = values[i];
+        if (value.isNull()) continue;
+        const QByteArray ref = columnLetters[i] + rowNumber;
+        switch (types[i]) {
+        case Number:
+            xml.append("<c r=\"" + ref + "\"><v>" + QByteArray::number(value.toLongLong()) + "</v></c>");
+            break;
+        case Money:
+            xml.append("<c r=\"" + ref + "\" s=\"2\"><v>" + QByteArray::number(value.toDouble(), 'f', 2) + "</v></c>");
+            break;
+        case DateTime:
+            xml.append("<c r=\"" + ref + "\" s=\"1\"><v>" + QByteArray::number(excelSerial(value.toDateTime()), 'f', 8) + "</v></c>");
+            break;
+        case Text:
+            xml.append("<c r=\"" + ref + "\" t=\"inlineStr\"><is><t xml:space=\"preserve\">");
+            appendXmlText(xml, value.toString());
+            xml.append("</t></is></c>");
+            break;
+        }
+    }
+    xml.append("</row>");
+    return writeEntry(xml);
+}
+
+bool XlsxWriter::close() {
+    if (!endSheet()) return false;
+
+    QByteArray contentTypes = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+        "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+        "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+        "<Override PartName=\"/xl/workbook.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+        "<Override PartName=\"/xl/styles.xml\" ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml\"/>";
+    QByteArray workbook = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+        "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\"><sheets>";
+    QByteArray workbookRels = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">";
+    for (int i = 1; i <= sheetCount; ++i) {
+        const QByteArray n = QByteArray::number(i);
+        contentTypes.append("<Override PartName=\"/xl/worksheets/sheet" + n + ".xml\" "
+                            "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>");
+        workbook.append("<sheet name=\"");
+        appendXmlText(workbook, sheetName(i));
+        workbook.append("\" sheetId=\"" + n + "\" r:id=\"rId" + n + "\"/>");
+        workbookRels.append("<Relationship Id=\"rId" + n + "\" "
+                            "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" "
+                            "Target=\"worksheets/sheet" + n + ".xml\"/>");
+    }
+    contentTypes.append("</Types>");
+    workbook.append("</sheets></workbook>");
+    workbookRels.append("<Relationship Id=\"rId" + QByteArray::number(sheetCount + 1) + "\" "
+                        "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\" "
+                        "Target=\"styles.xml\"/></Relationships>");
+    // Style 1 is a date-time (built-in format 22), style 2 is 0.00 (built-in format 2)
+    const QByteArray styles = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<styleSheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+        "<fonts count=\"1\"><font><sz val=\"11\"/><name val=\"Calibri\"/></font></fonts>"
+        "<fills count=\"2\"><fill><patternFill patternType=\"none\"/></fill><fill><patternFill patternType=\"gray125\"/></fill></fills>"
+        "<borders count=\"1\"><border><left/><right/><top/><bottom/><diagonal/></border></borders>"
+        "<cellStyleXfs count=\"1\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\"/></cellStyleXfs>"
+        "<cellXfs count=\"3\"><xf numFmtId=\"0\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\"/>"
+        "<xf numFmtId=\"22\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\" applyNumberFormat=\"1\"/>"
+        "<xf numFmtId=\"2\" fontId=\"0\" fillId=\"0\" borderId=\"0\" xfId=\"0\" applyNumberFormat=\"1\"/></cellXfs>"
+        "</styleSheet>";
+    const QByteArray rootRels = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+        "<Relationship Id=\"rId1\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+        "Target=\"xl/workbook.xml\"/></Relationships>";
+    if (!writeWholeEntry("[Content_Types].xml", contentTypes) || !writeWholeEntry("_rels/.rels", rootRels)
+        || !writeWholeEntry("xl/workbook.xml", workbook) || !writeWholeEntry("xl/_rels/workbook.xml.rels", workbookRels)
+        || !writeWholeEntry("xl/styles.xml", styles)) {
+        return false;
+    }
+
+    // Central directory and end record
+    const qint64 directoryOffset = file.pos();
+    QByteArray directory;
+    for (const Entry& entry : entries) {
+        appendLE32(directory, 0x02014b50);
+        appendLE16(directory, 20);     // Made by
+        appendLE16(directory, 20);     // Needed to extract
+        appendLE16(directory, 0x0808); // Data descriptor, UTF-8 names
+        appendLE16(directory, 8);      // Deflate
+        appendLE16(directory, dosTime);
+        appendLE16(directory, dosDate);
+        appendLE32(directory, entry.crc);
+        appendLE32(directory, entry.compressedSize);
+        appendLE32(directory, entry.size);
+        appendLE16(directory, quint16(entry.name.size()));
+        appendLE16(directory, 0);      // Extra field
+        appendLE16(directory, 0);      // Comment
+        appendLE16(directory, 0);      // Disk
+        appendLE16(directory, 0);      // Internal attributes
+        appendLE32(directory, 0);      // External attributes
+        appendLE32(directory, entry.offset);
+        directory.append(entry.name);
+    }
+    if (directoryOffset + directory.size() > 0xFFFFFFFFLL) {
+        error = "The export is larger than 4 GB; export a shorter period.";
+        return false;
+    }
+    const quint32 directorySize = quint32(directory.size());
+    appendLE32(directory, 0x06054b50);
+    appendLE16(directory, 0);
+    appendLE16(directory, 0);
+    appendLE16(directory, quint16(entries.size()));
+    appendLE16(directory, quint16(entries.size()));
+    appendLE32(directory, directorySize);
+    appendLE32(directory, quint32(directoryOffset));
+    appendLE16(directory, 0);
+    if (!writeFile(directory)) return false;
+    file.close();
+    return true;
+}
+
+QString XlsxWriter::sheetName(int index) const {
+    return index == 1 ? title : QString("%1 (%2)").arg(title).arg(index);
+}
+
+bool XlsxWriter::beginSheet() {
+    ++sheetCount;
+    sheetRow = 0;
+    if (!beginEntry(QString("xl/worksheets/sheet%1.xml").arg(sheetCount))) return false;
+    QByteArray xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\">"
+        "<sheetViews><sheetView workbookViewId=\"0\"><pane ySplit=\"1\" topLeftCell=\"A2\" activePane=\"bottomLeft\" state=\"frozen\"/>"
+        "</sheetView></sheetViews><sheetData>";
+    return writeEntry(xml) && writeHeaderRow();
+}
+
+bool XlsxWriter::writeHeaderRow() {
+    ++sheetRow;
+    QByteArray xml = "<row r=\"1\">";
+    for (int i = 0; i < headers.size(); ++i) {
+        xml.append("<c r=\"" + columnLetters[i] + "1\" t=\"inlineStr\"><is><t>");
+        appendXmlText(xml, headers[i]);
+        xml.append("</t></is></c>");
+    }
+    xml.append("</row>");
+    return writeEntry(xml);
+}
+
+bool XlsxWriter::endSheet() {
+    return writeEntry("</sheetData></worksheet>") && endEntry();
+}
+
+bool XlsxWriter::beginEntry(const QString& name) {
+    current = Entry();
+    current.name = name.toUtf8();
+    if (file.pos() > 0xFFFFFFFFLL) {
+        error = "The export is larger than 4 GB; export a shorter period.";
+        return false;
+    }
+    current.offset = quint32(file.pos());
+    current.crc = quint32(crc32(0, nullptr, 0));
+    QByteArray header;
+    appendLE32(header, 0x04034b50);
+    appendLE16(header, 20);
+    appendLE16(header, 0x0808); // Sizes follow in a data descriptor
+    appendLE16(header, 8);
+    appendLE16(header, dosTime);
+    appendLE16(header, dosDate);
+    appendLE32(header, 0);      // CRC and sizes: see the descriptor
+    appendLE32(header, 0);
+    appendLE32(header, 0);
+    appendLE16(header, quint16(current.name.size()));
+    appendLE16(header, 0);
+    header.append(current.name);
+    inEntry = true;
+    return writeFile(header);
+}
+
+bool XlsxWriter::writeEntry(const QByteArray& data) {
+    pending.append(data);
+    return pending.size() < chunkBytes || deflatePending(false);
+}
+
+bool XlsxWriter::endEntry() {
+    if (!inEntry) return true;
+    inEntry = false;
+    if (!deflatePending(true)) return false;
+    deflateReset(stream);
+    QByteArray descriptor;
+    appendLE32(descriptor, 0x08074b50);
+    appendLE32(descriptor, current.crc);
+    appendLE32(descriptor, current.compressedSize);
+    appendLE32(descriptor, current.size);
+    entries.append(current);
+    return writeFile(descriptor);
+}
+
+bool XlsxWriter::deflatePending(bool finish) {
+    if (quint64(current.size) + quint64(pending.size()) > 0xFFFFFFFFULL) {
+        error = "A sheet grew past 4 GB uncompressed.";
+        return false;
+    }
+    current.crc = quint32(crc32(current.crc, reinterpret_cast<const Bytef*>(pending.constData()), uInt(pending.size())));
+    current.size += quint32(pending.size());
+    stream->next_in = reinterpret_cast<Bytef*>(pending.data());
+    stream->avail_in = uInt(pending.size());
+    int status;
+    do {
+        stream->next_out = reinterpret_cast<Bytef*>(deflated.data());
+        stream->avail_out = uInt(deflated.size());
+        status = deflate(stream, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (status == Z_STREAM_ERROR) {
+            error = "Compression failed";
+            return false;
+        }
+        const int produced = deflated.size() - int(stream->avail_out);
+        current.compressedSize += quint32(produced);
+        if (produced > 0 && !writeFile(QByteArray::fromRawData(deflated.constData(), produced))) return false;
+    } while (stream->avail_out == 0 || (finish && status != Z_STREAM_END));
+    pending.clear();
+    return true;
+}
+
+bool XlsxWriter::writeWholeEntry(const QString& name, const QByteArray& data) {
+    return beginEntry(name) && writeEntry(data) && endEntry();
+}
+
+bool XlsxWriter::writeFile(const QByteArray& data) {
+    if (file.write(data) != data.size()) {
+        error = file.errorString();
+        return false;
+    }
+    return true;
+}
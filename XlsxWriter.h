@@ -0,0 +1,67 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QVariantList>
+
+struct z_stream_s;
+
+// Writes an .xlsx workbook row by row without holding it in memory. Sheet XML
+// is deflated straight into the zip as it is produced, cells use inline strings
+// (no shared string table), and the workbook parts that list the sheets are
+// written last, once the sheet count is known. A new sheet is started whenever
+// one reaches Excel's row limit.
+class XlsxWriter {
+public:
+    enum CellType { Text, Number, Money, DateTime };
+    static constexpr int maxRowsPerSheet = 1048576; // Including the header row
+
+    explicit XlsxWriter(const QString& path);
+    ~XlsxWriter();
+    XlsxWriter(const XlsxWriter&) = delete;
+    XlsxWriter& operator=(const XlsxWriter&) = delete;
+
+    // sheetTitle is used for every sheet, numbered from the second on
+    bool open(const QString& sheetTitle, const QStringList& headers, const QList<CellType>& types);
+    bool writeRow(const QVariantList& values); // Null values leave the cell empty
+    bool close();
+    QString errorString() const { return error; }
+
+private:
+    struct Entry {
+        QByteArray name;
+        quint32 crc = 0;
+        quint32 compressedSize = 0;
+        quint32 size = 0;
+        quint32 offset = 0;
+    };
+    bool beginEntry(const QString& name);
+    bool writeEntry(const QByteArray& data);
+    bool endEntry();
+    bool deflatePending(bool finish);
+    bool writeFile(const QByteArray& data);
+    bool writeWholeEntry(const QString& name, const QByteArray& data);
+    bool beginSheet();
+    bool endSheet();
+    bool writeHeaderRow();
+    QString sheetName(int index) const;
+
+    QFile file;
+    z_stream_s* stream = nullptr;
+    QList<Entry> entries;
+    Entry current;
+    bool inEntry = false;
+    QByteArray pending;   // Uncompressed bytes not yet deflated
+    QByteArray deflated;  // Output buffer handed to zlib
+    quint16 dosTime = 0, dosDate = 0;
+
+    QString title;
+    QStringList headers;
+    QList<CellType> types;
+    QList<QByteArray> columnLetters;
+    int sheetCount = 0;
+    int sheetRow = 0; // Rows written to the current sheet, header included
+    QString error;
+};
@@ -0,0 +1,13 @@
+-- Activity Feed Setup for POS System
+-- Run this file on an existing database (after activity_log_details_setup.sql)
+-- Tells every terminal's recent activity feed which ids were just logged
+CREATE OR REPLACE FUNCTION notify_activity_log() RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM pg_notify('activity_log', json_build_object('from', MIN(id), 'to', MAX(id))::text)
+    FROM logged HAVING COUNT(*) > 0;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+DROP TRIGGER IF EXISTS activity_log_notify ON activity_log;
+CREATE TRIGGER activity_log_notify AFTER INSERT ON activity_log
+    REFERENCING NEW TABLE AS logged FOR EACH STATEMENT EXECUTE FUNCTION notify_activity_log();
@@ -0,0 +1,24 @@
+-- Activity Log Details Setup for POS System
+-- Run this file on an existing database (after activity_log_partitioning_setup.sql)
+-- to add structured details and the indexes behind the activity log filters
+ALTER TABLE activity_log ADD COLUMN IF NOT EXISTS details_json JSONB NOT NULL DEFAULT '{}';
+-- Filtered, keyset-paged reads: newest first within a user or an action
+DROP INDEX IF EXISTS idx_activity_log_timestamp;
+DROP INDEX IF EXISTS idx_activity_log_username;
+CREATE INDEX idx_activity_log_timestamp ON activity_log(timestamp, id);
+CREATE INDEX idx_activity_log_username ON activity_log(username, timestamp, id);
+CREATE INDEX IF NOT EXISTS idx_activity_log_action ON activity_log(action, timestamp, id);
+-- Backfill from the free-text details of earlier entries
+UPDATE activity_log SET details_json = jsonb_strip_nulls(jsonb_build_object(
+    'sale_id', substring(details FROM 'SaleID: (\d+)')::bigint,
+    'total', substring(details FROM 'Total: \$([0-9.]+)')::numeric,
+    'items', substring(details FROM 'Items: (\d+)')::integer,
+    'payment', substring(details FROM 'Payment: ([^,]+)')))
+WHERE action = 'Sale' AND details ~ 'SaleID: \d+' AND details_json = '{}';
+UPDATE activity_log SET details_json = jsonb_strip_nulls(jsonb_build_object(
+    'product', substring(details FROM '^(.*), Qty: -?\d+$'),
+    'quantity', substring(details FROM ', Qty: (-?\d+)$')::integer))
+WHERE action = 'Edit Product' AND details ~ ', Qty: -?\d+$' AND details_json = '{}';
+UPDATE activity_log SET details_json = jsonb_build_object('product', details)
+WHERE action IN ('Add Product', 'Delete Product') AND details IS NOT NULL AND details_json = '{}';
+CREATE INDEX IF NOT EXISTS idx_activity_log_details ON activity_log USING GIN (details_json jsonb_path_ops);
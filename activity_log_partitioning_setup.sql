@@ -0,0 +1,47 @@
+-- Activity Log Partitioning Setup for POS System
+-- Run this file on an existing database (after stock_ledger_setup.sql, which defines
+-- ensure_monthly_partitions) to move activity_log onto monthly partitions.
+-- Existing entries are copied into partitions for the months they fall in.
+BEGIN;
+ALTER TABLE activity_log RENAME TO activity_log_unpartitioned;
+ALTER SEQUENCE IF EXISTS activity_log_id_seq RENAME TO activity_log_unpartitioned_id_seq;
+ALTER INDEX IF EXISTS activity_log_pkey RENAME TO activity_log_unpartitioned_pkey;
+DROP INDEX IF EXISTS idx_activity_log_timestamp;
+DROP INDEX IF EXISTS idx_activity_log_username;
+CREATE TABLE activity_log (
+    id BIGSERIAL,
+    username TEXT REFERENCES users(username),
+    action TEXT,
+    details TEXT,
+    timestamp TIMESTAMP NOT NULL DEFAULT NOW(),
+    PRIMARY KEY (id, timestamp) -- Also serves incremental backups reading past the last backed-up id
+) PARTITION BY RANGE (timestamp);
+-- Catches entries for months without a partition; maintenance moves them out
+CREATE TABLE activity_log_default PARTITION OF activity_log DEFAULT;
+-- One partition per month that already has entries, then the coming months
+DO $$
+DECLARE
+    month_start DATE;
+BEGIN
+    FOR month_start IN SELECT DISTINCT date_trunc('month', timestamp)::date FROM activity_log_unpartitioned
+                       WHERE timestamp IS NOT NULL LOOP
+        EXECUTE format('CREATE TABLE IF NOT EXISTS %I PARTITION OF activity_log FOR VALUES FROM (%L) TO (%L)',
+                       'activity_log_' || to_char(month_start, 'YYYYMM'),
+                       month_start, (month_start + interval '1 month')::date);
+    END LOOP;
+END;
+$$;
+SELECT ensure_monthly_partitions('activity_log', 3);
+-- Entries by users since deleted (possible where activity_log had no foreign key)
+-- keep the name in their details
+INSERT INTO activity_log (id, username, action, details, timestamp)
+SELECT o.id, u.username, o.action,
+       CASE WHEN o.username IS NOT NULL AND u.username IS NULL THEN concat_ws(' ', o.details, '(user ' || o.username || ')')
+            ELSE o.details END,
+       COALESCE(o.timestamp, NOW())
+FROM activity_log_unpartitioned o LEFT JOIN users u ON u.username = o.username;
+SELECT setval(pg_get_serial_sequence('activity_log', 'id'), COALESCE((SELECT MAX(id) FROM activity_log), 0) + 1, false);
+DROP TABLE activity_log_unpartitioned;
+CREATE INDEX idx_activity_log_timestamp ON activity_log(timestamp);
+CREATE INDEX idx_activity_log_username ON activity_log(username);
+COMMIT;
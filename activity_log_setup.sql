@@ -1,5 +1,6 @@
 -- Activity Log Table Setup for POS System
 -- Run this file in PostgreSQL to create the activity_log table for audit trail
+-- (then activity_log_partitioning_setup.sql to partition it by month)
 -- Create the activity_log table for tracking user actions
 CREATE TABLE IF NOT EXISTS activity_log (
     id SERIAL PRIMARY KEY,
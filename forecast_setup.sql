@@ -0,0 +1,15 @@
+-- Reorder Forecast Setup for POS System
+-- Run this file on an existing database to store results of the forecasting job
+-- Reorder forecasts, replaced on each run of the forecasting job
+CREATE TABLE IF NOT EXISTS product_forecasts (
+    product_id INTEGER PRIMARY KEY REFERENCES products(id) ON DELETE CASCADE,
+    daily_velocity NUMERIC(12, 3) NOT NULL,
+    weekday_factors REAL[] NOT NULL, -- Monday first, averaging 1
+    stockout_date DATE,
+    reorder_point INTEGER NOT NULL,
+    suggested_order INTEGER NOT NULL,
+    computed_at TIMESTAMP NOT NULL DEFAULT NOW()
+);
+-- The forecast reads a date range of sales and their lines
+CREATE INDEX IF NOT EXISTS idx_sales_items_sale_id ON sales_items(sale_id);
+CREATE INDEX IF NOT EXISTS idx_sales_sale_time ON sales(sale_time);
@@ -0,0 +1,4 @@
+-- Incremental Backup Setup for POS System
+-- Run this file on an existing database (after stock_ledger_setup.sql)
+-- Incremental backups read stock movements past the last backed-up id
+CREATE INDEX IF NOT EXISTS idx_stock_movements_id ON stock_movements(id);
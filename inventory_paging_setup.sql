@@ -0,0 +1,7 @@
+-- Inventory Paging Setup for POS System
+-- Indexes matching the keyset ORDER BY used by the Inventory tab, so each page
+-- is an index range scan instead of a sort over the whole catalog
+CREATE INDEX IF NOT EXISTS idx_products_name_id ON products(name, id);
+CREATE INDEX IF NOT EXISTS idx_products_category_id ON products((COALESCE(category, '')), id);
+CREATE INDEX IF NOT EXISTS idx_products_price_id ON products(price, id);
+CREATE INDEX IF NOT EXISTS idx_products_quantity_id ON products(quantity, id);
@@ -10,9 +10,22 @@
 #include <QMessageBox>
 #include "ReportsScreen.h"
 #include "HttpServer.h"
+#include "SaleNumberAllocator.h"
+#include "StockLedger.h"
+#include "SalesRollup.h"
+#include "TopSellers.h"
+#include "OrderQuantiles.h"
+#include "ActivityLogger.h"
+#include "ActivityLogRetention.h"
+#include "ActivityFeed.h"
+#include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Monster");
+    QCoreApplication::setApplicationName("POSApp");
 
     // --- PostgreSQL Connection Setup ---
     QSqlDatabase db = QSqlDatabase::addDatabase("QPSQL");
@@ -30,6 +43,42 @@ int main(int argc, char *argv[]) {
         qDebug() << "Connected to PostgreSQL!";
     }
 
+    // --- Reserve sale numbers so checkout never waits on the sequence ---
+    SaleNumberAllocator::instance().topUp();
+
+    // --- Hourly background upkeep: stock ledger partitions/snapshots, sales rollup catch-up, order sketch backfill, activity log partitions ---
+    auto runMaintenance = [] {
+        QThreadPool::globalInstance()->start(&StockLedger::runMaintenance);
+        QThreadPool::globalInstance()->start(&SalesRollup::catchUp);
+        QThreadPool::globalInstance()->start(&OrderQuantiles::backfill);
+        QThreadPool::globalInstance()->start(&ActivityLogRetention::runMaintenance);
+    };
+    runMaintenance();
+    QTimer maintenanceTimer;
+    QObject::connect(&maintenanceTimer, &QTimer::timeout, runMaintenance);
+    maintenanceTimer.start(60 * 60 * 1000);
+
+    // --- Top sellers: follow committed sales from every terminal, save every few minutes ---
+    TopSellers &topSellers = TopSellers::instance();
+    auto pollTopSellers = [&topSellers] { QThreadPool::globalInstance()->start([&topSellers] { topSellers.poll(); }); };
+    pollTopSellers();
+    QTimer topSellersTimer;
+    QObject::connect(&topSellersTimer, &QTimer::timeout, pollTopSellers);
+    topSellersTimer.start(QSettings().value("topSellers/pollSeconds", 15).toInt() * 1000);
+    QTimer topSellersSaveTimer;
+    QObject::connect(&topSellersSaveTimer, &QTimer::timeout, [&topSellers] {
+        QThreadPool::globalInstance()->start([&topSellers] { topSellers.save(); });
+    });
+    topSellersSaveTimer.start(5 * 60 * 1000);
+
+    // --- Recent activity in memory: follow other terminals' entries, re-check every minute ---
+    ActivityFeed::instance().listen();
+    auto catchUpActivityFeed = [] { QThreadPool::globalInstance()->start([] { ActivityFeed::instance().catchUp(); }); };
+    catchUpActivityFeed();
+    QTimer activityFeedTimer;
+    QObject::connect(&activityFeedTimer, &QTimer::timeout, catchUpActivityFeed);
+    activityFeedTimer.start(60 * 1000);
+
     // --- Start HTTP Server ---
     HttpServer httpServer;
     if (httpServer.start(8080)) {
@@ -37,8 +86,12 @@ int main(int argc, char *argv[]) {
         qDebug() << "Your coworkers can now access:";
         qDebug() << "  http://192.168.1.36:8080/api/sales";
         qDebug() << "  http://192.168.1.36:8080/api/inventory";
-        qDebug() << "  http://192.168.1.36:8080/api/activity-log";
+        qDebug() << "  http://192.168.1.36:8080/api/activity-log?action=Sale&username=admin";
         qDebug() << "  http://192.168.1.36:8080/api/summary";
+        qDebug() << "  http://192.168.1.36:8080/api/products/search?q=coffee";
+        qDebug() << "  http://192.168.1.36:8080/api/forecast";
+        qDebug() << "  http://192.168.1.36:8080/api/top-sellers?window=today";
+        qDebug() << "  http://192.168.1.36:8080/api/basket-quantiles?group_by=cashier";
         qDebug() << "API Key: pos_api_key_2024";
     } else {
         qDebug() << "Warning: Failed to start HTTP server";
@@ -82,5 +135,10 @@ int main(int argc, char *argv[]) {
     w.setUserRole(userRole);
     w.setUsername(loggedInUser); // Pass username to MainWindow/SalesScreen
     w.show();
-    return app.exec();
+    int result = app.exec();
+    // Track (or hand back) the unused part of this terminal's sale ID blocks
+    SaleNumberAllocator::instance().recordUsage(QSettings().value("terminal/releaseSaleIdsOnExit", false).toBool());
+    topSellers.save(5000); // Gives up rather than hold up quitting behind a slow poll
+    ActivityLogger::instance().shutdown(); // Writes (or spills) whatever is still queued
+    return result;
 }
\ No newline at end of file
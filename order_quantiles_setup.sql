@@ -0,0 +1,33 @@
+-- Order Quantiles Setup for POS System
+-- Run this file on an existing database (after sales_rollup_setup.sql). Sales from
+-- before this are sketched by the app's hourly maintenance, a day at a time.
+-- Order value and item count t-digests per hour/day x cashier x terminal,
+-- updated at checkout (see OrderQuantiles)
+CREATE TABLE IF NOT EXISTS order_sketches_hourly (
+    bucket TIMESTAMP NOT NULL,
+    cashier TEXT NOT NULL,
+    terminal_id TEXT NOT NULL,
+    orders INTEGER NOT NULL,
+    value_digest BYTEA NOT NULL,
+    items_digest BYTEA NOT NULL,
+    PRIMARY KEY (bucket, cashier, terminal_id)
+);
+CREATE TABLE IF NOT EXISTS order_sketches_daily (
+    bucket DATE NOT NULL,
+    cashier TEXT NOT NULL,
+    terminal_id TEXT NOT NULL,
+    orders INTEGER NOT NULL,
+    value_digest BYTEA NOT NULL,
+    items_digest BYTEA NOT NULL,
+    PRIMARY KEY (bucket, cashier, terminal_id)
+);
+-- Checkout sketches every sale from here on; older ones (ingest_seq below
+-- live_from_seq) are left to the backfill, which records the last day it finished
+CREATE TABLE IF NOT EXISTS order_quantiles_backfill (
+    id BOOLEAN PRIMARY KEY DEFAULT true CHECK (id),
+    live_from_seq BIGINT NOT NULL,
+    done_through DATE
+);
+INSERT INTO order_quantiles_backfill (live_from_seq)
+SELECT COALESCE(MAX(ingest_seq), 0) + 1 FROM sales
+ON CONFLICT (id) DO NOTHING;
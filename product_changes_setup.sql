@@ -0,0 +1,16 @@
+-- Product Changes Setup for POS System
+-- Run this file on an existing database so the Pivot tab's analytics cache only
+-- re-reads products whose name or category changed since its last refresh
+ALTER TABLE products ADD COLUMN IF NOT EXISTS changed_at TIMESTAMP NOT NULL DEFAULT NOW();
+CREATE INDEX IF NOT EXISTS idx_products_changed_at ON products(changed_at);
+-- Stock updates leave changed_at alone; only renames and recategorisations bump it
+CREATE OR REPLACE FUNCTION touch_product_changed_at() RETURNS TRIGGER AS $$
+BEGIN
+    NEW.changed_at := NOW();
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+DROP TRIGGER IF EXISTS products_touch_changed_at ON products;
+CREATE TRIGGER products_touch_changed_at BEFORE UPDATE OF name, category ON products
+    FOR EACH ROW WHEN (OLD.name IS DISTINCT FROM NEW.name OR OLD.category IS DISTINCT FROM NEW.category)
+    EXECUTE FUNCTION touch_product_changed_at();
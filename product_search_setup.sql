@@ -0,0 +1,7 @@
+-- Product Search Setup for POS System
+-- Run this file on an existing database to enable server-side fuzzy product search
+CREATE EXTENSION IF NOT EXISTS pg_trgm;
+-- Lower-cased text searched by the Inventory tab and /api/products/search
+ALTER TABLE products ADD COLUMN IF NOT EXISTS search_text TEXT GENERATED ALWAYS AS (lower(name || ' ' || COALESCE(category, '') || ' ' || COALESCE(description, ''))) STORED;
+-- Trigram index serving both LIKE '%term%' and word-similarity (<%) matches
+CREATE INDEX IF NOT EXISTS idx_products_search_trgm ON products USING GIN (search_text gin_trgm_ops);
@@ -0,0 +1,16 @@
+-- Sale ID Block Allocation Setup for POS System
+-- Run this file on an existing database so terminals can number sales locally
+-- Each nextval() on sales_id_seq now reserves a whole block of sale IDs
+ALTER SEQUENCE sales_id_seq INCREMENT BY 100;
+SELECT setval('sales_id_seq', COALESCE((SELECT MAX(id) FROM sales), 1));
+-- Track which terminal holds which block and how far it got
+CREATE TABLE IF NOT EXISTS sale_id_blocks (
+    block_start INTEGER PRIMARY KEY,
+    block_size INTEGER NOT NULL,
+    terminal_id TEXT NOT NULL,
+    next_unused INTEGER NOT NULL,
+    reserved_at TIMESTAMP NOT NULL DEFAULT NOW(),
+    released_at TIMESTAMP
+);
+-- Released blocks are claimed by other terminals before new ones are reserved
+CREATE INDEX IF NOT EXISTS idx_sale_id_blocks_released ON sale_id_blocks(block_start) WHERE released_at IS NOT NULL;
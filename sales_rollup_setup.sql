@@ -0,0 +1,110 @@
+-- Sales Rollup Setup for POS System
+-- Run this file on an existing database to add the hourly/daily sales rollups.
+-- Existing sales are rolled up at the end, which can take a while on a long history.
+ALTER TABLE sales ADD COLUMN IF NOT EXISTS ingest_seq BIGSERIAL;
+ALTER TABLE sales ADD COLUMN IF NOT EXISTS rolled_up BOOLEAN NOT NULL DEFAULT false;
+-- Sales rollups by hour and by day x cashier x payment method, plus product
+-- quantities at the same grain. Reports read these instead of scanning sales.
+CREATE TABLE IF NOT EXISTS sales_rollup_hourly (
+    bucket TIMESTAMP NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    total NUMERIC(14, 2) NOT NULL,
+    orders INTEGER NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method)
+);
+CREATE TABLE IF NOT EXISTS sales_rollup_daily (
+    bucket DATE NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    total NUMERIC(14, 2) NOT NULL,
+    orders INTEGER NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method)
+);
+CREATE TABLE IF NOT EXISTS product_rollup_hourly (
+    bucket TIMESTAMP NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    product_name TEXT NOT NULL,
+    quantity BIGINT NOT NULL,
+    revenue NUMERIC(14, 2) NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method, product_name)
+);
+CREATE TABLE IF NOT EXISTS product_rollup_daily (
+    bucket DATE NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    product_name TEXT NOT NULL,
+    quantity BIGINT NOT NULL,
+    revenue NUMERIC(14, 2) NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method, product_name)
+);
+-- Sales not yet counted in the rollups, in ingest order
+CREATE INDEX IF NOT EXISTS idx_sales_rollup_pending ON sales(ingest_seq) WHERE NOT rolled_up;
+-- Earlier versions of this script kept a catch-up watermark nothing read
+DROP TABLE IF EXISTS rollup_state;
+-- Adds the given sales to every rollup and marks them rolled up. Sales that are
+-- already rolled up are skipped, so concurrent callers never count one twice.
+CREATE OR REPLACE FUNCTION rollup_sales(sale_ids INTEGER[]) RETURNS INTEGER AS $$
+    WITH claimed AS (
+        UPDATE sales SET rolled_up = true
+        WHERE id = ANY(sale_ids) AND NOT rolled_up AND sale_time IS NOT NULL
+        RETURNING id, date_trunc('hour', sale_time) AS hour, COALESCE(cashier, '') AS cashier, payment_method, total
+    ),
+    items AS (
+        SELECT c.hour, c.cashier, c.payment_method, si.product_name,
+               SUM(si.quantity) AS quantity, SUM(si.quantity * si.price) AS revenue
+        FROM claimed c JOIN sales_items si ON si.sale_id = c.id
+        GROUP BY 1, 2, 3, 4
+    ),
+    sales_hourly AS (
+        INSERT INTO sales_rollup_hourly AS r (bucket, cashier, payment_method, total, orders)
+        SELECT hour, cashier, payment_method, SUM(total), COUNT(*) FROM claimed GROUP BY 1, 2, 3 ORDER BY 1, 2, 3
+        ON CONFLICT (bucket, cashier, payment_method)
+        DO UPDATE SET total = r.total + EXCLUDED.total, orders = r.orders + EXCLUDED.orders
+    ),
+    sales_daily AS (
+        INSERT INTO sales_rollup_daily AS r (bucket, cashier, payment_method, total, orders)
+        SELECT hour::date, cashier, payment_method, SUM(total), COUNT(*) FROM claimed GROUP BY 1, 2, 3 ORDER BY 1, 2, 3
+        ON CONFLICT (bucket, cashier, payment_method)
+        DO UPDATE SET total = r.total + EXCLUDED.total, orders = r.orders + EXCLUDED.orders
+    ),
+    products_hourly AS (
+        INSERT INTO product_rollup_hourly AS r (bucket, cashier, payment_method, product_name, quantity, revenue)
+        SELECT hour, cashier, payment_method, product_name, quantity, revenue FROM items ORDER BY 1, 2, 3, 4
+        ON CONFLICT (bucket, cashier, payment_method, product_name)
+        DO UPDATE SET quantity = r.quantity + EXCLUDED.quantity, revenue = r.revenue + EXCLUDED.revenue
+    ),
+    products_daily AS (
+        INSERT INTO product_rollup_daily AS r (bucket, cashier, payment_method, product_name, quantity, revenue)
+        SELECT hour::date, cashier, payment_method, product_name, SUM(quantity), SUM(revenue) FROM items
+        GROUP BY 1, 2, 3, 4 ORDER BY 1, 2, 3, 4
+        ON CONFLICT (bucket, cashier, payment_method, product_name)
+        DO UPDATE SET quantity = r.quantity + EXCLUDED.quantity, revenue = r.revenue + EXCLUDED.revenue
+    )
+    SELECT COUNT(*)::integer FROM claimed;
+$$ LANGUAGE sql;
+-- Catch-up: rolls up the next batch of pending sales at or below high_water.
+-- The rolled_up flag, not a watermark, says what is left: sales can commit out
+-- of ingest_seq order. Returns 0 once nothing is left.
+CREATE OR REPLACE FUNCTION rollup_pending_sales(high_water BIGINT, batch_size INTEGER) RETURNS INTEGER AS $$
+DECLARE
+    batch INTEGER[];
+BEGIN
+    SELECT array_agg(id) INTO batch FROM (
+        SELECT id, ingest_seq FROM sales WHERE NOT rolled_up AND ingest_seq <= high_water AND sale_time IS NOT NULL
+        ORDER BY ingest_seq LIMIT batch_size FOR UPDATE SKIP LOCKED
+    ) pending;
+    IF batch IS NULL THEN
+        RETURN 0;
+    END IF;
+    RETURN rollup_sales(batch);
+END;
+$$ LANGUAGE plpgsql;
+-- Backfill
+DO $$
+BEGIN
+    WHILE rollup_pending_sales((SELECT COALESCE(MAX(ingest_seq), 0) FROM sales), 10000) > 0 LOOP
+    END LOOP;
+END
+$$;
@@ -2,6 +2,8 @@
 -- Run this file in PostgreSQL to create the required tables
 -- Enable pgcrypto for password hashing
 CREATE EXTENSION IF NOT EXISTS pgcrypto;
+-- Enable pg_trgm for fuzzy product search
+CREATE EXTENSION IF NOT EXISTS pg_trgm;
 -- Users table
 CREATE TABLE users (
     id SERIAL PRIMARY KEY,
@@ -17,7 +19,38 @@ CREATE TABLE products (
     price NUMERIC(10, 2) NOT NULL,
     quantity INTEGER NOT NULL,
     min_stock INTEGER NOT NULL,
-    description TEXT
+    description TEXT,
+    -- Lower-cased text searched by the Inventory tab and /api/products/search
+    search_text TEXT GENERATED ALWAYS AS (lower(name || ' ' || COALESCE(category, '') || ' ' || COALESCE(description, ''))) STORED,
+    changed_at TIMESTAMP NOT NULL DEFAULT NOW() -- Last rename or recategorisation
+);
+-- Trigram index for typo-tolerant product search
+CREATE INDEX idx_products_search_trgm ON products USING GIN (search_text gin_trgm_ops);
+-- Keyset paging indexes for the Inventory tab
+CREATE INDEX idx_products_name_id ON products(name, id);
+CREATE INDEX idx_products_category_id ON products((COALESCE(category, '')), id);
+CREATE INDEX idx_products_price_id ON products(price, id);
+CREATE INDEX idx_products_quantity_id ON products(quantity, id);
+-- The Pivot tab's analytics cache re-reads only products changed since its last refresh
+CREATE INDEX idx_products_changed_at ON products(changed_at);
+CREATE OR REPLACE FUNCTION touch_product_changed_at() RETURNS TRIGGER AS $$
+BEGIN
+    NEW.changed_at := NOW();
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER products_touch_changed_at BEFORE UPDATE OF name, category ON products
+    FOR EACH ROW WHEN (OLD.name IS DISTINCT FROM NEW.name OR OLD.category IS DISTINCT FROM NEW.category)
+    EXECUTE FUNCTION touch_product_changed_at();
+-- Reorder forecasts, replaced on each run of the forecasting job
+CREATE TABLE product_forecasts (
+    product_id INTEGER PRIMARY KEY REFERENCES products(id) ON DELETE CASCADE,
+    daily_velocity NUMERIC(12, 3) NOT NULL,
+    weekday_factors REAL[] NOT NULL, -- Monday first, averaging 1
+    stockout_date DATE,
+    reorder_point INTEGER NOT NULL,
+    suggested_order INTEGER NOT NULL,
+    computed_at TIMESTAMP NOT NULL DEFAULT NOW()
 );
 -- Sales table
 CREATE TABLE sales (
@@ -25,7 +58,20 @@ CREATE TABLE sales (
     cashier TEXT REFERENCES users(username),
     sale_time TIMESTAMP NOT NULL DEFAULT NOW(),
     total NUMERIC(10, 2) NOT NULL,
-    payment_method TEXT NOT NULL
+    payment_method TEXT NOT NULL,
+    ingest_seq BIGSERIAL, -- Insert order, for the rollup catch-up
+    rolled_up BOOLEAN NOT NULL DEFAULT false
+);
+-- Sale IDs are handed to terminals in blocks; the sequence step is the block size
+ALTER SEQUENCE sales_id_seq INCREMENT BY 100;
+-- Sale ID blocks reserved by each terminal
+CREATE TABLE sale_id_blocks (
+    block_start INTEGER PRIMARY KEY,
+    block_size INTEGER NOT NULL,
+    terminal_id TEXT NOT NULL,
+    next_unused INTEGER NOT NULL,
+    reserved_at TIMESTAMP NOT NULL DEFAULT NOW(),
+    released_at TIMESTAMP
 );
 -- Sales Items table
 CREATE TABLE sales_items (
@@ -35,13 +81,260 @@ CREATE TABLE sales_items (
     quantity INTEGER NOT NULL,
     price NUMERIC(10, 2) NOT NULL
 );
--- Activity Log table
+-- Date-range reads (reports, receipt export, forecasting) go through these
+CREATE INDEX idx_sales_sale_time ON sales(sale_time);
+CREATE INDEX idx_sales_items_sale_id ON sales_items(sale_id);
+-- Sales rollups by hour and by day x cashier x payment method, plus product
+-- quantities at the same grain. Reports read these instead of scanning sales.
+CREATE TABLE sales_rollup_hourly (
+    bucket TIMESTAMP NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    total NUMERIC(14, 2) NOT NULL,
+    orders INTEGER NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method)
+);
+CREATE TABLE sales_rollup_daily (
+    bucket DATE NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    total NUMERIC(14, 2) NOT NULL,
+    orders INTEGER NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method)
+);
+CREATE TABLE product_rollup_hourly (
+    bucket TIMESTAMP NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    product_name TEXT NOT NULL,
+    quantity BIGINT NOT NULL,
+    revenue NUMERIC(14, 2) NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method, product_name)
+);
+CREATE TABLE product_rollup_daily (
+    bucket DATE NOT NULL,
+    cashier TEXT NOT NULL,
+    payment_method TEXT NOT NULL,
+    product_name TEXT NOT NULL,
+    quantity BIGINT NOT NULL,
+    revenue NUMERIC(14, 2) NOT NULL,
+    PRIMARY KEY (bucket, cashier, payment_method, product_name)
+);
+-- Sales not yet counted in the rollups, in ingest order
+CREATE INDEX idx_sales_rollup_pending ON sales(ingest_seq) WHERE NOT rolled_up;
+-- Adds the given sales to every rollup and marks them rolled up. Sales that are
+-- already rolled up are skipped, so concurrent callers never count one twice.
+CREATE OR REPLACE FUNCTION rollup_sales(sale_ids INTEGER[]) RETURNS INTEGER AS $$
+    WITH claimed AS (
+        UPDATE sales SET rolled_up = true
+        WHERE id = ANY(sale_ids) AND NOT rolled_up AND sale_time IS NOT NULL
+        RETURNING id, date_trunc('hour', sale_time) AS hour, COALESCE(cashier, '') AS cashier, payment_method, total
+    ),
+    items AS (
+        SELECT c.hour, c.cashier, c.payment_method, si.product_name,
+               SUM(si.quantity) AS quantity, SUM(si.quantity * si.price) AS revenue
+        FROM claimed c JOIN sales_items si ON si.sale_id = c.id
+        GROUP BY 1, 2, 3, 4
+    ),
+    sales_hourly AS (
+        INSERT INTO sales_rollup_hourly AS r (bucket, cashier, payment_method, total, orders)
+        SELECT hour, cashier, payment_method, SUM(total), COUNT(*) FROM claimed GROUP BY 1, 2, 3 ORDER BY 1, 2, 3
+        ON CONFLICT (bucket, cashier, payment_method)
+        DO UPDATE SET total = r.total + EXCLUDED.total, orders = r.orders + EXCLUDED.orders
+    ),
+    sales_daily AS (
+        INSERT INTO sales_rollup_daily AS r (bucket, cashier, payment_method, total, orders)
+        SELECT hour::date, cashier, payment_method, SUM(total), COUNT(*) FROM claimed GROUP BY 1, 2, 3 ORDER BY 1, 2, 3
+        ON CONFLICT (bucket, cashier, payment_method)
+        DO UPDATE SET total = r.total + EXCLUDED.total, orders = r.orders + EXCLUDED.orders
+    ),
+    products_hourly AS (
+        INSERT INTO product_rollup_hourly AS r (bucket, cashier, payment_method, product_name, quantity, revenue)
+        SELECT hour, cashier, payment_method, product_name, quantity, revenue FROM items ORDER BY 1, 2, 3, 4
+        ON CONFLICT (bucket, cashier, payment_method, product_name)
+        DO UPDATE SET quantity = r.quantity + EXCLUDED.quantity, revenue = r.revenue + EXCLUDED.revenue
+    ),
+    products_daily AS (
+        INSERT INTO product_rollup_daily AS r (bucket, cashier, payment_method, product_name, quantity, revenue)
+        SELECT hour::date, cashier, payment_method, product_name, SUM(quantity), SUM(revenue) FROM items
+        GROUP BY 1, 2, 3, 4 ORDER BY 1, 2, 3, 4
+        ON CONFLICT (bucket, cashier, payment_method, product_name)
+        DO UPDATE SET quantity = r.quantity + EXCLUDED.quantity, revenue = r.revenue + EXCLUDED.revenue
+    )
+    SELECT COUNT(*)::integer FROM claimed;
+$$ LANGUAGE sql;
+-- Catch-up: rolls up the next batch of pending sales at or below high_water.
+-- The rolled_up flag, not a watermark, says what is left: sales can commit out
+-- of ingest_seq order. Returns 0 once nothing is left.
+CREATE OR REPLACE FUNCTION rollup_pending_sales(high_water BIGINT, batch_size INTEGER) RETURNS INTEGER AS $$
+DECLARE
+    batch INTEGER[];
+BEGIN
+    SELECT array_agg(id) INTO batch FROM (
+        SELECT id, ingest_seq FROM sales WHERE NOT rolled_up AND ingest_seq <= high_water AND sale_time IS NOT NULL
+        ORDER BY ingest_seq LIMIT batch_size FOR UPDATE SKIP LOCKED
+    ) pending;
+    IF batch IS NULL THEN
+        RETURN 0;
+    END IF;
+    RETURN rollup_sales(batch);
+END;
+$$ LANGUAGE plpgsql;
+-- Order value and item count t-digests per hour/day x cashier x terminal,
+-- updated at checkout (see OrderQuantiles)
+CREATE TABLE order_sketches_hourly (
+    bucket TIMESTAMP NOT NULL,
+    cashier TEXT NOT NULL,
+    terminal_id TEXT NOT NULL,
+    orders INTEGER NOT NULL,
+    value_digest BYTEA NOT NULL,
+    items_digest BYTEA NOT NULL,
+    PRIMARY KEY (bucket, cashier, terminal_id)
+);
+CREATE TABLE order_sketches_daily (
+    bucket DATE NOT NULL,
+    cashier TEXT NOT NULL,
+    terminal_id TEXT NOT NULL,
+    orders INTEGER NOT NULL,
+    value_digest BYTEA NOT NULL,
+    items_digest BYTEA NOT NULL,
+    PRIMARY KEY (bucket, cashier, terminal_id)
+);
+-- Sales before live_from_seq predate checkout sketching; the hourly maintenance
+-- sketches them a day at a time up to done_through (single row)
+CREATE TABLE order_quantiles_backfill (
+    id BOOLEAN PRIMARY KEY DEFAULT true CHECK (id),
+    live_from_seq BIGINT NOT NULL,
+    done_through DATE
+);
+INSERT INTO order_quantiles_backfill (live_from_seq) VALUES (1);
+-- Saved state of the in-memory top-sellers sketch (single row)
+CREATE TABLE top_sellers_state (
+    id BOOLEAN PRIMARY KEY DEFAULT true CHECK (id),
+    watermark BIGINT NOT NULL,
+    saved_at TIMESTAMP NOT NULL,
+    state BYTEA NOT NULL
+);
+-- The top-sellers poll follows new sales in ingest order
+CREATE INDEX idx_sales_ingest_seq ON sales(ingest_seq);
+-- Activity Log table, partitioned by month; the app creates partitions ahead
+-- and detaches or archives those past activityLog/retentionMonths
 CREATE TABLE activity_log (
-    id SERIAL PRIMARY KEY,
+    id BIGSERIAL,
     username TEXT REFERENCES users(username),
     action TEXT,
     details TEXT,
-    timestamp TIMESTAMP NOT NULL DEFAULT NOW()
+    details_json JSONB NOT NULL DEFAULT '{}', -- sale_id, product_id, product, ... for indexed lookups
+    timestamp TIMESTAMP NOT NULL DEFAULT NOW(),
+    PRIMARY KEY (id, timestamp) -- Also serves incremental backups reading past the last backed-up id
+) PARTITION BY RANGE (timestamp);
+-- Catches entries for months without a partition (clock skew, replayed spills,
+-- retired months); maintenance moves them into monthly partitions
+CREATE TABLE activity_log_default PARTITION OF activity_log DEFAULT;
+-- Filtered, keyset-paged reads: newest first within a user or an action
+CREATE INDEX idx_activity_log_timestamp ON activity_log(timestamp, id);
+CREATE INDEX idx_activity_log_username ON activity_log(username, timestamp, id);
+CREATE INDEX idx_activity_log_action ON activity_log(action, timestamp, id);
+CREATE INDEX idx_activity_log_details ON activity_log USING GIN (details_json jsonb_path_ops);
+-- Tells every terminal's recent activity feed which ids were just logged
+CREATE OR REPLACE FUNCTION notify_activity_log() RETURNS TRIGGER AS $$
+BEGIN
+    PERFORM pg_notify('activity_log', json_build_object('from', MIN(id), 'to', MAX(id))::text)
+    FROM logged HAVING COUNT(*) > 0;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+CREATE TRIGGER activity_log_notify AFTER INSERT ON activity_log
+    REFERENCING NEW TABLE AS logged FOR EACH STATEMENT EXECUTE FUNCTION notify_activity_log();
+-- Creates the monthly range partitions of a table partitioned on a timestamp,
+-- from the current month through months_ahead months out
+CREATE OR REPLACE FUNCTION ensure_monthly_partitions(parent TEXT, months_ahead INTEGER) RETURNS VOID AS $$
+DECLARE
+    month_start DATE;
+BEGIN
+    FOR i IN 0..months_ahead LOOP
+        month_start := (date_trunc('month', now()) + make_interval(months => i))::date;
+        BEGIN
+            EXECUTE format('CREATE TABLE IF NOT EXISTS %I PARTITION OF %I FOR VALUES FROM (%L) TO (%L)',
+                           parent || '_' || to_char(month_start, 'YYYYMM'), parent,
+                           month_start, (month_start + interval '1 month')::date);
+        EXCEPTION WHEN duplicate_table OR unique_violation THEN
+            NULL; -- Another terminal created it first
+        END;
+    END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+-- Stock movement ledger: every stock change is an appended row, and
+-- products.quantity is the running total kept by stock_movements_apply
+CREATE TABLE stock_movements (
+    id BIGSERIAL,
+    product_id INTEGER NOT NULL,
+    quantity_delta INTEGER NOT NULL CHECK (quantity_delta <> 0),
+    reason TEXT NOT NULL CHECK (reason IN ('sale', 'receipt', 'adjustment', 'return')),
+    reference TEXT,
+    username TEXT,
+    moved_at TIMESTAMP NOT NULL DEFAULT NOW()
+) PARTITION BY RANGE (moved_at);
+CREATE INDEX idx_stock_movements_product_time ON stock_movements(product_id, moved_at);
+-- Incremental backups read movements past the last backed-up id
+CREATE INDEX idx_stock_movements_id ON stock_movements(id);
+SELECT ensure_monthly_partitions('stock_movements', 3);
+SELECT ensure_monthly_partitions('activity_log', 3);
+-- Compacted stock levels; a product only gets a row when it moved since its last one
+CREATE TABLE stock_snapshots (
+    product_id INTEGER NOT NULL,
+    snapshot_at TIMESTAMP NOT NULL,
+    quantity INTEGER NOT NULL,
+    PRIMARY KEY (product_id, snapshot_at)
 );
+CREATE INDEX idx_stock_snapshots_time ON stock_snapshots(snapshot_at);
+-- Projects a statement's movements onto products.quantity, one update per product
+CREATE OR REPLACE FUNCTION apply_stock_movements() RETURNS TRIGGER AS $$
+BEGIN
+    -- Lock in id order so concurrent sales of the same products cannot deadlock
+    PERFORM 1 FROM products WHERE id IN (SELECT product_id FROM moved) ORDER BY id FOR UPDATE;
+    UPDATE products p SET quantity = p.quantity + m.delta
+    FROM (SELECT product_id, SUM(quantity_delta) AS delta FROM moved GROUP BY product_id) m
+    WHERE p.id = m.product_id;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+-- Folds the ledger into stock_snapshots up to the last midnight that is at
+-- least an hour old, leaving time for late-committing sales. Safe to rerun.
+CREATE OR REPLACE FUNCTION take_stock_snapshot() RETURNS INTEGER AS $$
+DECLARE
+    cutoff TIMESTAMP := date_trunc('day', now() - interval '1 hour');
+    previous TIMESTAMP;
+    written INTEGER;
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('take_stock_snapshot'));
+    SELECT MAX(snapshot_at) INTO previous FROM stock_snapshots;
+    IF previous >= cutoff THEN
+        RETURN 0;
+    END IF;
+    INSERT INTO stock_snapshots (product_id, snapshot_at, quantity)
+    SELECT m.product_id, cutoff, COALESCE(s.quantity, 0) + m.delta
+    FROM (SELECT product_id, SUM(quantity_delta) AS delta FROM stock_movements
+          WHERE moved_at > COALESCE(previous, '-infinity') AND moved_at <= cutoff
+          GROUP BY product_id) m
+    LEFT JOIN LATERAL (SELECT quantity FROM stock_snapshots
+                       WHERE product_id = m.product_id ORDER BY snapshot_at DESC LIMIT 1) s ON true;
+    GET DIAGNOSTICS written = ROW_COUNT;
+    RETURN written;
+END;
+$$ LANGUAGE plpgsql;
+-- Stock of one product at a point in time: its latest snapshot plus the movements after it
+CREATE OR REPLACE FUNCTION stock_at(p_product_id INTEGER, p_at TIMESTAMP) RETURNS INTEGER AS $$
+    SELECT (COALESCE(s.quantity, 0) + COALESCE((
+        SELECT SUM(m.quantity_delta) FROM stock_movements m
+        WHERE m.product_id = p_product_id
+          AND m.moved_at > COALESCE(s.snapshot_at, '-infinity') AND m.moved_at <= p_at), 0))::integer
+    FROM (SELECT 1) AS anchor
+    LEFT JOIN LATERAL (SELECT quantity, snapshot_at FROM stock_snapshots
+                       WHERE product_id = p_product_id AND snapshot_at <= p_at
+                       ORDER BY snapshot_at DESC LIMIT 1) s ON true;
+$$ LANGUAGE sql STABLE;
+CREATE TRIGGER stock_movements_apply AFTER INSERT ON stock_movements
+    REFERENCING NEW TABLE AS moved FOR EACH STATEMENT EXECUTE FUNCTION apply_stock_movements();
 -- Example: Insert an admin user (replace password as needed)
 -- INSERT INTO users (username, password_hash, role) VALUES ('admin', crypt('yourpassword', gen_salt('bf')), 'admin');
@@ -0,0 +1,200 @@
+// Read-only queries over a .possnap sales snapshot (see SalesSnapshot.h).
+// Never connects to PostgreSQL; blocks outside the --from/--to range are
+// skipped using the directory's min/max statistics.
+//
+//   snapshot_query FILE info
+//   snapshot_query FILE sales-by-day  [--from DATE] [--to DATE]
+//   snapshot_query FILE by-cashier    [--from DATE] [--to DATE]
+//   snapshot_query FILE top-products  [--from DATE] [--to DATE] [--limit N]
+//
+// Results are CSV on stdout; a scan summary goes to stderr.
+#include "SalesSnapshot.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QTextStream>
+#include <algorithm>
+#include <climits>
+#include <functional>
+
+using namespace SalesSnapshot;
+
+static QTextStream out(stdout);
+static QTextStream err(stderr);
+
+namespace {
+struct ScanStats {
+    int blocksRead = 0;
+    int blocksTotal = 0;
+};
+}
+
+// Visits the rows of `table` whose sale_time (epoch seconds) is in [from, to).
+// Only the named columns are decoded, and only for blocks that can match.
+static bool scan(const Reader& reader, const TableInfo& table, qint64 from, qint64 to, const QStringList& columnNames,
+                 const std::function<void(const std::vector<std::vector<qint64>>& columns, size_t row)>& visit,
+                 ScanStats& stats) {
+    const int timeIndex = table.columnIndex("sale_time");
+    QList<int> indexes;
+    for (const QString& name : columnNames) {
+        const int index = table.columnIndex(name);
+        if (index < 0 || timeIndex < 0) {
+            err << "Snapshot table " << table.name << " has no column " << (index < 0 ? name : QString("sale_time")) << "\n";
+            return false;
+        }
+        indexes << index;
+    }
+    const ColumnInfo& timeColumn = table.columns[timeIndex];
+    std::vector<qint64> times;
+    std::vector<std::vector<qint64>> columns(size_t(indexes.size()));
+    for (int block = 0; block < timeColumn.blocks.size(); ++block) {
+        ++stats.blocksTotal;
+        const BlockInfo& info = timeColumn.blocks[block];
+        if (info.max < from || info.min >= to) continue;
+        ++stats.blocksRead;
+        if (!reader.readBlock(timeColumn, block, times)) {
+            err << "Corrupt block " << block << " in " << table.name << "\n";
+            return false;
+        }
+        for (int i = 0; i < indexes.size(); ++i) {
+            if (!reader.readBlock(table.columns[indexes[i]], block, columns[size_t(i)])) {
+                err << "Corrupt block " << block << " in " << table.name << "\n";
+                return false;
+            }
+        }
+        for (size_t row = 0; row < times.size(); ++row) {
+            if (times[row] >= from && times[row] < to) visit(columns, row);
+        }
+    }
+    return true;
+}
+
+static QString csvText(const QString& text) {
+    if (!text.contains(',') && !text.contains('"') && !text.contains('\n')) return text;
+    return '"' + QString(text).replace("\"", "\"\"") + '"';
+}
+
+static QString money(qint64 cents) {
+    return QString::number(cents / 100.0, 'f', 2);
+}
+
+static int info(const Reader& reader) {
+    out << "version," << reader.version() << "\n";
+    out << "created," << reader.createdAt().toString(Qt::ISODate) << "\n";
+    out << "table,column,type,rows,blocks,encoded_bytes,dictionary,min,max\n";
+    for (const TableInfo& table : reader.tables()) {
+        for (const ColumnInfo& column : table.columns) {
+            qint64 bytes = 0;
+            qint64 min = LLONG_MAX, max = LLONG_MIN;
+            for (const BlockInfo& block : column.blocks) {
+                bytes += block.size;
+                min = std::min(min, block.min);
+                max = std::max(max, block.max);
+            }
+            out << table.name << ',' << column.name << ',' << (column.type == ColumnType::String ? "string" : "integer") << ','
+                << table.rows << ',' << column.blocks.size() << ',' << bytes << ',' << column.dictionary.size() << ','
+                << (column.blocks.isEmpty() ? QString() : QString::number(min)) << ','
+                << (column.blocks.isEmpty() ? QString() : QString::number(max)) << "\n";
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("snapshot_query");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Query a POS sales snapshot without touching the database.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("file", "Snapshot file (.possnap)");
+    parser.addPositionalArgument("command", "info, sales-by-day, by-cashier or top-products");
+    QCommandLineOption fromOption("from", "First day to include (YYYY-MM-DD).", "date");
+    QCommandLineOption toOption("to", "Last day to include (YYYY-MM-DD).", "date");
+    QCommandLineOption limitOption("limit", "Rows for top-products (default 20).", "n", "20");
+    parser.addOptions({fromOption, toOption, limitOption});
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2) parser.showHelp(1);
+    const QString command = args[1];
+
+    Reader reader;
+    if (!reader.open(args[0])) {
+        err << args[0] << ": " << reader.errorString() << "\n";
+        return 1;
+    }
+    if (command == "info") return info(reader);
+
+    // sale_time is stored as wall-clock seconds, so dates convert as if UTC
+    qint64 from = LLONG_MIN, to = LLONG_MAX;
+    if (parser.isSet(fromOption)) {
+        const QDate date = QDate::fromString(parser.value(fromOption), Qt::ISODate);
+        if (!date.isValid()) parser.showHelp(1);
+        from = date.startOfDay(Qt::UTC).toSecsSinceEpoch();
+    }
+    if (parser.isSet(toOption)) {
+        const QDate date = QDate::fromString(parser.value(toOption), Qt::ISODate);
+        if (!date.isValid()) parser.showHelp(1);
+        to = date.addDays(1).startOfDay(Qt::UTC).toSecsSinceEpoch();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ScanStats stats;
+    bool ok = false;
+    if (command == "sales-by-day" || command == "by-cashier") {
+        const TableInfo* sales = reader.table("sales");
+        if (!sales) {
+            err << "The snapshot has no sales table\n";
+            return 1;
+        }
+        const bool byDay = command == "sales-by-day";
+        QMap<qint64, QPair<qint64, qint64>> groups; // key -> (orders, cents)
+        ok = scan(reader, *sales, from, to, {byDay ? "sale_time" : "cashier", "total_cents"},
+                  [&](const std::vector<std::vector<qint64>>& columns, size_t row) {
+                      const qint64 key = byDay ? columns[0][row] / 86400 : columns[0][row];
+                      auto& group = groups[key];
+                      ++group.first;
+                      group.second += columns[1][row];
+                  }, stats);
+        const int cashierIndex = sales->columnIndex("cashier");
+        const QStringList cashiers = cashierIndex < 0 ? QStringList() : sales->columns[cashierIndex].dictionary;
+        out << (byDay ? "date" : "cashier") << ",orders,revenue\n";
+        for (auto it = groups.constBegin(); it != groups.constEnd(); ++it) {
+            const QString key = byDay ? QDate(1970, 1, 1).addDays(it.key()).toString(Qt::ISODate) : csvText(cashiers.value(int(it.key())));
+            out << key << ',' << it.value().first << ',' << money(it.value().second) << "\n";
+        }
+    } else if (command == "top-products") {
+        const TableInfo* items = reader.table("sales_items");
+        if (!items) {
+            err << "The snapshot has no sales_items table\n";
+            return 1;
+        }
+        const int productIndex = items->columnIndex("product");
+        const QStringList products = productIndex < 0 ? QStringList() : items->columns[productIndex].dictionary;
+        std::vector<qint64> quantity(size_t(products.size()), 0), revenue(size_t(products.size()), 0);
+        ok = scan(reader, *items, from, to, {"product", "quantity", "price_cents"},
+                  [&](const std::vector<std::vector<qint64>>& columns, size_t row) {
+                      const size_t product = size_t(columns[0][row]);
+                      if (product >= quantity.size()) return;
+                      quantity[product] += columns[1][row];
+                      revenue[product] += columns[1][row] * columns[2][row];
+                  }, stats);
+        std::vector<int> order(products.size());
+        for (int i = 0; i < int(order.size()); ++i) order[size_t(i)] = i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return revenue[size_t(a)] > revenue[size_t(b)]; });
+        const int limit = qMax(1, parser.value(limitOption).toInt());
+        out << "product,quantity,revenue\n";
+        for (int i = 0; i < int(order.size()) && i < limit && quantity[size_t(order[size_t(i)])] > 0; ++i) {
+            const size_t p = size_t(order[size_t(i)]);
+            out << csvText(products[int(p)]) << ',' << quantity[p] << ',' << money(revenue[p]) << "\n";
+        }
+    } else {
+        parser.showHelp(1);
+    }
+    out.flush();
+    err << "Read " << stats.blocksRead << " of " << stats.blocksTotal << " blocks in " << timer.elapsed() << " ms\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+-- Stock Ledger Setup for POS System
+-- Run this file on an existing database to move stock tracking onto the movement ledger
+-- Creates the monthly range partitions of a table partitioned on a timestamp,
+-- from the current month through months_ahead months out
+CREATE OR REPLACE FUNCTION ensure_monthly_partitions(parent TEXT, months_ahead INTEGER) RETURNS VOID AS $$
+DECLARE
+    month_start DATE;
+BEGIN
+    FOR i IN 0..months_ahead LOOP
+        month_start := (date_trunc('month', now()) + make_interval(months => i))::date;
+        BEGIN
+            EXECUTE format('CREATE TABLE IF NOT EXISTS %I PARTITION OF %I FOR VALUES FROM (%L) TO (%L)',
+                           parent || '_' || to_char(month_start, 'YYYYMM'), parent,
+                           month_start, (month_start + interval '1 month')::date);
+        EXCEPTION WHEN duplicate_table OR unique_violation THEN
+            NULL; -- Another terminal created it first
+        END;
+    END LOOP;
+END;
+$$ LANGUAGE plpgsql;
+-- Stock movement ledger: every stock change is an appended row, and
+-- products.quantity is the running total kept by stock_movements_apply
+CREATE TABLE IF NOT EXISTS stock_movements (
+    id BIGSERIAL,
+    product_id INTEGER NOT NULL,
+    quantity_delta INTEGER NOT NULL CHECK (quantity_delta <> 0),
+    reason TEXT NOT NULL CHECK (reason IN ('sale', 'receipt', 'adjustment', 'return')),
+    reference TEXT,
+    username TEXT,
+    moved_at TIMESTAMP NOT NULL DEFAULT NOW()
+) PARTITION BY RANGE (moved_at);
+CREATE INDEX IF NOT EXISTS idx_stock_movements_product_time ON stock_movements(product_id, moved_at);
+SELECT ensure_monthly_partitions('stock_movements', 3);
+-- Compacted stock levels; a product only gets a row when it moved since its last one
+CREATE TABLE IF NOT EXISTS stock_snapshots (
+    product_id INTEGER NOT NULL,
+    snapshot_at TIMESTAMP NOT NULL,
+    quantity INTEGER NOT NULL,
+    PRIMARY KEY (product_id, snapshot_at)
+);
+CREATE INDEX IF NOT EXISTS idx_stock_snapshots_time ON stock_snapshots(snapshot_at);
+-- Projects a statement's movements onto products.quantity, one update per product
+CREATE OR REPLACE FUNCTION apply_stock_movements() RETURNS TRIGGER AS $$
+BEGIN
+    -- Lock in id order so concurrent sales of the same products cannot deadlock
+    PERFORM 1 FROM products WHERE id IN (SELECT product_id FROM moved) ORDER BY id FOR UPDATE;
+    UPDATE products p SET quantity = p.quantity + m.delta
+    FROM (SELECT product_id, SUM(quantity_delta) AS delta FROM moved GROUP BY product_id) m
+    WHERE p.id = m.product_id;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+-- Folds the ledger into stock_snapshots up to the last midnight that is at
+-- least an hour old, leaving time for late-committing sales. Safe to rerun.
+CREATE OR REPLACE FUNCTION take_stock_snapshot() RETURNS INTEGER AS $$
+DECLARE
+    cutoff TIMESTAMP := date_trunc('day', now() - interval '1 hour');
+    previous TIMESTAMP;
+    written INTEGER;
+BEGIN
+    PERFORM pg_advisory_xact_lock(hashtext('take_stock_snapshot'));
+    SELECT MAX(snapshot_at) INTO previous FROM stock_snapshots;
+    IF previous >= cutoff THEN
+        RETURN 0;
+    END IF;
+    INSERT INTO stock_snapshots (product_id, snapshot_at, quantity)
+    SELECT m.product_id, cutoff, COALESCE(s.quantity, 0) + m.delta
+    FROM (SELECT product_id, SUM(quantity_delta) AS delta FROM stock_movements
+          WHERE moved_at > COALESCE(previous, '-infinity') AND moved_at <= cutoff
+          GROUP BY product_id) m
+    LEFT JOIN LATERAL (SELECT quantity FROM stock_snapshots
+                       WHERE product_id = m.product_id ORDER BY snapshot_at DESC LIMIT 1) s ON true;
+    GET DIAGNOSTICS written = ROW_COUNT;
+    RETURN written;
+END;
+$$ LANGUAGE plpgsql;
+-- Stock of one product at a point in time: its latest snapshot plus the movements after it
+CREATE OR REPLACE FUNCTION stock_at(p_product_id INTEGER, p_at TIMESTAMP) RETURNS INTEGER AS $$
+    SELECT (COALESCE(s.quantity, 0) + COALESCE((
+        SELECT SUM(m.quantity_delta) FROM stock_movements m
+        WHERE m.product_id = p_product_id
+          AND m.moved_at > COALESCE(s.snapshot_at, '-infinity') AND m.moved_at <= p_at), 0))::integer
+    FROM (SELECT 1) AS anchor
+    LEFT JOIN LATERAL (SELECT quantity, snapshot_at FROM stock_snapshots
+                       WHERE product_id = p_product_id AND snapshot_at <= p_at
+                       ORDER BY snapshot_at DESC LIMIT 1) s ON true;
+$$ LANGUAGE sql STABLE;
+DROP TRIGGER IF EXISTS stock_movements_apply ON stock_movements;
+-- Opening balances, recorded before the projection trigger exists so they are not counted twice
+INSERT INTO stock_movements (product_id, quantity_delta, reason, reference)
+SELECT id, quantity, 'adjustment', 'Opening balance' FROM products WHERE quantity <> 0
+    AND NOT EXISTS (SELECT 1 FROM stock_movements);
+CREATE TRIGGER stock_movements_apply AFTER INSERT ON stock_movements
+    REFERENCING NEW TABLE AS moved FOR EACH STATEMENT EXECUTE FUNCTION apply_stock_movements();
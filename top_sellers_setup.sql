@@ -0,0 +1,11 @@
+-- Top Sellers Setup for POS System
+-- Run this file on an existing database (after sales_rollup_setup.sql, which adds ingest_seq)
+-- Saved state of the in-memory top-sellers sketch (single row)
+CREATE TABLE IF NOT EXISTS top_sellers_state (
+    id BOOLEAN PRIMARY KEY DEFAULT true CHECK (id),
+    watermark BIGINT NOT NULL,
+    saved_at TIMESTAMP NOT NULL,
+    state BYTEA NOT NULL
+);
+-- The top-sellers poll follows new sales in ingest order
+CREATE INDEX IF NOT EXISTS idx_sales_ingest_seq ON sales(ingest_seq);